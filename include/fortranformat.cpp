@@ -21,19 +21,51 @@
 // IN THE SOFTWARE.
 
 
+#include <atomic>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cerrno>
 #include <cmath>
-#include <cstdarg>
+#include <condition_variable>
+#include <cctype>
+#include <climits>
+#include <deque>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <istream>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <thread>
+#include <unordered_map>
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define FORTRANFORMAT_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define FORTRANFORMAT_X86_SIMD 0
+#endif
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 #include "fortranformat.hpp"
 using std::ostream;
 
-// default buffer size
-size_t const MAX_STR_LEN = 200;
+// buffer size of a record written to a stream
+size_t const STREAM_BUFFER_SIZE = 1024;
 
-// default exponent width
+// exponent width without Ee, up to a magnitude of 99 (then the letter gives
+// way to a third digit, up to 999)
 size_t const DEFAULT_EXPONENT = 2;
 
 // Fortran's output for true/false values
@@ -47,6 +79,12 @@ char const EXPONENTIAL_E = 'E';
 // character to fill when the number width overflows specified width
 char const OVERFLOW_FILL_CHAR = '*';
 
+// default number of compiled formats kept by each thread's printfor cache
+size_t const DEFAULT_FORMAT_CACHE_CAPACITY = 64;
+
+// addresses remembered for each cached format, the most recent ones
+size_t const MAX_FORMAT_ADDRESSES = 4;
+
 
 struct Scanner {
     const char* start;
@@ -70,20 +108,6 @@ void consume(Scanner* const scanner)
 }
 
 
-void extract(Scanner* const scanner, char* put, size_t const length)
-{
-    size_t len = (scanner->current - scanner->start) + 1;
-    if (len > length)
-    {
-        len = length;
-    }
-    strncpy(put, scanner->start, len);
-    put[len-1] = '\0';
-
-    consume(scanner);
-}
-
-
 inline char advance(Scanner* const scanner)
 {
     scanner->current++;
@@ -141,22 +165,30 @@ inline bool is_alpha(char const c)
 }
 
 
+// the number from the start of the token, which may have a sign, to the 
+// end of its digits, saturated at INT_MAX
 int integer(Scanner* const scanner)
 {
-    int val = 0;
-
     while(is_digit(peek(scanner)))
     {
         advance(scanner);
     }
 
-    char valstr[MAX_STR_LEN];
-    extract(scanner, valstr, MAX_STR_LEN);
-    scanner->start = scanner->current;
-
-    val = atoi(valstr);
+    char const* digit = scanner->start;
+    bool const negative = '-' == *digit;
+    if ('-' == *digit || '+' == *digit)
+    {
+        digit = digit + 1;
+    }
+    int val = 0;
+    for (; digit < scanner->current; ++digit)
+    {
+        int const value = *digit - '0';
+        val = val > (INT_MAX - value) / 10 ? INT_MAX : val * 10 + value;
+    }
+    consume(scanner);
 
-    return val;
+    return negative ? -val : val;
 }
 
 
@@ -191,174 +223,569 @@ inline bool is_negative(double const value)
 }
 
 
-double fast_10pow(size_t const exponent)
+void fill_with_char(char* put, char const fill, size_t const width);
+
+
+unsigned long long const POW10_64[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL, 
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL, 
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// "00" to "99"
+char const DIGIT_PAIRS[201] =
+    "00010203040506070809" "10111213141516171819"
+    "20212223242526272829" "30313233343536373839"
+    "40414243444546474849" "50515253545556575859"
+    "60616263646566676869" "70717273747576777879"
+    "80818283848586878889" "90919293949596979899";
+
+
+inline int bit_length(unsigned long long const value)
+{
+#if defined(__GNUC__)
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+#else
+    int bits = 0;
+    for (unsigned long long rest = value; rest != 0; rest = rest >> 1)
+    {
+        bits = bits + 1;
+    }
+    return bits;
+#endif
+}
+
+
+size_t integer_str_length(unsigned long long const value)
+{
+    // floor(log10(2) * bits) is the number of digits or one more
+    // credits: https://graphics.stanford.edu/~seander/bithacks.html
+    unsigned long long const nonzero = value | 1;
+    size_t const guess = (bit_length(nonzero) * 1233) >> 12;
+    return guess + (nonzero >= POW10_64[guess]);
+}
+
+
+// the last length digits of value, with leading zeroes if needed
+void write_integer(char* put, unsigned long long value, size_t const length)
+{
+    size_t pos = length;
+    while (pos >= 2 && value != 0)
+    {
+        size_t const pair = 2 * (value % 100);
+        value = value / 100;
+        pos = pos - 2;
+        put[pos] = DIGIT_PAIRS[pair];
+        put[pos + 1] = DIGIT_PAIRS[pair + 1];
+    }
+    if (pos == 1)
+    {
+        pos = 0;
+        put[0] = static_cast<char>('0' + value % 10);
+    }
+    fill_with_char(put, '0', pos);
+}
+
+
+inline double fabs(double const value)
+{
+    if (is_negative(value))
+    {
+        return -value;
+    }
+    return value;
+}
+
+void fill_with_char(char* put, char const fill, size_t const width)
+{
+    for (size_t n = 0; n < width; ++n)
+    {
+        put[n] = fill;
+    }
+}
+
+
+//
+// Decimal conversion
+//
+// A finite double is m * 2^e, with integers m and e, so x * 10^s is a ratio
+// of integers and its digits are computed exactly: with 128-bit integers
+// when they're large enough, with a big integer otherwise. Ties are rounded
+// to even, like printf does.
+//
+
+// big enough for any double times 10^MAX_FRACTION_DIGITS
+size_t const BIG_INTEGER_LIMBS = 160;
+
+// exact doubles have at most 1074 fractional digits, of which at most 767 
+// are significant; the remaining ones are zeroes
+size_t const MAX_FRACTION_DIGITS = 1080;
+size_t const MAX_SIGNIFICANT_DIGITS = 800;
+
+// buffer size for the digits of a fixed or scientific representation
+size_t const MAX_DECIMAL_DIGITS = MAX_FRACTION_DIGITS + 320;
+
+uint32_t const POW10_32[10] = {
+    1u, 10u, 100u, 1000u, 10000u, 100000u, 1000000u, 10000000u, 100000000u, 
+    1000000000u
+};
+
+
+inline int trailing_zeros(unsigned long long const value)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(value);
+#else
+    int zeros = 0;
+    for (unsigned long long rest = value; (rest & 1) == 0; rest = rest >> 1)
+    {
+        zeros = zeros + 1;
+    }
+    return zeros;
+#endif
+}
+
+
+// floor(log10(2^exponent)), exact for |exponent| <= 1650
+inline int floor_log10_pow2(int const exponent)
+{
+    if (exponent >= 0)
+    {
+        return (exponent * 78913) >> 18;
+    }
+    return -(((-exponent) * 78913) >> 18) - 1;
+}
+
+
+// absvalue = mantissa * 2^exponent, with an odd mantissa; absvalue > 0
+void decompose(double const absvalue, unsigned long long* mantissa, 
+    int* exponent)
 {
-    static double pow10[10] = {
-        1.0, 10.0, 100.0, 1000.0, 10000.0, 
-        100000.0, 1000000.0, 10000000.0, 100000000.0, 1000000000.0
-    };
+    unsigned long long bits;
+    memcpy(&bits, &absvalue, sizeof(bits));
 
-    if (exponent <= 9)
+    int const biased = static_cast<int>((bits >> 52) & 0x7FF);
+    *mantissa = bits & ((1ULL << 52) - 1);
+    if (biased == 0)
     {
-        // fast, look-up
-        return pow10[exponent];
+        // subnormal
+        *exponent = -1074;
     }
     else
     {
-        // generic
-        double powered = 1.0;
-        for (size_t n=0; n < exponent; ++n)
-        {
-            powered = powered * 10.0;
-        }
-        return powered;
+        *mantissa = *mantissa | (1ULL << 52);
+        *exponent = biased - 1075;
     }
+
+    int const zeros = trailing_zeros(*mantissa);
+    *mantissa = *mantissa >> zeros;
+    *exponent = *exponent + zeros;
 }
 
 
-size_t integer_str_length(unsigned int const value)
+// digits of value, without leading zeroes; returns their number
+inline size_t write_decimal(char* put, unsigned long long const value)
 {
-    // general solution (using it for big numbers)
-    if (value >= 10000000) return floor(log10(value)) + 1;
-    // ugly, but optimal
-    // credits: https://stackoverflow.com/a/3069580
-    if (value >= 100000 )  return 6;
-    if (value >= 10000  )  return 5;
-    if (value >= 1000   )  return 4;
-    if (value >= 100    )  return 3;
-    if (value >= 10     )  return 2;
-    return 1;
+    size_t const len = value == 0 ? 0 : integer_str_length(value);
+    write_integer(put, value, len);
+    return len;
 }
 
 
-void write_integer(char* put, double const value, 
-    bool const rounded_last_digit, bool const insert_nul)
+// Unsigned big integer, little endian
+struct BigInteger
 {
-    double absvalue = fabs(value);
-    unsigned int intpart = abs(static_cast<int>(value));
-    size_t const digits = integer_str_length(abs(intpart));
+    uint32_t limbs[BIG_INTEGER_LIMBS];
+    size_t size;
+};
 
-    for(size_t pos = 0; pos < digits; ++pos)
+
+void big_trim(BigInteger* const big)
+{
+    while (big->size > 0 && big->limbs[big->size - 1] == 0)
     {
-        size_t power = static_cast<size_t>(fast_10pow(digits - pos - 1));
-        unsigned int newvalue = static_cast<int>(intpart / power);
+        big->size = big->size - 1;
+    }
+}
 
-        // round last digit
-        if (rounded_last_digit && pos == digits - 1)
-        {
-            double lastval = round(absvalue - 
-                static_cast<int>(absvalue/10.0) * 10.0);
-            newvalue = static_cast<int>(lastval);
-        }
 
-        put[pos] = newvalue + '0';
+void big_set(BigInteger* const big, unsigned long long const value)
+{
+    big->limbs[0] = static_cast<uint32_t>(value);
+    big->limbs[1] = static_cast<uint32_t>(value >> 32);
+    big->size = 2;
+    big_trim(big);
+}
+
 
-        intpart = intpart - newvalue * power;
-    }  
-    if (insert_nul)
+void big_mul(BigInteger* const big, uint32_t const factor)
+{
+    unsigned long long carry = 0;
+    for (size_t n = 0; n < big->size; ++n)
+    {
+        unsigned long long const product = 
+            static_cast<unsigned long long>(big->limbs[n]) * factor + carry;
+        big->limbs[n] = static_cast<uint32_t>(product);
+        carry = product >> 32;
+    }
+    if (carry != 0)
     {
-        put[digits] = '\0';
+        assert(big->size < BIG_INTEGER_LIMBS);
+        big->limbs[big->size] = static_cast<uint32_t>(carry);
+        big->size = big->size + 1;
     }
 }
 
 
-int base10_exponent(double const value)
+// returns the remainder
+uint32_t big_div(BigInteger* const big, uint32_t const divisor)
 {
-    double const absvalue = fabs(value);
+    unsigned long long remainder = 0;
+    for (size_t n = big->size; n > 0; --n)
+    {
+        unsigned long long const dividend = (remainder << 32) | big->limbs[n - 1];
+        big->limbs[n - 1] = static_cast<uint32_t>(dividend / divisor);
+        remainder = dividend % divisor;
+    }
+    big_trim(big);
+    return static_cast<uint32_t>(remainder);
+}
 
-    // general case, absvalue >= 1E+6 or < 1E-6
-    if (absvalue >=  1000000.0 || absvalue < 0.000001)
+
+void big_mul_pow10(BigInteger* const big, size_t exponent)
+{
+    for (; exponent >= 9; exponent = exponent - 9)
     {
-        return floor(log10(absvalue));
+        big_mul(big, POW10_32[9]);
     }
-    else
+    if (exponent > 0)
     {
-        if (absvalue >= 100000.0)  return  5;  
-        if (absvalue >= 10000.0 )  return  4;
-        if (absvalue >= 1000.0  )  return  3;
-        if (absvalue >= 100.0   )  return  2;
-        if (absvalue >= 10.0    )  return  1;
-        if (absvalue >=  1.0    )  return  0;
-        if (absvalue >=  0.1    )  return -1;  
-        if (absvalue >=  0.01   )  return -2;
-        if (absvalue >=  0.001  )  return -3;
-        if (absvalue >=  0.0001 )  return -4;
-        if (absvalue >=  0.00001)  return -5;
-        return -6;
+        big_mul(big, POW10_32[exponent]);
     }
 }
 
 
-size_t frac_zeroes(double const value)
-{   
-    double const absvalue = fabs(value);
-    if (absvalue >= 0.1)
+// floor division, true when the remainder isn't zero
+bool big_div_pow10(BigInteger* const big, size_t exponent)
+{
+    bool inexact = false;
+    for (; exponent >= 9; exponent = exponent - 9)
     {
-        return 0;
+        inexact = big_div(big, POW10_32[9]) != 0 || inexact;
     }
-    else
+    if (exponent > 0)
+    {
+        inexact = big_div(big, POW10_32[exponent]) != 0 || inexact;
+    }
+    return inexact;
+}
+
+
+void big_shl(BigInteger* const big, size_t const bits)
+{
+    if (big->size == 0)
+    {
+        return;
+    }
+    size_t const words = bits / 32;
+    size_t const shift = bits % 32;
+    size_t const size = big->size + words + 1;
+    assert(size <= BIG_INTEGER_LIMBS);
+
+    // from the top, so that no source limb is overwritten before it's read
+    for (size_t n = size; n-- > words; )
+    {
+        size_t const source = n - words;
+        uint32_t const high = source < big->size ? big->limbs[source] : 0;
+        uint32_t const low = source > 0 ? big->limbs[source - 1] : 0;
+        big->limbs[n] = shift == 0 ? high : 
+            (high << shift) | (low >> (32 - shift));
+    }
+    for (size_t n = 0; n < words; ++n)
+    {
+        big->limbs[n] = 0;
+    }
+    big->size = size;
+    big_trim(big);
+}
+
+
+// floor division by 2^bits, true when any bit shifted out is set
+bool big_shr(BigInteger* const big, size_t const bits)
+{
+    size_t const words = bits / 32;
+    size_t const shift = bits % 32;
+    if (words >= big->size)
     {
-        return -base10_exponent(value) -1;
+        bool const inexact = big->size > 0;
+        big->size = 0;
+        return inexact;
     }
+
+    bool inexact = (big->limbs[words] & ((1u << shift) - 1)) != 0;
+    for (size_t n = 0; n < words; ++n)
+    {
+        inexact = inexact || big->limbs[n] != 0;
+    }
+
+    size_t const size = big->size - words;
+    for (size_t n = 0; n < size; ++n)
+    {
+        uint32_t const low = big->limbs[n + words];
+        uint32_t const high = n + 1 < size ? big->limbs[n + words + 1] : 0;
+        big->limbs[n] = shift == 0 ? low : 
+            (low >> shift) | (high << (32 - shift));
+    }
+    big->size = size;
+    big_trim(big);
+    return inexact;
+}
+
+
+void big_increment(BigInteger* const big)
+{
+    for (size_t n = 0; n < big->size; ++n)
+    {
+        big->limbs[n] = big->limbs[n] + 1;
+        if (big->limbs[n] != 0)
+        {
+            return;
+        }
+    }
+    assert(big->size < BIG_INTEGER_LIMBS);
+    big->limbs[big->size] = 1;
+    big->size = big->size + 1;
 }
 
 
-void extract_fractional_part(char* put, double const value, 
-    size_t const precision, bool const rounded_last_digit)
+// digits of the big integer, which is consumed; returns their number
+size_t big_write_decimal(char* put, BigInteger* const big)
 {
-    double absvalue = fabs(value);
+    char reversed[BIG_INTEGER_LIMBS * 10];
+    size_t len = 0;
+    while (big->size > 0)
+    {
+        uint32_t chunk = big_div(big, POW10_32[9]);
+        for (size_t n = 0; n < 9; ++n)
+        {
+            reversed[len] = static_cast<char>('0' + chunk % 10);
+            chunk = chunk / 10;
+            len = len + 1;
+        }
+    }
+    while (len > 0 && reversed[len - 1] == '0')
+    {
+        len = len - 1;
+    }
+    for (size_t pos = 0; pos < len; ++pos)
+    {
+        put[pos] = reversed[len - pos - 1];
+    }
+    return len;
+}
 
-    if (rounded_last_digit)
+
+#ifdef __SIZEOF_INT128__
+
+typedef unsigned __int128 uint128;
+
+// round(mantissa * 2^exponent * 10^scale) when 128-bit integers suffice
+bool round_decimal_128(unsigned long long const mantissa, int const exponent, 
+    int const scale, uint128* rounded)
+{
+    if (scale > 19 || scale < -19)
     {
-        double last_digit = fast_10pow(precision) * absvalue;
-        // last digit under specified precision, multiplied by 10
-        int last_digit_int = static_cast<int>(last_digit) * 10;
-        double digit_after = fast_10pow(precision + 1) * absvalue - last_digit_int;
+        return false;
+    }
+    // the numerator times 10, the rounding digit, must fit
+    int const pow10_bits = scale > 0 ? (scale + 1) * 10 / 3 + 1 : 4;
+    if (exponent > 0 && 
+        bit_length(mantissa) + exponent + pow10_bits > 127)
+    {
+        return false;
+    }
 
-        if (static_cast<int>(fabs(round(digit_after))) >= 5)
+    uint128 scaled = static_cast<uint128>(mantissa) * 
+        POW10_64[scale > 0 ? scale : 0] * 10;
+    bool inexact = false;
+    if (exponent > 0)
+    {
+        scaled = scaled << exponent;
+    }
+    else if (exponent < 0)
+    {
+        if (exponent <= -128)
         {
-            absvalue = absvalue + 1.0 / static_cast<double>(fast_10pow(precision));
+            // less than a half
+            *rounded = 0;
+            return true;
         }
+        uint128 const mask = (static_cast<uint128>(1) << -exponent) - 1;
+        inexact = (scaled & mask) != 0;
+        scaled = scaled >> -exponent;
+    }
+    if (scale < 0)
+    {
+        unsigned long long const divisor = POW10_64[-scale];
+        inexact = inexact || scaled % divisor != 0;
+        scaled = scaled / divisor;
+    }
+
+    // scaled is the result followed by its first discarded digit
+    unsigned int digit;
+    if ((scaled >> 64) == 0)
+    {
+        unsigned long long const low = static_cast<unsigned long long>(scaled);
+        digit = low % 10;
+        scaled = low / 10;
+    }
+    else
+    {
+        digit = static_cast<unsigned int>(scaled % 10);
+        scaled = scaled / 10;
     }
+    if (digit > 5 || (digit == 5 && (inexact || (scaled & 1) != 0)))
+    {
+        scaled = scaled + 1;
+    }
+    *rounded = scaled;
+    return true;
+}
 
-    int intpart = static_cast<int>(absvalue);
-    double decpart = absvalue - intpart;
 
-    // power of ten
-    double power = 1;
-    for (size_t pw = 0; pw < precision; ++pw)
+size_t write_decimal_128(char* put, uint128 const value)
+{
+    if ((value >> 64) == 0)
     {
-        power = power * 10;
-        decpart = absvalue * power - static_cast<int>(absvalue*(power/10))*10;
-        intpart = static_cast<int>(decpart);
-        put[pw] = intpart + '0';
+        return write_decimal(put, static_cast<unsigned long long>(value));
     }
-    put[precision] = '\0';
+    // at most 39 digits: the low 19 ones are zero-padded
+    unsigned long long const high = 
+        static_cast<unsigned long long>(value / POW10_64[19]);
+    unsigned long long const low = 
+        static_cast<unsigned long long>(value % POW10_64[19]);
+    size_t const len = write_decimal(put, high);
+    write_integer(put + len, low, 19);
+    return len + 19;
 }
 
+#endif
 
-inline double fabs(double const value)
+
+// digits of round(mantissa * 2^exponent * 10^scale), without leading 
+// zeroes; returns their number
+size_t decimal_digits(char* put, unsigned long long const mantissa, 
+    int const exponent, int const scale)
 {
-    if (is_negative(value))
+#ifdef __SIZEOF_INT128__
+    uint128 rounded;
+    if (round_decimal_128(mantissa, exponent, scale, &rounded))
     {
-        return -value;
+        return write_decimal_128(put, rounded);
     }
-    return value;
+#endif
+
+    // the numerator times 10, followed by the floor division, keeping track 
+    // of a non-zero remainder
+    BigInteger big;
+    big_set(&big, mantissa * 10);
+    if (exponent > 0)
+    {
+        big_shl(&big, exponent);
+    }
+    if (scale > 0)
+    {
+        big_mul_pow10(&big, scale);
+    }
+    bool inexact = false;
+    if (exponent < 0)
+    {
+        inexact = big_shr(&big, -exponent);
+    }
+    if (scale < 0)
+    {
+        inexact = big_div_pow10(&big, -scale) || inexact;
+    }
+
+    uint32_t const digit = big_div(&big, 10);
+    bool const odd = big.size > 0 && (big.limbs[0] & 1) != 0;
+    if (digit > 5 || (digit == 5 && (inexact || odd)))
+    {
+        big_increment(&big);
+    }
+    return big_write_decimal(put, &big);
 }
 
-//
-// Number formatting
-//
 
-void fill_with_char(char* put, char const fill, size_t const width)
+// Digits of absvalue times 10^shift rounded to precision fractional digits,
+// at least precision of them (with leading zeroes). Returns their number, 
+// which may not include all the fractional digits when precision exceeds 
+// MAX_FRACTION_DIGITS: the missing ones are zeroes.
+size_t fixed_digits(char* put, double const absvalue, size_t const precision,
+    int const shift)
 {
-    for (size_t n = 0; n < width; ++n)
+    size_t const scale = std::min(precision, MAX_FRACTION_DIGITS);
+
+    size_t len = 0;
+    if (absvalue != 0.0)
     {
-        put[n] = fill;
+        unsigned long long mantissa;
+        int exponent;
+        decompose(absvalue, &mantissa, &exponent);
+        len = decimal_digits(put, mantissa, exponent, 
+            static_cast<int>(scale) + shift);
+    }
+    if (len < scale)
+    {
+        memmove(put + scale - len, put, len);
+        fill_with_char(put, '0', scale - len);
+        len = scale;
+    }
+    return len;
+}
+
+
+// The first count significant digits of absvalue, rounded, and the decimal
+// exponent P of 0.d1d2...dcount * 10^P. Returns the number of digits, which
+// is less than count when it exceeds MAX_SIGNIFICANT_DIGITS: the missing 
+// ones are zeroes.
+size_t scientific_digits(char* put, double const absvalue, size_t const count,
+    int* point)
+{
+    size_t const digits = std::min(count, MAX_SIGNIFICANT_DIGITS);
+    if (absvalue == 0.0)
+    {
+        fill_with_char(put, '0', digits);
+        *point = 0;
+        return digits;
+    }
+
+    unsigned long long mantissa;
+    int exponent;
+    decompose(absvalue, &mantissa, &exponent);
+
+    // 10^(P - 1) <= absvalue < 10^P, except when the estimate is one less
+    *point = floor_log10_pow2(exponent + bit_length(mantissa) - 1) + 1;
+    size_t len = decimal_digits(put, mantissa, exponent, 
+        static_cast<int>(digits) - *point);
+    if (len > digits)
+    {
+        // either a low estimate or rounded up to 10^P
+        *point = *point + 1;
+        len = decimal_digits(put, mantissa, exponent, 
+            static_cast<int>(digits) - *point);
     }
+    assert(len == digits);
+    return digits;
 }
 
 
+//
+// Number formatting
+//
+
 bool format_sign(Scanner* scanner, bool const opt_plus_sign)
 {
     bool plus_sign = opt_plus_sign;
@@ -382,852 +809,7290 @@ bool format_sign(Scanner* scanner, bool const opt_plus_sign)
 }
 
 
-void format_i(char* put, int const value, size_t const width, size_t const fill,
+// Iw.m of an integer of magnitude absvalue
+void format_integer(char* put, unsigned long long const absvalue, 
+    bool const negative, size_t const width, size_t const fill, 
     bool const plus_sign)
 {
-    unsigned int absvalue = abs(value);
-
-    size_t len = integer_str_length(absvalue);
-
-    bool require_sign = is_negative(value) || plus_sign;
-    bool fill_chars   = len < fill;
-
-    size_t maxlen = len + require_sign + fill_chars*(fill - len);
+    size_t const len = integer_str_length(absvalue);
+    size_t const digits = std::max(len, fill);
+    bool const require_sign = negative || plus_sign;
 
-    size_t pos = 0;
-    if (maxlen > width)
+    if (digits + require_sign > width)
     {
         fill_with_char(put, OVERFLOW_FILL_CHAR, width);
-        pos = pos + width;
     }
     else
     {
         // right-alignment whitespace
-        for (;pos < width - maxlen; ++pos)
-        {
-            put[pos] = ' ';
-        }
+        size_t pos = width - digits - require_sign;
+        fill_with_char(put, ' ', pos);
 
-        // minus sign
         if (require_sign)
         {
-            if (is_negative(value))
-            {
-                put[pos] = '-'; 
-            }
-            else
-            {
-                put[pos] = '+';   
-            }
-            
+            put[pos] = negative ? '-' : '+';
             pos = pos + 1;
         }
 
-        // leading zeroes
-        if (fill_chars)
-        {
-            for (size_t fillcount = 0; fillcount < fill - len; ++fillcount, ++pos)
-            {
-                put[pos] = '0';
-            }
-        }
-
-        // integer
-        bool const NOT_ROUNDED = false;
-        bool const INSERT_NUL = false;
-        write_integer(put + pos, value, NOT_ROUNDED, INSERT_NUL);
+        // with leading zeroes up to fill digits
+        write_integer(put + pos, absvalue, digits);
     }
     put[width] = '\0'; 
 }
 
 
-void format_f(char* put, double const value, size_t const width, 
-    size_t const precision, bool const plus_sign)
+void format_i(char* put, long long const value, size_t const width, 
+    size_t const fill, bool const plus_sign)
 {
-    bool require_sign = is_negative(value) || plus_sign;
-
-    // integer part
-    int intval = abs(static_cast<int>(value));
-    char intstr[MAX_STR_LEN];
-    bool const NOT_ROUNDED = false;
-    bool const INSERT_NUL = true;
-    write_integer(intstr, intval, NOT_ROUNDED, INSERT_NUL);
-    size_t const INTLEN = strlen(intstr);
+    // the magnitude of the minimum value doesn't fit a long long
+    unsigned long long const absvalue = value < 0 ? 
+        0 - static_cast<unsigned long long>(value) : value;
+    format_integer(put, absvalue, value < 0, width, fill, plus_sign);
+}
 
-    // the integer part output is optional when its = 0
-    bool optional_intvalue = 0 == intval;
 
-    // fractional part
-    char fracstr[MAX_STR_LEN];
-    bool const ROUNDED = true;
-    extract_fractional_part(fracstr, value, precision, ROUNDED);
-    size_t const FRACLEN = precision;
+void format_u(char* put, unsigned long long const value, size_t const width, 
+    size_t const fill, bool const plus_sign)
+{
+    format_integer(put, value, false, width, fill, plus_sign);
+}
 
-    // 0. precision D+00
-    size_t const FORMATCHARS = 1;
-    size_t const INTCHARS = (!optional_intvalue) * INTLEN;
-    size_t maxlen = require_sign + INTCHARS + FORMATCHARS + FRACLEN;
 
+// Infinity and NaN, like gfortran: the longest form that fits, right-aligned
+void format_nonfinite(char* put, double const value, size_t const width, 
+    bool const plus_sign)
+{
+    char const* str = "NaN";
+    bool require_sign = false;
+    if (std::isinf(value))
+    {
+        require_sign = is_negative(value) || plus_sign;
+        str = width >= 8u + require_sign ? "Infinity" : "Inf";
+    }
+    size_t const len = strlen(str);
 
-    if (width < 2 || maxlen > width)
+    if (len + require_sign > width)
     {
         fill_with_char(put, OVERFLOW_FILL_CHAR, width);
     }
-    else if (precision == 0)
+    else
     {
-        // an integer with a following dot
-        int rounded_intval = static_cast<int>(round(value));
-        if (rounded_intval == 0 && is_negative(value))
+        size_t pos = width - len - require_sign;
+        fill_with_char(put, ' ', pos);
+        if (require_sign)
         {
-            // handles the weird case where value = -0.0 and its int cast
-            // is positive 0.
-            if (width >= 3)
-            {              
-                size_t pos = 0;
-                size_t len = 2 + require_sign + precision;
-                // right-alignment whitespace
-                if (width > len)
-                {
-                    for (;pos < width - len; ++pos)
-                    {
-                        put[pos] = ' ';
-                    } 
-                }
-                // minus or plus sign
-                if (require_sign)
-                {
-                    if (is_negative(value))
-                    {
-                        put[pos] = '-'; 
-                    }
-                    else
-                    {
-                        put[pos] = '+';
-                    }
-                    pos = pos + 1;
-                }
-                put[pos] = '0';
-                put[width - 1] = '.'; 
-            }
+            put[pos] = is_negative(value) ? '-' : '+';
+            pos = pos + 1;
+        }
+        memcpy(put + pos, str, len);
+    }
+    put[width] = '\0';
+}
+
+
+// Fixed notation of the digits, the first intlen of them being the integer
+// part (none when it's zero) and the following fraclen the fractional part,
+// which is completed with zeroes up to precision
+void write_fixed(char* put, size_t const width, bool const negative, 
+    bool const plus_sign, char const* digits, size_t const intlen, 
+    size_t const fraclen, size_t const precision)
+{
+    bool const require_sign = negative || plus_sign;
+
+    // without fractional digits, the zero integer part isn't optional
+    bool const required_zero = 0 == intlen && 0 == precision;
+    size_t const maxlen = require_sign + intlen + required_zero + 1 + 
+        precision;
+
+    if (width < 2 || maxlen > width)
+    {
+        fill_with_char(put, OVERFLOW_FILL_CHAR, width);
+        put[width] = '\0';
+        return;
+    }
+
+    // include the optional zero, when there's space for it
+    bool const include_zero = required_zero || (0 == intlen && width > maxlen);
+    size_t const len = maxlen + (include_zero && !required_zero);
+
+    size_t pos = width - len;
+    fill_with_char(put, ' ', pos);
+
+    if (require_sign)
+    {
+        put[pos] = negative ? '-' : '+';
+        pos = pos + 1;
+    }
+
+    if (include_zero)
+    {
+        put[pos] = '0';
+        pos = pos + 1;
+    }
+    memcpy(put + pos, digits, intlen);
+    pos = pos + intlen;
+
+    put[pos] = '.';
+    pos = pos + 1;
+
+    memcpy(put + pos, digits + intlen, fraclen);
+    fill_with_char(put + pos + fraclen, '0', precision - fraclen);
+    put[width] = '\0';
+}
+
+
+// Digits [first, first + length) of the count given ones, followed by 
+// zeroes
+void copy_digits(char* put, char const* digits, size_t const count, 
+    size_t const first, size_t const length)
+{
+    size_t const given = first < count ? std::min(count - first, length) : 0;
+    memcpy(put, digits + first, given);
+    fill_with_char(put + given, '0', length - given);
+}
+
+
+// Scientific notation 0.d1d2...dp * 10^point of the digits, count of them 
+// given and the remaining ones up to precision being zeroes. A scale factor
+// k > 0 moves k digits before the point, d1...dk.d(k+1)...d(p+1), and one 
+// k < 0 writes -k zeroes after it, 0.0...0d1...d(p+k); the exponent is 
+// point - k. Without Ee (exponent_width 0), the exponent is E+zz, or +zzz
+// past 99; an exponent that doesn't fit its form fills the whole field with 
+// asterisks.
+void write_scientific(char* put, size_t const width, bool const negative, 
+    bool const plus_sign, char const* digits, size_t const count, 
+    size_t const precision, int const point, char const expchar, 
+    size_t const exponent_width, int const scale)
+{
+    bool const require_sign = negative || plus_sign;
+    int const exponent = point - scale;
+    unsigned int const absexponent = abs(exponent);
+
+    bool letter = true;
+    size_t explen = exponent_width;
+    if (0 == exponent_width)
+    {
+        letter = absexponent <= 99;
+        explen = letter ? DEFAULT_EXPONENT : 3;
+    }
+
+    size_t const intlen = scale > 0 ? scale : 0;
+    size_t const zeros = scale < 0 ? -scale : 0;
+    size_t const fraclen = scale > 0 ? precision + 1 - scale : precision;
+
+    // minimum length without leading zero: the integer digits, ., the 
+    // fraction digits, the exponent letter, its sign and its digits
+    size_t const MINLEN = require_sign + intlen + 1 + fraclen + letter + 1 + 
+        explen;
+
+    if (MINLEN > width || integer_str_length(absexponent) > explen)
+    {
+        fill_with_char(put, OVERFLOW_FILL_CHAR, width);
+        put[width] = '\0';
+        return;
+    }
+
+    // check whether there's space for a leading zero
+    bool include_leading_zero = 0 == intlen && width > MINLEN;
+    size_t const LEN = MINLEN + include_leading_zero;
+
+    size_t pos = width - LEN;
+    fill_with_char(put, ' ', pos);
+
+    if (require_sign)
+    {
+        put[pos] = negative ? '-' : '+';
+        pos = pos + 1;
+    }
+
+    if (include_leading_zero)
+    {
+        put[pos] = '0';
+        pos = pos + 1;
+    }
+    copy_digits(put + pos, digits, count, 0, intlen);
+    pos = pos + intlen;
+    put[pos] = '.';
+    pos = pos + 1;
+
+    fill_with_char(put + pos, '0', zeros);
+    copy_digits(put + pos + zeros, digits, count, intlen, fraclen - zeros);
+    pos = pos + fraclen;
+
+    // exponent
+    if (letter)
+    {
+        put[pos] = expchar;
+        pos = pos + 1;
+    }
+    put[pos] = exponent >= 0 ? '+' : '-';
+    write_integer(put + pos + 1, absexponent, explen);
+    put[width] = '\0';
+}
+
+
+// Fw.d of the value times 10^scale (kP)
+void format_f(char* put, double const value, size_t const width, 
+    size_t const precision, int const scale, bool const plus_sign)
+{
+    if (!std::isfinite(value))
+    {
+        format_nonfinite(put, value, width, plus_sign);
+        return;
+    }
+
+    bool const negative = is_negative(value);
+    double const absvalue = fabs(value);
+    int const shift = 0.0 == absvalue ? 0 : scale;
+
+    // at least point integer digits: no need to compute them if they
+    // don't fit anyway (nor past the digits buffer, which only a large
+    // scale factor reaches)
+    if (absvalue != 0.0)
+    {
+        unsigned long long mantissa;
+        int exponent;
+        decompose(absvalue, &mantissa, &exponent);
+        int const point = 
+            floor_log10_pow2(exponent + bit_length(mantissa) - 1) + 1 + shift;
+        if ((point > 0 && 
+            negative + static_cast<size_t>(point) + 1 + precision > width) ||
+            point + 2 > static_cast<int>(MAX_DECIMAL_DIGITS - 
+                MAX_FRACTION_DIGITS))
+        {
+            fill_with_char(put, OVERFLOW_FILL_CHAR, width);
+            put[width] = '\0';
+            return;
+        }
+    }
+
+    // the fraction digits of the value times 10^k end k digits sooner
+    char digits[MAX_DECIMAL_DIGITS];
+    size_t const fraclen = std::min(precision, 
+        MAX_FRACTION_DIGITS - std::max(shift, 0));
+    size_t const len = fixed_digits(digits, absvalue, fraclen, shift);
+
+    // leading zeroes aren't part of the integer part
+    size_t intlen = len - fraclen;
+    size_t start = 0;
+    while (intlen > 0 && digits[start] == '0')
+    {
+        start = start + 1;
+        intlen = intlen - 1;
+    }
+
+    write_fixed(put, width, negative, plus_sign, digits + start, intlen, 
+        fraclen, precision);
+}
+
+
+void format_f(char* put, double const value, size_t const width, 
+    size_t const precision, bool const plus_sign)
+{
+    format_f(put, value, width, precision, 0, plus_sign);
+}
+
+
+// Ew.dEe and Dw.d with a scale factor k, which must be within -d < k < d + 2
+// (or zero, for Ew.0)
+void format_e(char* put, double const value, size_t const width, 
+    size_t const precision, char const expchar, size_t const exponent_width,
+    int const scale, bool const plus_sign)
+{
+    if (!std::isfinite(value))
+    {
+        format_nonfinite(put, value, width, plus_sign);
+        return;
+    }
+
+    int const digits_d = static_cast<int>(precision);
+    if (scale != 0 && (scale <= -digits_d || scale >= digits_d + 2))
+    {
+        fill_with_char(put, OVERFLOW_FILL_CHAR, width);
+        put[width] = '\0';
+        return;
+    }
+
+    // d + 1 significant digits with k > 0, d + k otherwise; the exponent of 
+    // Ew.0 is that of one significant digit
+    char digits[MAX_SIGNIFICANT_DIGITS];
+    int point;
+    size_t const significant = scale > 0 ? precision + 1 : precision + scale;
+    size_t const count = std::min(significant, MAX_SIGNIFICANT_DIGITS);
+    scientific_digits(digits, fabs(value), std::max(count, size_t(1)), &point);
+    if (0.0 == value)
+    {
+        // zero has a zero exponent, whatever the scale factor
+        point = scale;
+    }
+
+    write_scientific(put, width, is_negative(value), plus_sign, digits, 
+        count, precision, point, expchar, exponent_width, scale);
+}
+
+
+void format_e(char* put, double const value, size_t const width, 
+    size_t const precision, char const expchar, size_t const exponent_width,
+    bool const plus_sign)
+{
+    format_e(put, value, width, precision, expchar, exponent_width, 0, 
+        plus_sign);
+}
+
+
+// Gw.dEe, where the scale factor only applies to the E editing
+void format_g(char* put, double const value, size_t const width, 
+    size_t const precision, size_t const exponent, int const scale, 
+    bool const plus_sign)
+{
+    if (!std::isfinite(value))
+    {
+        format_nonfinite(put, value, width, plus_sign);
+        return;
+    }
+
+    // the value rounded to precision significant digits selects the edit
+    char digits[MAX_SIGNIFICANT_DIGITS];
+    int point;
+    size_t const count = std::min(precision, MAX_SIGNIFICANT_DIGITS);
+    scientific_digits(digits, fabs(value), std::max(count, size_t(1)), &point);
+
+    bool const zero = 0.0 == value;
+    bool const fixed = precision > 0 && 
+        (zero || (point >= 0 && point <= static_cast<int>(precision)));
+    // n, 4 without Ee
+    size_t const blanks = 2 + (exponent > 0 ? exponent : DEFAULT_EXPONENT);
+    if (!fixed && scale != 0)
+    {
+        // format as kPEw.dEe, with digits of its own
+        format_e(put, value, width, precision, EXPONENTIAL_E, exponent, 
+            scale, plus_sign);
+    }
+    else if (!fixed)
+    {
+        // format as Ew.dEe
+        write_scientific(put, width, is_negative(value), plus_sign, digits, 
+            count, precision, point, EXPONENTIAL_E, exponent, 0);
+    }
+    else if (width > blanks)
+    {
+        // format as F(w-n).(d-k), followed by n blanks, where a zero counts
+        // as a single digit in the integer part
+        size_t const w = width - blanks;
+        size_t const intlen = zero ? 0 : point;
+        size_t const d = zero ? precision - 1 : precision - point;
+        write_fixed(put, w, is_negative(value), plus_sign, digits, intlen, 
+            std::min(count - intlen, d), d);
+
+        // complete remaining blank spaces
+        fill_with_char(put + w, ' ', width - w);
+        put[width] = '\0';
+    }
+    else
+    {
+        fill_with_char(put, OVERFLOW_FILL_CHAR, width);
+        put[width] = '\0';
+    }
+}
+
+
+void format_g(char* put, double const value, size_t const width, 
+    size_t const precision, size_t const exponent, bool const plus_sign)
+{
+    format_g(put, value, width, precision, exponent, 0, plus_sign);
+}
+
+
+// List-directed real, like gfortran: the form of Gw.dEe for magnitudes the
+// fixed form suits, otherwise 1PEw.(d-1)Ee, with a single integer digit
+void format_list_real(char* put, double const value, size_t const width, 
+    size_t const precision, size_t const exponent)
+{
+    assert(precision > 1 && width > precision + exponent + 4);
+
+    if (!std::isfinite(value))
+    {
+        format_nonfinite(put, value, width, false);
+        return;
+    }
+
+    char digits[MAX_SIGNIFICANT_DIGITS];
+    int point;
+    scientific_digits(digits, fabs(value), precision, &point);
+
+    bool const negative = is_negative(value);
+    bool const zero = 0.0 == value;
+    if (zero || (point >= 0 && point <= static_cast<int>(precision)))
+    {
+        size_t const w = width - (2 + exponent);
+        size_t const intlen = zero ? 0 : point;
+        size_t const d = zero ? precision - 1 : precision - point;
+        write_fixed(put, w, negative, false, digits, intlen, 
+            std::min(precision - intlen, d), d);
+        fill_with_char(put + w, ' ', width - w);
+        put[width] = '\0';
+        return;
+    }
+
+    // d1.d2...dpE+xxx, the exponent one less than that of 0.d1d2...dp
+    unsigned int const absexponent = abs(point - 1);
+    size_t const explen = std::max(integer_str_length(absexponent), exponent);
+    size_t const len = negative + precision + 3 + explen;
+    if (len > width)
+    {
+        fill_with_char(put, OVERFLOW_FILL_CHAR, width);
+        put[width] = '\0';
+        return;
+    }
+
+    size_t pos = width - len;
+    fill_with_char(put, ' ', pos);
+    if (negative)
+    {
+        put[pos] = '-';
+        pos = pos + 1;
+    }
+    put[pos] = digits[0];
+    put[pos + 1] = '.';
+    memcpy(put + pos + 2, digits + 1, precision - 1);
+    pos = pos + precision + 1;
+
+    put[pos] = EXPONENTIAL_E;
+    put[pos + 1] = point >= 1 ? '+' : '-';
+    write_integer(put + pos + 2, absexponent, explen);
+    put[width] = '\0';
+}
+
+
+//
+// Format compilation
+//
+
+FormatItem make_item(FormatOp const op, unsigned int const repeat)
+{
+    FormatItem item;
+    item.op       = op;
+    item.repeat   = repeat;
+    item.width    = 0;
+    item.digits   = 0;
+    item.exponent = 0;
+    item.scale    = 0;
+    item.offset   = 0;
+    item.length   = 0;
+    return item;
+}
+
+
+unsigned int descriptor_integer(Scanner* const scanner)
+{
+    consume(scanner);
+    return integer(scanner);
+}
+
+
+void compile_real(Scanner* scanner, FormatItem* item, bool const has_exponent)
+{
+    item->width = descriptor_integer(scanner);
+    assert(item->width > 0);
+
+    if (match(scanner, '.'))
+    {
+        item->digits = descriptor_integer(scanner);
+    }
+
+    item->exponent = 0;
+    if (has_exponent && match(scanner, EXPONENTIAL_E))
+    {
+        item->exponent = descriptor_integer(scanner);
+        assert(item->exponent > 0);
+    }
+}
+
+
+void compile_str(Scanner* scanner, FormatLiterals& literals, 
+    FormatItem* item, char const opening)
+{
+    item->offset = literals.size();
+    for (;;)
+    {
+        if (is_at_end(scanner))
+        {
+            break;
+        }
+        char c = advance(scanner);
+        if (opening == c)
+        {
+            if (peek(scanner) != opening)
+            {
+                break;
+            }
+            // escaped quotation mark
+            advance(scanner);
+        }
+        literals.push_back(c);
+    }
+    item->length = literals.size() - item->offset;
+}
+
+
+void compile_h(Scanner* scanner, FormatLiterals& literals, 
+    FormatItem* item, size_t const length)
+{
+    item->offset = literals.size();
+    for (size_t count = 0; count < length && !is_at_end(scanner); ++count)
+    {
+        literals.push_back(advance(scanner));
+    }
+    item->length = literals.size() - item->offset;
+}
+
+
+void compile_group(Scanner* scanner, FormatItemList& items, 
+    FormatLiterals& literals)
+{
+    for (;;)
+    {
+        skip_whitespace(scanner);
+        consume(scanner);
+        if (is_at_end(scanner))
+        {
+            break;
+        }
+        char c = advance(scanner);
+
+        // repeat count, or scale factor (which may be signed or zero)
+        unsigned int repeat = 1;
+        int number = 0;
+        if (is_digit(c) || (('-' == c || '+' == c) && is_digit(peek(scanner))))
+        {
+            number = integer(scanner);
+            skip_whitespace(scanner);
+            c = advance(scanner);
+            if (c != 'P')
+            {
+                assert(number > 0);
+                repeat = number;
+            }
+        }
+
+        // nested group
+        if ('(' == c)
+        {
+            size_t const group = items.size();
+            items.push_back(make_item(FOP_GROUP, repeat));
+            compile_group(scanner, items, literals);
+            items[group].length = items.size() - group - 1;
+        }
+        // edit descriptors
+        else if (is_alpha(c))
+        {
+            FormatItem item = make_item(FOP_X, repeat);
+            switch(c)
+            {
+                case 'A':
+                    item.op = FOP_A;
+                    if (is_digit(peek(scanner)))
+                    {
+                        // if the user specify a width, it must be nonzero
+                        item.width = descriptor_integer(scanner);
+                        assert(item.width > 0);
+                    }
+                break;
+
+                case 'D':
+                    item.op = FOP_D;
+                    compile_real(scanner, &item, false);
+                break;
+
+                case 'E':
+                    item.op = FOP_E;
+                    compile_real(scanner, &item, true);
+                break;
+
+                case 'F':
+                    item.op = FOP_F;
+                    compile_real(scanner, &item, false);
+                break;
+
+                case 'G':
+                    item.op = FOP_G;
+                    compile_real(scanner, &item, true);
+                break;
+
+                case 'H':
+                    item.op = FOP_STR;
+                    item.repeat = 1;
+                    compile_h(scanner, literals, &item, repeat);
+                break;
+
+                case 'I':
+                    item.op = FOP_I;
+                    item.width = descriptor_integer(scanner);
+                    assert(item.width > 0);
+                    if (match(scanner, '.'))
+                    {
+                        item.digits = descriptor_integer(scanner);
+                    }
+                break;
+
+                case 'L':
+                    item.op = FOP_L;
+                    item.width = descriptor_integer(scanner);
+                    assert(item.width > 0);
+                break;
+
+                case 'S':
+                    item.op = FOP_SS;
+                    if (match(scanner, 'P'))
+                    {
+                        item.op = FOP_SP;
+                    }
+                    else
+                    {
+                        match(scanner, 'S');
+                    }
+                break;
+
+                case 'B':
+                    item.op = FOP_BN;
+                    if (match(scanner, 'Z'))
+                    {
+                        item.op = FOP_BZ;
+                    }
+                    else
+                    {
+                        match(scanner, 'N');
+                    }
+                break;
+
+                case 'P':
+                    item.op = FOP_P;
+                    item.repeat = 1;
+                    item.scale = std::max(-FORMAT_MAX_SCALE, 
+                        std::min(number, FORMAT_MAX_SCALE));
+                break;
+
+                case 'X':
+                break;
+
+                default:
+                    // unsupported edit descriptor
+                    continue;
+            }
+            items.push_back(item);
+        }
+        else if ('/' == c)
+        {
+            items.push_back(make_item(FOP_NL, repeat));
+        }
+        else if ('\'' == c || '"' == c)
+        {
+            FormatItem item = make_item(FOP_STR, 1);
+            compile_str(scanner, literals, &item, c);
+            items.push_back(item);
+        }
+        else if (')' == c)
+        {
+            break;
+        }
+    }
+}
+
+
+// compiles the format string, returning whether it's list-directed
+bool compile_format(char const* formatstr, FormatItemList& items, 
+    FormatLiterals& literals)
+{
+    Scanner scanner(formatstr);
+    skip_whitespace(&scanner);
+    if (match(&scanner, '('))
+    {
+        compile_group(&scanner, items, literals);
+    }
+    else if (match(&scanner, '*'))
+    {
+        return true;
+    }
+    return false;
+}
+
+
+FortranFormat::FortranFormat(char const* formatstr)
+    : list_directed_(false)
+{
+    this->list_directed_ = compile_format(formatstr, this->items_, 
+        this->literals_);
+}
+
+
+FortranFormat::FortranFormat(char const* formatstr, FormatArena& arena)
+    : items_(ArenaAllocator<FormatItem>(&arena)), 
+      literals_(ArenaAllocator<char>(&arena)), list_directed_(false)
+{
+    this->list_directed_ = compile_format(formatstr, this->items_, 
+        this->literals_);
+}
+
+
+//
+// Arguments
+//
+
+// Position in the list of arguments, array elements included
+struct ArgCursor
+{
+    FormatArg const* current;
+    FormatArg const* end;
+    // next element of the current array argument
+    size_t element;
+
+    ArgCursor(FormatArg const* const args, size_t const count)
+    {
+        this->current = args;
+        this->end     = args + count;
+        this->element = 0;
+    }
+};
+
+
+// whether any item remains
+bool has_arg(ArgCursor* const args)
+{
+    // skip exhausted (or empty) arrays
+    while (args->current < args->end && args->current->type == FARG_ARRAY &&
+        args->element == args->current->array.length)
+    {
+        args->current = args->current + 1;
+        args->element = 0;
+    }
+    return args->current < args->end;
+}
+
+
+FormatArg next_arg(ArgCursor* const args)
+{
+    // checked with has_arg first
+    bool const available = has_arg(args);
+    assert(available);
+    (void)available;
+
+    FormatArg const& arg = *args->current;
+    if (arg.type != FARG_ARRAY)
+    {
+        args->current = args->current + 1;
+        return arg;
+    }
+    FormatArg const value = arg.array.element(arg.array.data, args->element);
+    args->element = args->element + 1;
+    return value;
+}
+
+
+long long arg_integer(FormatArg const& arg)
+{
+    switch (arg.type)
+    {
+        case FARG_INT:
+        case FARG_INT64:
+            return arg.integer;
+        case FARG_UINT:
+        case FARG_UINT64:
+            return static_cast<long long>(arg.unsigned_integer);
+        case FARG_DOUBLE:
+        case FARG_FLOAT:
+            return static_cast<long long>(arg.real);
+        case FARG_BOOL:
+            return arg.logical;
+        default:
+            return 0;
+    }
+}
+
+
+double arg_real(FormatArg const& arg)
+{
+    switch (arg.type)
+    {
+        case FARG_INT:
+        case FARG_INT64:
+            return static_cast<double>(arg.integer);
+        case FARG_UINT:
+        case FARG_UINT64:
+            return static_cast<double>(arg.unsigned_integer);
+        case FARG_DOUBLE:
+        case FARG_FLOAT:
+            return arg.real;
+        case FARG_BOOL:
+            return arg.logical;
+        default:
+            return 0.0;
+    }
+}
+
+
+bool arg_logical(FormatArg const& arg)
+{
+    switch (arg.type)
+    {
+        case FARG_BOOL:
+            return arg.logical;
+        default:
+            return arg_integer(arg) != 0;
+    }
+}
+
+
+//
+// Sinks
+//
+
+FormatSink::FormatSink(size_t const capacity)
+    : storage_(capacity), buffer_(storage_.data()), capacity_(capacity), 
+      size_(0)
+{
+    assert(capacity > 1);
+}
+
+
+FormatSink::FormatSink(char* const buffer, size_t const capacity)
+    : buffer_(buffer), capacity_(capacity), size_(0)
+{
+    assert(capacity > 1);
+}
+
+
+FormatSink::~FormatSink()
+{
+}
+
+
+void FormatSink::write(char const* const data, size_t const size)
+{
+    if (this->size_ + size <= this->capacity_)
+    {
+        memcpy(this->buffer_ + this->size_, data, size);
+        this->size_ = this->size_ + size;
+    }
+    else if (size >= this->capacity_ / 2)
+    {
+        // no point in copying it through the buffer
+        this->write_through(this->buffer_, this->size_, data, size);
+        this->size_ = 0;
+    }
+    else
+    {
+        this->flush();
+        memcpy(this->buffer_, data, size);
+        this->size_ = size;
+    }
+}
+
+
+void FormatSink::put(char const c)
+{
+    if (this->size_ == this->capacity_)
+    {
+        this->flush();
+    }
+    this->buffer_[this->size_] = c;
+    this->size_ = this->size_ + 1;
+}
+
+
+void FormatSink::flush()
+{
+    if (this->size_ > 0)
+    {
+        this->write_out(this->buffer_, this->size_);
+        this->size_ = 0;
+    }
+}
+
+
+void FormatSink::write_through(char const* const buffered, 
+    size_t const buffered_size, char const* const data, size_t const size)
+{
+    if (buffered_size > 0)
+    {
+        this->write_out(buffered, buffered_size);
+    }
+    this->write_out(data, size);
+}
+
+
+FdSink::FdSink(int const fd, size_t const capacity)
+    : FormatSink(capacity), fd_(fd), error_(0)
+{
+}
+
+
+FdSink::~FdSink()
+{
+    this->flush();
+}
+
+
+void FdSink::write_out(char const* data, size_t size)
+{
+    while (size > 0 && 0 == this->error_)
+    {
+#ifdef _WIN32
+        int const written = _write(this->fd_, data, 
+            static_cast<unsigned int>(std::min(size, size_t(1) << 30)));
+#else
+        ssize_t const written = ::write(this->fd_, data, size);
+#endif
+        if (written < 0)
+        {
+            if (errno != EINTR)
+            {
+                this->error_ = errno;
+            }
+            continue;
+        }
+        data = data + written;
+        size = size - written;
+    }
+}
+
+
+void FdSink::write_through(char const* const buffered, 
+    size_t const buffered_size, char const* const data, size_t const size)
+{
+#ifdef _WIN32
+    FormatSink::write_through(buffered, buffered_size, data, size);
+#else
+    // a single system call for both, as long as it writes everything
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<char*>(buffered);
+    iov[0].iov_len  = buffered_size;
+    iov[1].iov_base = const_cast<char*>(data);
+    iov[1].iov_len  = size;
+
+    ssize_t written = -1;
+    while (0 == this->error_)
+    {
+        written = ::writev(this->fd_, iov, 2);
+        if (written >= 0)
+        {
+            break;
+        }
+        if (errno != EINTR)
+        {
+            this->error_ = errno;
+        }
+    }
+    if (written < 0)
+    {
+        return;
+    }
+
+    // partial write
+    size_t const done = written;
+    if (done < buffered_size)
+    {
+        this->write_out(buffered + done, buffered_size - done);
+        this->write_out(data, size);
+    }
+    else
+    {
+        this->write_out(data + (done - buffered_size), 
+            size - (done - buffered_size));
+    }
+#endif
+}
+
+
+// Sink of records written to a stream
+class StreamSink : public FormatSink
+{
+public:
+    StreamSink(ostream& stream, char* const buffer, size_t const capacity)
+        : FormatSink(buffer, capacity), stream_(stream)
+    {
+    }
+
+protected:
+    void write_out(char const* data, size_t size)
+    {
+        this->stream_.write(data, size);
+    }
+
+private:
+    ostream& stream_;
+};
+
+
+//
+// Output
+//
+
+// Region the edit descriptors write into. Fields are formatted in place, 
+// without intermediate copies. When writing to a sink, the region is the
+// sink's buffer, written out when full; otherwise, once a field doesn't fit
+// in the caller's buffer, the following ones are only counted. A field 
+// wider than the sink's buffer is formatted in a region of its width.
+struct Output
+{
+    char* start;
+    char* pos;
+    char* end;
+    // characters that didn't fit
+    size_t overflow;
+    FormatSink* sink;
+    std::vector<char> wide;
+
+    Output(char* const buffer, size_t const size)
+    {
+        this->start    = buffer;
+        this->pos      = buffer;
+        this->end      = buffer + size;
+        this->overflow = 0;
+        this->sink     = NULL;
+    }
+
+    explicit Output(FormatSink* const sink)
+    {
+        this->start    = sink->data();
+        this->pos      = this->start + sink->size();
+        this->end      = this->start + sink->capacity();
+        this->overflow = 0;
+        this->sink     = sink;
+    }
+};
+
+
+// hands the written characters over to the sink
+void finish_output(Output* const out)
+{
+    if (out->sink != NULL)
+    {
+        out->sink->resize(out->pos - out->start);
+    }
+}
+
+
+void flush_output(Output* const out)
+{
+    if (out->sink != NULL && out->pos > out->start)
+    {
+        finish_output(out);
+        out->sink->flush();
+        out->pos = out->start;
+    }
+}
+
+
+// room for size characters and a trailing NUL, or NULL when they don't fit
+// in the caller's buffer
+char* reserve(Output* const out, size_t const size)
+{
+    if (out->overflow > 0)
+    {
+        return NULL;
+    }
+    if (static_cast<size_t>(out->end - out->pos) > size)
+    {
+        return out->pos;
+    }
+    if (NULL == out->sink)
+    {
+        return NULL;
+    }
+    flush_output(out);
+    if (static_cast<size_t>(out->end - out->pos) > size)
+    {
+        return out->pos;
+    }
+    out->wide.resize(size + 1);
+    return out->wide.data();
+}
+
+
+void put_chars(Output* const out, char const* value, size_t length);
+
+
+void commit(Output* const out, char const* const put, size_t const size)
+{
+    if (NULL == put)
+    {
+        out->overflow = out->overflow + size;
+    }
+    else if (put == out->wide.data())
+    {
+        put_chars(out, put, size);
+    }
+    else
+    {
+        out->pos = out->pos + size;
+    }
+}
+
+
+void put_chars(Output* const out, char const* value, size_t length)
+{
+    if (out->sink != NULL && length >= out->sink->capacity() / 2)
+    {
+        // large strings skip the buffer
+        finish_output(out);
+        out->sink->write(value, length);
+        out->pos = out->start + out->sink->size();
+        return;
+    }
+    while (length > 0)
+    {
+        size_t chunk = length;
+        size_t const room = out->end - out->pos;
+        if (chunk >= room && out->sink != NULL)
+        {
+            flush_output(out);
+            chunk = std::min(length, static_cast<size_t>(out->end - out->pos) - 1);
+        }
+        char* put = reserve(out, chunk);
+        if (put != NULL)
+        {
+            memcpy(put, value, chunk);
+        }
+        commit(out, put, chunk);
+
+        value  = value + chunk;
+        length = length - chunk;
+    }
+}
+
+
+void put_fill(Output* const out, char const fill, size_t length)
+{
+    while (length > 0)
+    {
+        size_t chunk = length;
+        size_t const room = out->end - out->pos;
+        if (chunk >= room && out->sink != NULL)
+        {
+            flush_output(out);
+            chunk = std::min(length, static_cast<size_t>(out->end - out->pos) - 1);
+        }
+        char* put = reserve(out, chunk);
+        if (put != NULL)
+        {
+            fill_with_char(put, fill, chunk);
+        }
+        commit(out, put, chunk);
+
+        length = length - chunk;
+    }
+}
+
+
+// right-aligned value in a field of width characters
+void put_field(Output* const out, char const* value, size_t const length, 
+    size_t const width)
+{
+    size_t const blanks = width > length ? width - length : 0;
+    size_t const chars  = width - blanks;
+
+    if (out->sink != NULL && width >= out->sink->capacity() / 2)
+    {
+        // wide fields skip the buffer, like large strings
+        put_fill(out, ' ', blanks);
+        put_chars(out, value, chars);
+        return;
+    }
+    char* put = reserve(out, width);
+    if (put != NULL)
+    {
+        fill_with_char(put, ' ', blanks);
+        memcpy(put + blanks, value, chars);
+    }
+    commit(out, put, width);
+}
+
+
+//
+// List-directed writing
+//
+// The layout of gfortran: every value but a string following another one
+// is preceded by a blank, and numbers take fields wide enough for their 
+// kind, reals with the digits that tell them apart. The record isn't split
+// in lines.
+//
+
+// integer fields, of 32-bit and of 64-bit integers
+size_t const LIST_INT_WIDTH  = 12;
+size_t const LIST_LONG_WIDTH = 21;
+
+// double fields, significant digits and exponent digits
+size_t const LIST_DOUBLE_WIDTH    = 25;
+size_t const LIST_DOUBLE_DIGITS   = 17;
+size_t const LIST_DOUBLE_EXPONENT = 3;
+
+// float fields
+size_t const LIST_FLOAT_WIDTH    = 16;
+size_t const LIST_FLOAT_DIGITS   = 9;
+size_t const LIST_FLOAT_EXPONENT = 2;
+
+
+void write_list_integer(Output* const out, FormatArg const& arg)
+{
+    // by type, as gfortran does for integer(4) and integer(8)
+    bool const is_long = FARG_INT64 == arg.type || FARG_UINT64 == arg.type;
+    bool const is_unsigned = FARG_UINT == arg.type || FARG_UINT64 == arg.type;
+    size_t const width = is_long ? LIST_LONG_WIDTH : LIST_INT_WIDTH;
+
+    char* put = reserve(out, width);
+    if (put != NULL && is_unsigned)
+    {
+        format_u(put, arg.unsigned_integer, width, 1, false);
+    }
+    else if (put != NULL)
+    {
+        format_i(put, arg.integer, width, 1, false);
+    }
+    commit(out, put, width);
+}
+
+
+void write_list_real(Output* const out, FormatArg const& arg)
+{
+    bool const is_float = FARG_FLOAT == arg.type;
+    size_t const width = is_float ? LIST_FLOAT_WIDTH : LIST_DOUBLE_WIDTH;
+
+    put_fill(out, ' ', 1);
+    char* put = reserve(out, width);
+    if (put != NULL && is_float)
+    {
+        format_list_real(put, arg.real, width, LIST_FLOAT_DIGITS, 
+            LIST_FLOAT_EXPONENT);
+    }
+    else if (put != NULL)
+    {
+        format_list_real(put, arg.real, width, LIST_DOUBLE_DIGITS, 
+            LIST_DOUBLE_EXPONENT);
+    }
+    commit(out, put, width);
+}
+
+
+void write_list(Output* out, FormatArg const* args, size_t const count)
+{
+    ArgCursor cursor(args, count);
+    bool after_string = false;
+    while (has_arg(&cursor))
+    {
+        FormatArg const arg = next_arg(&cursor);
+        switch (arg.type)
+        {
+            case FARG_INT:
+            case FARG_UINT:
+            case FARG_INT64:
+            case FARG_UINT64:
+                write_list_integer(out, arg);
+            break;
+
+            case FARG_DOUBLE:
+            case FARG_FLOAT:
+                write_list_real(out, arg);
+            break;
+
+            case FARG_BOOL:
+                put_chars(out, arg.logical ? " T" : " F", 2);
+            break;
+
+            case FARG_STRING:
+                if (!after_string)
+                {
+                    put_fill(out, ' ', 1);
+                }
+                put_chars(out, arg.string.data, arg.string.length);
+            break;
+
+            case FARG_ARRAY:
+            break;
+        }
+        after_string = FARG_STRING == arg.type;
+    }
+}
+
+
+//
+// Format write edit descriptors
+//
+// Data edit descriptors return false when there are no items left for them,
+// which terminates the format control. An item of the wrong type (a string
+// for a numeric or logical descriptor, anything else for A) fills the field
+// with asterisks, as a value that doesn't fit it.
+//
+
+void write_mismatch(Output* out, size_t const width)
+{
+    put_fill(out, OVERFLOW_FILL_CHAR, width > 0 ? width : 1);
+}
+
+
+bool write_i(Output* out, FormatItem const& item, ArgCursor* args, 
+    bool const plus_sign)
+{
+    // pop arg value(s)
+    for (size_t repcount = 0; repcount < item.repeat; ++repcount)
+    {
+        if (!has_arg(args))
+        {
+            return false;
+        }
+        FormatArg const arg = next_arg(args);
+        if (FARG_STRING == arg.type)
+        {
+            write_mismatch(out, item.width);
+            continue;
+        }
+        char* put = reserve(out, item.width);
+
+        if (put != NULL && (FARG_UINT == arg.type || 
+            FARG_UINT64 == arg.type))
+        {
+            format_u(put, arg.unsigned_integer, item.width, item.digits, 
+                plus_sign);
+        }
+        else if (put != NULL)
+        {
+            format_i(put, arg_integer(arg), item.width, item.digits, 
+                plus_sign);
+        }
+        commit(out, put, item.width);
+    }
+    return true;
+}
+
+
+bool write_f(Output* out, FormatItem const& item, ArgCursor* args, 
+    int const scale, bool const plus_sign)
+{
+    // pop arg value(s)
+    for (size_t repcount = 0; repcount < item.repeat; ++repcount)
+    {
+        if (!has_arg(args))
+        {
+            return false;
+        }
+        FormatArg const arg = next_arg(args);
+        if (FARG_STRING == arg.type)
+        {
+            write_mismatch(out, item.width);
+            continue;
+        }
+        double value = arg_real(arg); 
+        char* put = reserve(out, item.width);
+
+        if (put != NULL)
+        {
+            format_f(put, value, item.width, item.digits, scale, plus_sign);
+        }
+        commit(out, put, item.width);
+    }
+    return true;
+}
+
+
+bool write_e(Output* out, FormatItem const& item, ArgCursor* args, 
+    char const expchar, int const scale, bool const plus_sign)
+{
+    // pop arg value(s)
+    for (size_t repcount = 0; repcount < item.repeat; ++repcount)
+    {
+        if (!has_arg(args))
+        {
+            return false;
+        }
+        FormatArg const arg = next_arg(args);
+        if (FARG_STRING == arg.type)
+        {
+            write_mismatch(out, item.width);
+            continue;
+        }
+        double value = arg_real(arg); 
+        char* put = reserve(out, item.width);
+
+        if (put != NULL)
+        {
+            format_e(put, value, item.width, item.digits, expchar, 
+                item.exponent, scale, plus_sign);
+        }
+        commit(out, put, item.width);
+    }
+    return true;
+}
+
+
+bool write_g(Output* out, FormatItem const& item, ArgCursor* args, 
+    int const scale, bool const plus_sign)
+{
+    // pop arg value(s)
+    for (size_t repcount = 0; repcount < item.repeat; ++repcount)
+    {
+        if (!has_arg(args))
+        {
+            return false;
+        }
+        FormatArg const arg = next_arg(args);
+        if (FARG_STRING == arg.type)
+        {
+            write_mismatch(out, item.width);
+            continue;
+        }
+        double value = arg_real(arg); 
+        char* put = reserve(out, item.width);
+
+        if (put != NULL)
+        {
+            format_g(put, value, item.width, item.digits, item.exponent, 
+                scale, plus_sign);
+        }
+        commit(out, put, item.width);
+    }
+    return true;
+}
+
+
+bool write_l(Output* out, FormatItem const& item, ArgCursor* args)
+{
+    // pop arg value(s)
+    for (size_t repcount = 0; repcount < item.repeat; ++repcount)
+    {
+        if (!has_arg(args))
+        {
+            return false;
+        }
+        FormatArg const arg = next_arg(args);
+        if (FARG_STRING == arg.type)
+        {
+            write_mismatch(out, item.width);
+            continue;
+        }
+        bool value = arg_logical(arg);
+
+        if (value)
+        {
+            put_field(out, &FORTRAN_TRUE, 1, item.width);
+        }
+        else
+        {
+            put_field(out, &FORTRAN_FALSE, 1, item.width);
+        }
+    }
+    return true;
+}
+
+
+bool write_a(Output* out, FormatItem const& item, ArgCursor* args)
+{
+    size_t const width = item.width;
+
+    // pop arg value(s)
+    for (size_t repcount = 0; repcount < item.repeat; ++repcount)
+    {
+        if (!has_arg(args))
+        {
+            return false;
+        }
+        FormatArg const arg = next_arg(args);
+        if (arg.type != FARG_STRING)
+        {
+            write_mismatch(out, width);
+            continue;
+        }
+        FormatArg::String value = arg.string; 
+
+        if (width > 0)
+        {
+            put_field(out, value.data, value.length, width);
+        }
+        else
+        {
+            put_chars(out, value.data, value.length);
+        }
+    }
+    return true;
+}
+
+
+void write_x(Output* out, FormatItem const& item)
+{
+    // print whitespace
+    put_fill(out, ' ', item.repeat);
+}
+
+
+void write_str(Output* out, FortranFormat const& format, 
+    FormatItem const& item)
+{
+    // print user string
+    put_chars(out, format.literals().data() + item.offset, item.length);
+}
+
+
+void write_nl(Output* out, FormatItem const& item)
+{
+    put_fill(out, '\n', item.repeat);
+}
+
+
+// Modes set by edit descriptors for the following ones, which spill out of
+// groups and over records
+struct EditMode
+{
+    // force optional plus sign for I, F, D, E, G descriptors (SP, SS)
+    bool plus_sign;
+    // scale factor of F, D, E, G descriptors (kP)
+    int scale;
+
+    EditMode() : plus_sign(false), scale(0)
+    {
+    }
+};
+
+
+// Writes the items [first, last), returning false when the format control
+// terminates for lack of items. The edit modes are updated in mode.
+bool write_group(Output* out, FortranFormat const& format, 
+    size_t const first, size_t const last, ArgCursor* args, 
+    EditMode* mode)
+{
+    FormatItemList const& items = format.items();
+
+    bool& opt_plus_sign = mode->plus_sign;
+    bool more = true;
+
+    for (size_t n = first; n < last && more; ++n)
+    {
+        FormatItem const& item = items[n];
+        switch(item.op)
+        {
+            case FOP_GROUP:
+                for (size_t repcount = 0; repcount < item.repeat && more; 
+                    ++repcount)
+                {
+                    more = write_group(out, format, n + 1, 
+                        n + 1 + item.length, args, mode);
+                }
+                n = n + item.length;
+            break;
+
+            case FOP_A:
+                more = write_a(out, item, args);
+            break;
+
+            case FOP_D:
+                more = write_e(out, item, args, EXPONENTIAL_D, mode->scale,
+                    opt_plus_sign);
+            break;
+
+            case FOP_E:
+                more = write_e(out, item, args, EXPONENTIAL_E, mode->scale,
+                    opt_plus_sign);
+            break;
+
+            case FOP_F:
+                more = write_f(out, item, args, mode->scale, opt_plus_sign);
+            break;
+
+            case FOP_G:
+                more = write_g(out, item, args, mode->scale, opt_plus_sign);
+            break;
+
+            case FOP_I:
+                more = write_i(out, item, args, opt_plus_sign);
+            break;
+
+            case FOP_L:
+                more = write_l(out, item, args);
+            break;
+
+            case FOP_SP:
+                opt_plus_sign = true;
+            break;
+
+            case FOP_SS:
+                opt_plus_sign = false;
+            break;
+
+            case FOP_P:
+                mode->scale = item.scale;
+            break;
+
+            case FOP_BN:
+            case FOP_BZ:
+            break;
+
+            case FOP_X:
+                write_x(out, item); 
+            break;
+
+            case FOP_STR:
+                write_str(out, format, item); 
+            break;
+
+            case FOP_NL:
+                write_nl(out, item); 
+            break;
+        }
+    }
+
+    return more;
+}
+
+
+// number of items taken by a pass over items [first, last)
+size_t count_items(FormatItemList const& items, size_t const first, 
+    size_t const last)
+{
+    size_t count = 0;
+    for (size_t n = first; n < last; ++n)
+    {
+        FormatItem const& item = items[n];
+        if (item.op == FOP_GROUP)
+        {
+            count = count + item.repeat * 
+                count_items(items, n + 1, n + 1 + item.length);
+            n = n + item.length;
+        }
+        else if (item.op <= FOP_A)
+        {
+            count = count + item.repeat;
+        }
+    }
+    return count;
+}
+
+
+// index of the rightmost top-level group, where format control reverts to 
+// when the items outlast the format; the whole format without groups
+size_t reversion_point(FortranFormat const& format)
+{
+    FormatItemList const& items = format.items();
+
+    size_t reversion = 0;
+    for (size_t n = 0; n < items.size(); ++n)
+    {
+        if (items[n].op == FOP_GROUP)
+        {
+            reversion = n;
+            n = n + items[n].length;
+        }
+    }
+    return reversion;
+}
+
+
+void write_record(Output* out, FortranFormat const& format, 
+    FormatArg const* args, size_t const count)
+{
+    if (format.list_directed())
+    {
+        write_list(out, args, count);
+        return;
+    }
+
+    EditMode mode;
+    size_t const last = format.items().size();
+
+    ArgCursor cursor(args, count);
+    if (!write_group(out, format, 0, last, &cursor, &mode))
+    {
+        return;
+    }
+
+    // format reversion: a new record for the remaining items, which are
+    // ignored without data edit descriptors to take them
+    size_t const reversion = reversion_point(format);
+    if (0 == count_items(format.items(), reversion, last))
+    {
+        return;
+    }
+    while (has_arg(&cursor))
+    {
+        put_chars(out, "\n", 1);
+        if (!write_group(out, format, reversion, last, &cursor, &mode))
+        {
+            return;
+        }
+    }
+}
+
+
+void format_printfor(FormatSink& sink, FortranFormat const& format, 
+    FormatArg const* args, size_t const count)
+{
+    Output out(&sink);
+
+    write_record(&out, format, args, count);
+    put_chars(&out, "\n", 1);
+    finish_output(&out);
+}
+
+
+void format_printfor(ostream& stream, FortranFormat const& format, 
+    FormatArg const* args, size_t const count)
+{
+    // the whole record is written to the stream at once, when it fits
+    char buffer[STREAM_BUFFER_SIZE];
+    StreamSink sink(stream, buffer, STREAM_BUFFER_SIZE);
+
+    format_printfor(sink, format, args, count);
+    sink.flush();
+}
+
+
+size_t format_to_buffer(char* dst, size_t const size, 
+    FortranFormat const& format, FormatArg const* args, size_t const count)
+{
+    Output out(dst, size);
+
+    write_record(&out, format, args, count);
+    if (size > 0)
+    {
+        *out.pos = '\0';
+    }
+    return (out.pos - out.start) + out.overflow;
+}
+
+
+//
+// Parallel writing
+//
+// Every pass over the format takes a fixed number of items, so the records
+// of an array argument can be split in blocks formatted independently. 
+// Workers take blocks in order and format each into its own buffer; the 
+// calling thread writes the buffers out in order, with a bounded number of
+// them in flight.
+//
+
+// records (at least one) formatted at once by a worker
+size_t const PARALLEL_BLOCK_ITEMS = 16384;
+
+// formatted blocks waiting to be written, per worker
+size_t const PARALLEL_BLOCKS_PER_WORKER = 4;
+
+
+// lines taken by a pass over items [first, last)
+size_t count_lines(FormatItemList const& items, size_t const first, 
+    size_t const last)
+{
+    size_t count = 0;
+    for (size_t n = first; n < last; ++n)
+    {
+        FormatItem const& item = items[n];
+        if (item.op == FOP_GROUP)
+        {
+            count = count + item.repeat * 
+                count_lines(items, n + 1, n + 1 + item.length);
+            n = n + item.length;
+        }
+        else if (item.op == FOP_NL)
+        {
+            count = count + item.repeat;
+        }
+    }
+    return count;
+}
+
+
+// edit modes after a complete pass over items [first, last)
+EditMode pass_edit_mode(FormatItemList const& items, size_t const first,
+    size_t const last, EditMode mode)
+{
+    for (size_t n = first; n < last; ++n)
+    {
+        if (items[n].op == FOP_SP)
+        {
+            mode.plus_sign = true;
+        }
+        else if (items[n].op == FOP_SS)
+        {
+            mode.plus_sign = false;
+        }
+        else if (items[n].op == FOP_P)
+        {
+            mode.scale = items[n].scale;
+        }
+        else if (items[n].op == FOP_GROUP && 0 == items[n].repeat)
+        {
+            n = n + items[n].length;
+        }
+    }
+    return mode;
+}
+
+
+// Records [first, last) of the array, each followed by a new line
+struct ParallelBlock
+{
+    size_t first;
+    size_t last;
+    bool ready;
+    std::string output;
+};
+
+
+// Sink appending to the output of a block
+class BlockSink : public FormatSink
+{
+public:
+    BlockSink(std::string* const str, size_t const capacity)
+        : FormatSink(capacity), str_(str)
+    {
+    }
+
+protected:
+    void write_out(char const* data, size_t size)
+    {
+        this->str_->append(data, size);
+    }
+
+private:
+    std::string* str_;
+};
+
+
+// Shared state of a parallel write
+struct ParallelWrite
+{
+    FortranFormat const* format;
+    FormatArg const* values;
+    // items taken by the first record and by each following one
+    size_t first_items;
+    size_t record_items;
+    size_t reversion;
+    // edit modes at the start of the second record and of the following ones
+    EditMode second_mode;
+    EditMode mode;
+
+    size_t records;
+    size_t block_records;
+    size_t blocks;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    // next block to format and to write out
+    size_t next_block;
+    size_t written_blocks;
+    std::vector<ParallelBlock> slots;
+};
+
+
+void format_block(ParallelWrite* const job, ParallelBlock* const block)
+{
+    FortranFormat const& format = *job->format;
+    size_t const last = format.items().size();
+
+    BlockSink sink(&block->output, STREAM_BUFFER_SIZE * 16);
+    Output out(&sink);
+
+    FormatArg values = *job->values;
+    ArgCursor cursor(&values, 1);
+    for (size_t record = block->first; record < block->last; ++record)
+    {
+        EditMode mode;
+        if (0 == record)
+        {
+            values.array.length = std::min(values.array.length, 
+                job->first_items);
+            write_group(&out, format, 0, last, &cursor, &mode);
+        }
+        else
+        {
+            mode = 1 == record ? job->second_mode : job->mode;
+            cursor.current = &values;
+            cursor.element = job->first_items + (record - 1) * job->record_items;
+            values.array.length = std::min(job->values->array.length, 
+                cursor.element + job->record_items);
+            write_group(&out, format, job->reversion, last, &cursor, &mode);
+        }
+        put_chars(&out, "\n", 1);
+    }
+    finish_output(&out);
+    sink.flush();
+}
+
+
+void parallel_worker(ParallelWrite* const job)
+{
+    std::unique_lock<std::mutex> lock(job->mutex);
+    while (job->next_block < job->blocks)
+    {
+        // wait for a free slot
+        size_t const index = job->next_block;
+        if (index >= job->written_blocks + job->slots.size())
+        {
+            job->changed.wait(lock);
+            continue;
+        }
+        job->next_block = index + 1;
+        ParallelBlock* const block = &job->slots[index % job->slots.size()];
+        block->first = index * job->block_records;
+        block->last = std::min(job->records, block->first + job->block_records);
+        block->output.clear();
+
+        lock.unlock();
+        format_block(job, block);
+        lock.lock();
+
+        block->ready = true;
+        job->changed.notify_all();
+    }
+}
+
+
+void format_parallel(FormatSink& sink, FortranFormat const& format, 
+    FormatArg const& values, unsigned int threads)
+{
+    FormatItemList const& items = format.items();
+
+    ParallelWrite job;
+    job.format = &format;
+    job.values = &values;
+    job.reversion = reversion_point(format);
+    job.first_items = count_items(items, 0, items.size());
+    job.record_items = count_items(items, job.reversion, items.size());
+
+    if (0 == threads)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (values.type != FARG_ARRAY || threads < 2 || 0 == job.first_items ||
+        0 == job.record_items)
+    {
+        format_printfor(sink, format, &values, 1);
+        return;
+    }
+
+    size_t const length = values.array.length;
+    job.records = length <= job.first_items ? 1 :
+        1 + (length - job.first_items + job.record_items - 1) / job.record_items;
+    job.second_mode = pass_edit_mode(items, 0, items.size(), EditMode());
+    job.mode = pass_edit_mode(items, job.reversion, items.size(), 
+        job.second_mode);
+    job.block_records = std::max(size_t(1), 
+        PARALLEL_BLOCK_ITEMS / job.record_items);
+    job.blocks = (job.records + job.block_records - 1) / job.block_records;
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, job.blocks));
+    job.next_block = 0;
+    job.written_blocks = 0;
+    job.slots.resize(threads * PARALLEL_BLOCKS_PER_WORKER);
+
+    std::vector<std::thread> workers;
+    for (unsigned int n = 0; n < threads; ++n)
+    {
+        workers.push_back(std::thread(parallel_worker, &job));
+    }
+
+    // write the blocks out in order
+    std::unique_lock<std::mutex> lock(job.mutex);
+    while (job.written_blocks < job.blocks)
+    {
+        ParallelBlock* const block = 
+            &job.slots[job.written_blocks % job.slots.size()];
+        if (!block->ready)
+        {
+            job.changed.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        sink.write(block->output.data(), block->output.size());
+        lock.lock();
+
+        block->ready = false;
+        job.written_blocks = job.written_blocks + 1;
+        job.changed.notify_all();
+    }
+    lock.unlock();
+
+    for (size_t n = 0; n < workers.size(); ++n)
+    {
+        workers[n].join();
+    }
+}
+
+
+//
+// Reading
+//
+// Records are read one at a time (a line of the stream or of the buffer, 
+// without its new line) and fields are decoded in place from their columns.
+// A record shorter than the format is padded with blanks, as with Fortran's
+// default PAD='YES'.
+//
+
+// significant digits kept when decoding a real number; beyond them, only
+// whether a nonzero digit was dropped matters for rounding
+size_t const MAX_INPUT_DIGITS = 800;
+
+// significant digits that always fit an unsigned long long
+size_t const MAX_EXACT_DIGITS = 19;
+
+// stored mantissa bits, exponent bias and infinity's exponent of a double
+int const DOUBLE_MANTISSA = 52;
+int const DOUBLE_BIAS = 1023;
+int const DOUBLE_INFINITE_EXPONENT = 0x7FF;
+
+// decimal exponents are clamped to this magnitude while they're read
+long const MAX_DECIMAL_EXPONENT = 100000;
+
+// powers of ten exactly representable as a double
+double const POW10_DOUBLE[] = { 
+    1E0,  1E1,  1E2,  1E3,  1E4,  1E5,  1E6,  1E7,  1E8,  1E9,  1E10, 1E11, 
+    1E12, 1E13, 1E14, 1E15, 1E16, 1E17, 1E18, 1E19, 1E20, 1E21, 1E22 };
+
+
+struct Input
+{
+    // current record
+    char const* record;
+    size_t length;
+    size_t column;
+    // records read so far
+    size_t records;
+    // remaining records of a buffer, unused with a stream
+    char const* next;
+    char const* end;
+    // stream records are read into line
+    std::istream* stream;
+    std::string* line;
+    // the lines of an indexed buffer are taken from the index, from 
+    // index_line on
+    RecordIndex const* index;
+    size_t index_line;
+    // blanks in numeric fields are zeroes (BZ) or ignored (BN)
+    bool blank_zero;
+    // scale factor (kP) of real fields without an exponent
+    int scale;
+    // list-directed reading ends with the first record, as when every line
+    // is a record
+    bool single_record;
+    // set on an invalid field or when there are no records left
+    bool failed;
+
+    Input(char const* const src, size_t const size)
+    {
+        this->record  = src;
+        this->length  = 0;
+        this->column  = 0;
+        this->records = 0;
+        this->next    = src;
+        this->end     = src + size;
+        this->stream  = NULL;
+        this->line    = NULL;
+        this->index   = NULL;
+        this->index_line = 0;
+        this->blank_zero = false;
+        this->scale   = 0;
+        this->single_record = false;
+        this->failed  = false;
+    }
+
+    Input(RecordIndex const& index, size_t const line)
+    {
+        size_t const start = std::min(index.size(), 
+            index.starts()[std::min(line, index.lines())]);
+        this->record  = index.data() + start;
+        this->length  = 0;
+        this->column  = 0;
+        this->records = 0;
+        this->next    = index.data() + start;
+        this->end     = index.data() + index.size();
+        this->stream  = NULL;
+        this->line    = NULL;
+        this->index   = &index;
+        this->index_line = line;
+        this->blank_zero = false;
+        this->scale   = 0;
+        this->single_record = false;
+        this->failed  = false;
+    }
+
+    Input(std::istream& stream, std::string& line)
+    {
+        this->record  = NULL;
+        this->length  = 0;
+        this->column  = 0;
+        this->records = 0;
+        this->next    = NULL;
+        this->end     = NULL;
+        this->stream  = &stream;
+        this->line    = &line;
+        this->index   = NULL;
+        this->index_line = 0;
+        this->blank_zero = false;
+        this->scale   = 0;
+        this->single_record = false;
+        this->failed  = false;
+    }
+};
+
+
+// moves to the next record, failing when there is none
+bool read_record(Input* const in)
+{
+    if (in->stream != NULL)
+    {
+        if (!std::getline(*in->stream, *in->line))
+        {
+            in->failed = true;
+            return false;
+        }
+        in->record = in->line->data();
+        in->length = in->line->size();
+    }
+    else if (in->index != NULL)
+    {
+        if (in->index_line >= in->index->lines())
+        {
+            in->failed = true;
+            return false;
+        }
+        // with its carriage return, if any
+        std::vector<size_t> const& starts = in->index->starts();
+        size_t const start = starts[in->index_line];
+        in->record = in->index->data() + start;
+        in->length = starts[in->index_line + 1] - 1 - start;
+        in->next   = in->index->data() + 
+            std::min(starts[in->index_line + 1], in->index->size());
+        in->index_line = in->index_line + 1;
+    }
+    else
+    {
+        if (in->next >= in->end)
+        {
+            in->failed = true;
+            return false;
+        }
+        char const* const newline = static_cast<char const*>(
+            memchr(in->next, '\n', in->end - in->next));
+        in->record = in->next;
+        in->length = (newline != NULL ? newline : in->end) - in->next;
+        in->next   = newline != NULL ? newline + 1 : in->end;
+    }
+
+    // CRLF line endings
+    if (in->length > 0 && '\r' == in->record[in->length - 1])
+    {
+        in->length = in->length - 1;
+    }
+    in->column = 0;
+    in->records = in->records + 1;
+    return true;
+}
+
+
+// The next width columns of the record; returns how many of them are in the
+// record, the remaining ones being blanks
+size_t take_field(Input* const in, size_t const width, char const** field)
+{
+    size_t available = 0;
+    if (in->column < in->length)
+    {
+        available = std::min(width, in->length - in->column);
+    }
+    *field = in->record + std::min(in->column, in->length);
+    in->column = in->column + width;
+    return available;
+}
+
+
+// Position in the list of targets
+struct TargetCursor
+{
+    FormatTarget const* current;
+    FormatTarget const* end;
+
+    TargetCursor(FormatTarget const* const targets, size_t const count)
+    {
+        this->current = targets;
+        this->end     = targets + count;
+    }
+};
+
+
+bool has_target(TargetCursor const* const targets)
+{
+    return targets->current < targets->end;
+}
+
+
+//
+// Field decoding
+//
+
+// Integer field: blanks are ignored, or zeroes with BZ; an empty field is 
+// zero
+bool decode_integer(char const* field, size_t const length, 
+    bool const blank_zero, bool* negative, unsigned long long* magnitude)
+{
+    char const* const end = field + length;
+    *negative = false;
+    *magnitude = 0;
+
+    while (field < end && ' ' == *field)
+    {
+        ++field;
+    }
+    if (field < end && ('+' == *field || '-' == *field))
+    {
+        *negative = '-' == *field;
+        ++field;
+    }
+
+    unsigned long long value = 0;
+    unsigned long long const limit = ~0ULL / 10;
+    for (; field < end; ++field)
+    {
+        char c = *field;
+        if (' ' == c)
+        {
+            if (!blank_zero)
+            {
+                continue;
+            }
+            c = '0';
+        }
+        if (!is_digit(c))
+        {
+            return false;
+        }
+        unsigned int const digit = c - '0';
+        if (value > limit || (value == limit && digit > ~0ULL % 10))
+        {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    *magnitude = value;
+    return true;
+}
+
+
+//
+// Vectorized integer fields
+//
+// Right-justified integers (blanks, an optional sign and digits up to the 
+// end of the field) are decoded 16 columns at a time: a window holding the
+// field is shifted so that the field ends at its last byte, the bytes before
+// the field are made blanks, and the digits are classified with compares 
+// and summed with multiply-adds. Fields of other forms, or wider than 16 
+// columns, are decoded one character at a time by decode_integer.
+//
+
+// fields decoded by a call to decode_integer_fields
+size_t const INTEGER_BATCH = 16;
+
+// window of a vectorized field
+size_t const INTEGER_WINDOW = 16;
+
+
+// An integer field decoded by decode_integer_fields
+struct IntegerField
+{
+    unsigned long long magnitude;
+    bool negative;
+    bool valid;
+};
+
+
+enum IntegerDecoder
+{
+    INTEGER_DECODER_SCALAR,
+    INTEGER_DECODER_SSE41
+};
+
+
+// Whether the field, the last width bytes of a window of masks (bit n for 
+// byte n), is blanks, an optional sign and digits up to its end. Bytes 
+// before the field are blanks.
+inline bool is_simple_integer(unsigned int const digits, 
+    unsigned int const blanks, unsigned int const signs, size_t const width)
+{
+    unsigned int const field = 0xFFFFu & (0xFFFFu << (INTEGER_WINDOW - width));
+    unsigned int const lowest = digits & (0u - digits);
+    // a run of digits up to the end of the window
+    if (0 == digits || digits + lowest != 0x10000u)
+    {
+        return false;
+    }
+    unsigned int const leading = field & ~digits;
+    if (((blanks | signs) & leading) != leading)
+    {
+        return false;
+    }
+    // at most one sign, right before the digits
+    return 0 == signs || signs == (lowest >> 1);
+}
+
+
+#if FORTRANFORMAT_X86_SIMD
+
+// SHIFT_RIGHT + 16 - k: shuffle moving the bytes of a window k places to 
+// the right, zeroing the first k
+signed char const SHIFT_RIGHT[32] = {
+    -128, -128, -128, -128, -128, -128, -128, -128, 
+    -128, -128, -128, -128, -128, -128, -128, -128,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+// FIELD_MASK + width: the last width bytes of a window set
+signed char const FIELD_MASK[32] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+
+
+inline __attribute__((target("sse4.1")))
+void decode_field_sse41(char const* const window, size_t const offset, 
+    size_t const width, IntegerField* const field)
+{
+    size_t const shift = INTEGER_WINDOW - offset - width;
+    __m128i text = _mm_loadu_si128(reinterpret_cast<__m128i const*>(window));
+    text = _mm_shuffle_epi8(text, _mm_loadu_si128(
+        reinterpret_cast<__m128i const*>(SHIFT_RIGHT + 16 - shift)));
+    text = _mm_blendv_epi8(_mm_set1_epi8(' '), text, _mm_loadu_si128(
+        reinterpret_cast<__m128i const*>(FIELD_MASK + width)));
+
+    __m128i const values = _mm_sub_epi8(text, _mm_set1_epi8('0'));
+    __m128i const digits = _mm_cmpeq_epi8(_mm_min_epu8(values, 
+        _mm_set1_epi8(9)), values);
+    __m128i const minus = _mm_cmpeq_epi8(text, _mm_set1_epi8('-'));
+    __m128i const signs = _mm_or_si128(minus, 
+        _mm_cmpeq_epi8(text, _mm_set1_epi8('+')));
+    unsigned int const blank_mask = 
+        _mm_movemask_epi8(_mm_cmpeq_epi8(text, _mm_set1_epi8(' ')));
+    if (!is_simple_integer(_mm_movemask_epi8(digits), blank_mask, 
+        _mm_movemask_epi8(signs), width))
+    {
+        field->valid = false;
+        return;
+    }
+
+    // pairs, then groups of 4 and of 8 digits
+    __m128i const pairs = _mm_maddubs_epi16(_mm_and_si128(values, digits), 
+        _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    __m128i const quads = _mm_madd_epi16(pairs, 
+        _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    __m128i const octets = _mm_madd_epi16(_mm_packus_epi32(quads, quads), 
+        _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+    field->magnitude = 
+        static_cast<uint32_t>(_mm_cvtsi128_si32(octets)) * 100000000ULL + 
+        static_cast<uint32_t>(_mm_extract_epi32(octets, 1));
+    field->negative = _mm_movemask_epi8(minus) != 0;
+    field->valid = true;
+}
+
+
+// Window of field n, as an offset from begin: ending with the field, unless
+// that's before begin
+inline size_t field_window(size_t const size, size_t const first, 
+    size_t const width, size_t const n)
+{
+    size_t const end = first + (n + 1) * width;
+    return std::min(size - INTEGER_WINDOW, 
+        end >= INTEGER_WINDOW ? end - INTEGER_WINDOW : 0);
+}
+
+
+__attribute__((target("sse4.1")))
+void decode_batch_sse41(char const* const begin, size_t const size, 
+    size_t const first, size_t const width, size_t const count, 
+    IntegerField* const fields)
+{
+    for (size_t n = 0; n < count; ++n)
+    {
+        size_t const window = field_window(size, first, width, n);
+        decode_field_sse41(begin + window, first + n * width - window, width, 
+            fields + n);
+    }
+}
+
+#endif
+
+
+// whether the machine running has the decoder's instructions
+bool integer_decoder_supported(IntegerDecoder const decoder)
+{
+#if FORTRANFORMAT_X86_SIMD
+    switch (decoder)
+    {
+        case INTEGER_DECODER_SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        default:
+            return true;
+    }
+#else
+    return INTEGER_DECODER_SCALAR == decoder;
+#endif
+}
+
+
+// The decoder of I edits: SSE4.1 when available. Two fields per AVX2 
+// instruction measured slower, as building the vectors from two windows 
+// costs more than the second lane saves.
+IntegerDecoder best_integer_decoder()
+{
+    static IntegerDecoder const decoder = 
+        integer_decoder_supported(INTEGER_DECODER_SSE41) ? 
+        INTEGER_DECODER_SSE41 : INTEGER_DECODER_SCALAR;
+    return decoder;
+}
+
+
+// Decodes count fields of width columns, the first one at first, all of 
+// them within [begin, end), with the decoder's instructions when a window 
+// holding the field fits in [begin, end)
+void decode_integer_fields(IntegerDecoder const decoder, 
+    char const* const begin, char const* const end, char const* const first, 
+    size_t const width, size_t const count, bool const blank_zero, 
+    IntegerField* const fields)
+{
+    for (size_t n = 0; n < count; ++n)
+    {
+        fields[n].valid = false;
+    }
+
+#if FORTRANFORMAT_X86_SIMD
+    if (decoder != INTEGER_DECODER_SCALAR && width <= INTEGER_WINDOW && 
+        static_cast<size_t>(end - begin) >= INTEGER_WINDOW)
+    {
+        decode_batch_sse41(begin, end - begin, first - begin, width, count, 
+            fields);
+    }
+#else
+    (void)decoder;
+    (void)begin;
+    (void)end;
+#endif
+
+    // the others
+    for (size_t n = 0; n < count; ++n)
+    {
+        if (!fields[n].valid)
+        {
+            fields[n].valid = decode_integer(first + n * width, width, 
+                blank_zero, &fields[n].negative, &fields[n].magnitude);
+        }
+    }
+}
+
+
+enum DecimalKind
+{
+    DECIMAL_FINITE,
+    DECIMAL_INFINITY,
+    DECIMAL_NAN
+};
+
+
+// A real number as read: digits * 10^exponent, the digits being an integer 
+// without leading zeroes (none for zero)
+struct DecimalNumber
+{
+    DecimalKind kind;
+    bool negative;
+    long exponent;
+    size_t count;
+    // a last digit 1 stands for the dropped ones, when any of them is nonzero
+    char digits[MAX_INPUT_DIGITS + 1];
+};
+
+
+// whether the non-blank characters of [field, end) spell word, ignoring 
+// case and an optional parenthesized NaN payload
+bool match_word(char const* field, char const* const end, 
+    char const* const word)
+{
+    char const* w = word;
+    for (; field < end && *w != '\0'; ++field, ++w)
+    {
+        if (toupper(static_cast<unsigned char>(*field)) != *w)
+        {
+            return false;
+        }
+    }
+    if (*w != '\0')
+    {
+        return false;
+    }
+    if (field < end && '(' == *field)
+    {
+        char const* const closing = static_cast<char const*>(
+            memchr(field, ')', end - field));
+        if (NULL == closing)
+        {
+            return false;
+        }
+        field = closing + 1;
+    }
+    for (; field < end; ++field)
+    {
+        if (*field != ' ')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Real field of an F, E, D or G edit: blanks are ignored, or zeroes with 
+// BZ; the exponent is given by E, D or Q, or by its sign alone (1.5+03), 
+// and without it the value is divided by 10^scale (kP); without a decimal 
+// point, the last implied digits are the fractional part; an empty field is
+// zero
+bool decode_real(char const* field, size_t const length, size_t const implied,
+    int const scale, bool const blank_zero, DecimalNumber* number)
+{
+    char const* const end = field + length;
+    number->kind     = DECIMAL_FINITE;
+    number->negative = false;
+    number->exponent = 0;
+    number->count    = 0;
+
+    while (field < end && ' ' == *field)
+    {
+        ++field;
+    }
+    if (field < end && ('+' == *field || '-' == *field))
+    {
+        number->negative = '-' == *field;
+        ++field;
+    }
+    if (field < end && ('I' == toupper(static_cast<unsigned char>(*field))))
+    {
+        number->kind = DECIMAL_INFINITY;
+        return match_word(field, end, "INF") || 
+            match_word(field, end, "INFINITY");
+    }
+    if (field < end && ('N' == toupper(static_cast<unsigned char>(*field))))
+    {
+        number->kind = DECIMAL_NAN;
+        return match_word(field, end, "NAN");
+    }
+
+    // mantissa
+    bool point = false;
+    bool dropped = false;
+    long exponent = 0;
+    for (; field < end; ++field)
+    {
+        char c = *field;
+        if (' ' == c)
+        {
+            if (!blank_zero)
+            {
+                continue;
+            }
+            c = '0';
+        }
+        if ('.' == c)
+        {
+            if (point)
+            {
+                return false;
+            }
+            point = true;
+            continue;
+        }
+        if (!is_digit(c))
+        {
+            break;
+        }
+        if (number->count < MAX_INPUT_DIGITS && 
+            (number->count > 0 || c != '0'))
+        {
+            number->digits[number->count] = c;
+            number->count = number->count + 1;
+            if (point)
+            {
+                --exponent;
+            }
+        }
+        else if (0 == number->count)
+        {
+            // leading zero
+            if (point)
+            {
+                --exponent;
+            }
+        }
+        else
+        {
+            // beyond the kept digits
+            dropped = dropped || c != '0';
+            if (!point)
+            {
+                ++exponent;
+            }
+        }
+    }
+    if (dropped)
+    {
+        number->digits[number->count] = '1';
+        number->count = number->count + 1;
+        --exponent;
+    }
+
+    // exponent
+    if (field < end)
+    {
+        char const c = static_cast<char>(toupper(static_cast<unsigned char>(
+            *field)));
+        if ('E' == c || 'D' == c || 'Q' == c)
+        {
+            ++field;
+            while (field < end && ' ' == *field)
+            {
+                ++field;
+            }
+        }
+        else if (c != '+' && c != '-')
+        {
+            return false;
+        }
+
+        bool negative = false;
+        if (field < end && ('+' == *field || '-' == *field))
+        {
+            negative = '-' == *field;
+            ++field;
+        }
+        long value = 0;
+        bool digits = false;
+        for (; field < end; ++field)
+        {
+            char c = *field;
+            if (' ' == c)
+            {
+                if (!blank_zero)
+                {
+                    continue;
+                }
+                c = '0';
+            }
+            if (!is_digit(c))
+            {
+                return false;
+            }
+            digits = true;
+            value = std::min(value * 10 + (c - '0'), MAX_DECIMAL_EXPONENT);
+        }
+        if (!digits)
+        {
+            return false;
+        }
+        exponent = exponent + (negative ? -value : value);
+    }
+    else
+    {
+        exponent = exponent - scale;
+    }
+
+    if (!point)
+    {
+        exponent = exponent - static_cast<long>(implied);
+    }
+    // trailing zeroes, so that more numbers take the fast path
+    while (number->count > 0 && '0' == number->digits[number->count - 1])
+    {
+        number->count = number->count - 1;
+        ++exponent;
+    }
+    number->exponent = exponent;
+    return true;
+}
+
+
+// decimal exponents of the POW5_128 table
+int const POW5_128_MIN = -342;
+int const POW5_128_MAX = 308;
+
+// 5^q for q in [POW5_128_MIN, POW5_128_MAX], normalized to 128 bits (most
+// significant bit set), high word first: truncated for q >= 0, and the 
+// reciprocal rounded up for q < 0
+unsigned long long const POW5_128[][2] = {
+    { 0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL },
+    { 0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL },
+    { 0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL },
+    { 0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL },
+    { 0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL },
+    { 0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL },
+    { 0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL },
+    { 0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL },
+    { 0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL },
+    { 0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL },
+    { 0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL },
+    { 0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL },
+    { 0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL },
+    { 0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL },
+    { 0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL },
+    { 0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL },
+    { 0x84a57695fe98746dULL, 0x014bb630f7604b57ULL },
+    { 0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL },
+    { 0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL },
+    { 0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL },
+    { 0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL },
+    { 0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL },
+    { 0xfd00b897478238d0ULL, 0x8920b098955522b4ULL },
+    { 0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL },
+    { 0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL },
+    { 0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL },
+    { 0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL },
+    { 0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL },
+    { 0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL },
+    { 0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL },
+    { 0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL },
+    { 0xeba09271e88d976bULL, 0xf7864a44c633682eULL },
+    { 0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL },
+    { 0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL },
+    { 0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL },
+    { 0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL },
+    { 0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL },
+    { 0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL },
+    { 0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL },
+    { 0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL },
+    { 0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL },
+    { 0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL },
+    { 0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL },
+    { 0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL },
+    { 0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL },
+    { 0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL },
+    { 0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL },
+    { 0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL },
+    { 0xa37fce126597973cULL, 0xe50ff107bab528a0ULL },
+    { 0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL },
+    { 0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL },
+    { 0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL },
+    { 0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL },
+    { 0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL },
+    { 0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL },
+    { 0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL },
+    { 0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL },
+    { 0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL },
+    { 0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL },
+    { 0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL },
+    { 0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL },
+    { 0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL },
+    { 0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL },
+    { 0x91376c36d99995beULL, 0x23100809b9c21fa1ULL },
+    { 0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL },
+    { 0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL },
+    { 0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL },
+    { 0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL },
+    { 0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL },
+    { 0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL },
+    { 0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL },
+    { 0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL },
+    { 0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL },
+    { 0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL },
+    { 0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL },
+    { 0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL },
+    { 0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL },
+    { 0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL },
+    { 0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL },
+    { 0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL },
+    { 0xc987434744ac874eULL, 0xa327ffb266b56220ULL },
+    { 0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL },
+    { 0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL },
+    { 0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL },
+    { 0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL },
+    { 0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL },
+    { 0xc0314325637a1939ULL, 0xfa911155fefb5308ULL },
+    { 0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL },
+    { 0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL },
+    { 0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL },
+    { 0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL },
+    { 0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL },
+    { 0xb749faed14125d36ULL, 0xcef980ec671f667bULL },
+    { 0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL },
+    { 0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL },
+    { 0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL },
+    { 0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL },
+    { 0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL },
+    { 0xaecc49914078536dULL, 0x58fae9f773886e18ULL },
+    { 0xda7f5bf590966848ULL, 0xaf39a475506a899eULL },
+    { 0x888f99797a5e012dULL, 0x6d8406c952429603ULL },
+    { 0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL },
+    { 0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL },
+    { 0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL },
+    { 0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL },
+    { 0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL },
+    { 0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL },
+    { 0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL },
+    { 0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL },
+    { 0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL },
+    { 0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL },
+    { 0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL },
+    { 0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL },
+    { 0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL },
+    { 0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL },
+    { 0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL },
+    { 0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL },
+    { 0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL },
+    { 0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL },
+    { 0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL },
+    { 0xb913179899f68584ULL, 0x28e2557b59846e3fULL },
+    { 0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL },
+    { 0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL },
+    { 0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL },
+    { 0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL },
+    { 0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL },
+    { 0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL },
+    { 0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL },
+    { 0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL },
+    { 0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL },
+    { 0xd77485cb25823ac7ULL, 0x7d633293366b828bULL },
+    { 0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL },
+    { 0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL },
+    { 0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL },
+    { 0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL },
+    { 0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL },
+    { 0xcd795be870516656ULL, 0x67902e276c921f8bULL },
+    { 0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL },
+    { 0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL },
+    { 0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL },
+    { 0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL },
+    { 0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL },
+    { 0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL },
+    { 0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL },
+    { 0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL },
+    { 0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL },
+    { 0xef340a98172aace4ULL, 0x86fb897116c87c34ULL },
+    { 0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL },
+    { 0xbae0a846d2195712ULL, 0x8974836059cca109ULL },
+    { 0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL },
+    { 0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL },
+    { 0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL },
+    { 0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL },
+    { 0x8e938662882af53eULL, 0x547eb47b7282ee9cULL },
+    { 0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL },
+    { 0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL },
+    { 0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL },
+    { 0xae0b158b4738705eULL, 0x9624ab50b148d445ULL },
+    { 0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL },
+    { 0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL },
+    { 0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL },
+    { 0xd47487cc8470652bULL, 0x7647c3200069671fULL },
+    { 0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL },
+    { 0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL },
+    { 0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL },
+    { 0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL },
+    { 0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL },
+    { 0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL },
+    { 0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL },
+    { 0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL },
+    { 0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL },
+    { 0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL },
+    { 0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL },
+    { 0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL },
+    { 0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL },
+    { 0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL },
+    { 0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL },
+    { 0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL },
+    { 0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL },
+    { 0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL },
+    { 0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL },
+    { 0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL },
+    { 0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL },
+    { 0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL },
+    { 0x8c974f7383725573ULL, 0x1e414218c73a13fbULL },
+    { 0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL },
+    { 0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL },
+    { 0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL },
+    { 0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL },
+    { 0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL },
+    { 0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL },
+    { 0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL },
+    { 0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL },
+    { 0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL },
+    { 0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL },
+    { 0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL },
+    { 0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL },
+    { 0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL },
+    { 0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL },
+    { 0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL },
+    { 0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL },
+    { 0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL },
+    { 0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL },
+    { 0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL },
+    { 0xbe89523386091465ULL, 0xf6bbb397f1135823ULL },
+    { 0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL },
+    { 0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL },
+    { 0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL },
+    { 0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL },
+    { 0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL },
+    { 0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL },
+    { 0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL },
+    { 0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL },
+    { 0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL },
+    { 0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL },
+    { 0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL },
+    { 0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL },
+    { 0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL },
+    { 0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL },
+    { 0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL },
+    { 0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL },
+    { 0x843610cb4bf160cbULL, 0xcedf722a585139baULL },
+    { 0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL },
+    { 0xce947a3da6a9273eULL, 0x733d226229feea32ULL },
+    { 0x811ccc668829b887ULL, 0x0806357d5a3f525fULL },
+    { 0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL },
+    { 0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL },
+    { 0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL },
+    { 0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL },
+    { 0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL },
+    { 0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL },
+    { 0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL },
+    { 0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL },
+    { 0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL },
+    { 0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL },
+    { 0xbbe226efb628afeaULL, 0x890489f70a55368bULL },
+    { 0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL },
+    { 0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL },
+    { 0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL },
+    { 0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL },
+    { 0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL },
+    { 0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL },
+    { 0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL },
+    { 0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL },
+    { 0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL },
+    { 0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL },
+    { 0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL },
+    { 0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL },
+    { 0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL },
+    { 0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL },
+    { 0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL },
+    { 0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL },
+    { 0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL },
+    { 0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL },
+    { 0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL },
+    { 0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL },
+    { 0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL },
+    { 0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL },
+    { 0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL },
+    { 0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL },
+    { 0xc24452da229b021bULL, 0xfbe85badce996168ULL },
+    { 0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL },
+    { 0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL },
+    { 0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL },
+    { 0xed246723473e3813ULL, 0x290123e9aab23b68ULL },
+    { 0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL },
+    { 0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL },
+    { 0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL },
+    { 0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL },
+    { 0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL },
+    { 0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL },
+    { 0x8d590723948a535fULL, 0x579c487e5a38ad0eULL },
+    { 0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL },
+    { 0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL },
+    { 0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL },
+    { 0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL },
+    { 0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL },
+    { 0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL },
+    { 0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL },
+    { 0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL },
+    { 0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL },
+    { 0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL },
+    { 0xcdb02555653131b6ULL, 0x3792f412cb06794dULL },
+    { 0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL },
+    { 0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL },
+    { 0xc8de047564d20a8bULL, 0xf245825a5a445275ULL },
+    { 0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL },
+    { 0x9ced737bb6c4183dULL, 0x55464dd69685606bULL },
+    { 0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL },
+    { 0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL },
+    { 0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL },
+    { 0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL },
+    { 0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL },
+    { 0x95a8637627989aadULL, 0xdde7001379a44aa8ULL },
+    { 0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL },
+    { 0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL },
+    { 0x9226712162ab070dULL, 0xcab3961304ca70e8ULL },
+    { 0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL },
+    { 0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL },
+    { 0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL },
+    { 0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL },
+    { 0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL },
+    { 0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL },
+    { 0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL },
+    { 0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL },
+    { 0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL },
+    { 0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL },
+    { 0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL },
+    { 0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL },
+    { 0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL },
+    { 0xcfb11ead453994baULL, 0x67de18eda5814af2ULL },
+    { 0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL },
+    { 0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL },
+    { 0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL },
+    { 0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL },
+    { 0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL },
+    { 0xc612062576589ddaULL, 0x95364afe032a819eULL },
+    { 0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL },
+    { 0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL },
+    { 0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL },
+    { 0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL },
+    { 0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL },
+    { 0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL },
+    { 0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL },
+    { 0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL },
+    { 0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL },
+    { 0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL },
+    { 0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL },
+    { 0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL },
+    { 0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL },
+    { 0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL },
+    { 0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL },
+    { 0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL },
+    { 0x89705f4136b4a597ULL, 0x31680a88f8953031ULL },
+    { 0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL },
+    { 0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL },
+    { 0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL },
+    { 0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL },
+    { 0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL },
+    { 0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL },
+    { 0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL },
+    { 0xccccccccccccccccULL, 0xcccccccccccccccdULL },
+    { 0x8000000000000000ULL, 0x0000000000000000ULL },
+    { 0xa000000000000000ULL, 0x0000000000000000ULL },
+    { 0xc800000000000000ULL, 0x0000000000000000ULL },
+    { 0xfa00000000000000ULL, 0x0000000000000000ULL },
+    { 0x9c40000000000000ULL, 0x0000000000000000ULL },
+    { 0xc350000000000000ULL, 0x0000000000000000ULL },
+    { 0xf424000000000000ULL, 0x0000000000000000ULL },
+    { 0x9896800000000000ULL, 0x0000000000000000ULL },
+    { 0xbebc200000000000ULL, 0x0000000000000000ULL },
+    { 0xee6b280000000000ULL, 0x0000000000000000ULL },
+    { 0x9502f90000000000ULL, 0x0000000000000000ULL },
+    { 0xba43b74000000000ULL, 0x0000000000000000ULL },
+    { 0xe8d4a51000000000ULL, 0x0000000000000000ULL },
+    { 0x9184e72a00000000ULL, 0x0000000000000000ULL },
+    { 0xb5e620f480000000ULL, 0x0000000000000000ULL },
+    { 0xe35fa931a0000000ULL, 0x0000000000000000ULL },
+    { 0x8e1bc9bf04000000ULL, 0x0000000000000000ULL },
+    { 0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL },
+    { 0xde0b6b3a76400000ULL, 0x0000000000000000ULL },
+    { 0x8ac7230489e80000ULL, 0x0000000000000000ULL },
+    { 0xad78ebc5ac620000ULL, 0x0000000000000000ULL },
+    { 0xd8d726b7177a8000ULL, 0x0000000000000000ULL },
+    { 0x878678326eac9000ULL, 0x0000000000000000ULL },
+    { 0xa968163f0a57b400ULL, 0x0000000000000000ULL },
+    { 0xd3c21bcecceda100ULL, 0x0000000000000000ULL },
+    { 0x84595161401484a0ULL, 0x0000000000000000ULL },
+    { 0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL },
+    { 0xcecb8f27f4200f3aULL, 0x0000000000000000ULL },
+    { 0x813f3978f8940984ULL, 0x4000000000000000ULL },
+    { 0xa18f07d736b90be5ULL, 0x5000000000000000ULL },
+    { 0xc9f2c9cd04674edeULL, 0xa400000000000000ULL },
+    { 0xfc6f7c4045812296ULL, 0x4d00000000000000ULL },
+    { 0x9dc5ada82b70b59dULL, 0xf020000000000000ULL },
+    { 0xc5371912364ce305ULL, 0x6c28000000000000ULL },
+    { 0xf684df56c3e01bc6ULL, 0xc732000000000000ULL },
+    { 0x9a130b963a6c115cULL, 0x3c7f400000000000ULL },
+    { 0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL },
+    { 0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL },
+    { 0x96769950b50d88f4ULL, 0x1314448000000000ULL },
+    { 0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL },
+    { 0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL },
+    { 0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL },
+    { 0xb7abc627050305adULL, 0xf14a3d9e40000000ULL },
+    { 0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL },
+    { 0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL },
+    { 0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL },
+    { 0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL },
+    { 0x8c213d9da502de45ULL, 0x4526f422cc340000ULL },
+    { 0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL },
+    { 0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL },
+    { 0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL },
+    { 0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL },
+    { 0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL },
+    { 0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL },
+    { 0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL },
+    { 0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL },
+    { 0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL },
+    { 0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL },
+    { 0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL },
+    { 0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL },
+    { 0x9f4f2726179a2245ULL, 0x01d762422c946590ULL },
+    { 0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL },
+    { 0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL },
+    { 0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL },
+    { 0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL },
+    { 0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL },
+    { 0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL },
+    { 0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL },
+    { 0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL },
+    { 0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL },
+    { 0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL },
+    { 0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL },
+    { 0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL },
+    { 0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL },
+    { 0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL },
+    { 0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL },
+    { 0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL },
+    { 0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL },
+    { 0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL },
+    { 0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL },
+    { 0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL },
+    { 0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL },
+    { 0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL },
+    { 0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL },
+    { 0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL },
+    { 0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL },
+    { 0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL },
+    { 0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL },
+    { 0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL },
+    { 0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL },
+    { 0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL },
+    { 0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL },
+    { 0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL },
+    { 0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL },
+    { 0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL },
+    { 0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL },
+    { 0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL },
+    { 0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL },
+    { 0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL },
+    { 0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL },
+    { 0x924d692ca61be758ULL, 0x593c2626705f9c56ULL },
+    { 0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL },
+    { 0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL },
+    { 0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL },
+    { 0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL },
+    { 0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL },
+    { 0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL },
+    { 0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL },
+    { 0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL },
+    { 0x884134fe908658b2ULL, 0x3109058d147fdcddULL },
+    { 0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL },
+    { 0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL },
+    { 0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL },
+    { 0xa6539930bf6bff45ULL, 0x84db8346b786151cULL },
+    { 0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL },
+    { 0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL },
+    { 0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL },
+    { 0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL },
+    { 0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL },
+    { 0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL },
+    { 0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL },
+    { 0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL },
+    { 0x9ae757596946075fULL, 0x3375788de9b06958ULL },
+    { 0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL },
+    { 0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL },
+    { 0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL },
+    { 0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL },
+    { 0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL },
+    { 0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL },
+    { 0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL },
+    { 0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL },
+    { 0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL },
+    { 0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL },
+    { 0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL },
+    { 0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL },
+    { 0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL },
+    { 0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL },
+    { 0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL },
+    { 0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL },
+    { 0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL },
+    { 0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL },
+    { 0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL },
+    { 0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL },
+    { 0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL },
+    { 0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL },
+    { 0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL },
+    { 0x802221226be55a64ULL, 0xc2494954da2c9789ULL },
+    { 0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL },
+    { 0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL },
+    { 0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL },
+    { 0x9c69a97284b578d7ULL, 0xff2a760414536efbULL },
+    { 0xc38413cf25e2d70dULL, 0xfef5138519684abaULL },
+    { 0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL },
+    { 0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL },
+    { 0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL },
+    { 0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL },
+    { 0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL },
+    { 0xba756174393d88dfULL, 0x94f971119aeef9e4ULL },
+    { 0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL },
+    { 0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL },
+    { 0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL },
+    { 0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL },
+    { 0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL },
+    { 0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL },
+    { 0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL },
+    { 0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL },
+    { 0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL },
+    { 0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL },
+    { 0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL },
+    { 0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL },
+    { 0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL },
+    { 0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL },
+    { 0xa59bc234db398c25ULL, 0x43fab9837e699095ULL },
+    { 0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL },
+    { 0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL },
+    { 0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL },
+    { 0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL },
+    { 0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL },
+    { 0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL },
+    { 0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL },
+    { 0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL },
+    { 0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL },
+    { 0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL },
+    { 0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL },
+    { 0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL },
+    { 0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL },
+    { 0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL },
+    { 0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL },
+    { 0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL },
+    { 0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL },
+    { 0x8fa475791a569d10ULL, 0xf96e017d694487bcULL },
+    { 0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL },
+    { 0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL },
+    { 0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL },
+    { 0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL },
+    { 0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL },
+    { 0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL },
+    { 0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL },
+    { 0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL },
+    { 0x85c7056562757456ULL, 0xf6872d5667844e49ULL },
+    { 0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL },
+    { 0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL },
+    { 0x82a45b450226b39cULL, 0xecc0024661173473ULL },
+    { 0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL },
+    { 0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL },
+    { 0xff290242c83396ceULL, 0x7e67047175a15271ULL },
+    { 0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL },
+    { 0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL },
+    { 0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL },
+    { 0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL },
+    { 0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL },
+    { 0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL },
+    { 0x98165af37b2153deULL, 0xc3727a337a8b704aULL },
+    { 0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL },
+    { 0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL },
+    { 0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL },
+    { 0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL },
+    { 0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL },
+    { 0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL },
+    { 0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL },
+    { 0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL },
+    { 0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL },
+    { 0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL },
+    { 0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL },
+    { 0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL },
+    { 0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL },
+    { 0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL },
+    { 0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL },
+    { 0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL },
+    { 0xd31045a8341ca07cULL, 0x1ede48111209a050ULL },
+    { 0x83ea2b892091e44dULL, 0x934aed0aab460432ULL },
+    { 0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL },
+    { 0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL },
+    { 0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL },
+    { 0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL },
+    { 0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL },
+    { 0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL },
+    { 0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL },
+    { 0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL },
+    { 0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL },
+    { 0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL },
+    { 0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL },
+    { 0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL },
+    { 0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL },
+    { 0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL },
+    { 0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL },
+    { 0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL },
+    { 0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL },
+    { 0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL },
+    { 0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL },
+    { 0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL },
+    { 0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL },
+    { 0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL },
+    { 0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL },
+    { 0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL },
+    { 0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL },
+    { 0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL },
+    { 0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL },
+    { 0x8533285c936b35deULL, 0xd53a88958f87275fULL },
+    { 0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL },
+    { 0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL },
+    { 0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL },
+    { 0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL },
+    { 0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL },
+    { 0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL },
+    { 0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL },
+    { 0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL },
+    { 0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL },
+    { 0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL },
+    { 0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL },
+    { 0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL },
+    { 0x976e41088617ca01ULL, 0xd5be0503e085d813ULL },
+    { 0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL },
+    { 0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL },
+    { 0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL },
+    { 0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL },
+    { 0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL },
+    { 0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL },
+    { 0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL },
+    { 0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL },
+    { 0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL },
+    { 0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL },
+    { 0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL },
+    { 0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL },
+    { 0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL },
+    { 0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL },
+    { 0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL },
+    { 0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL },
+    { 0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL },
+    { 0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL },
+    { 0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL },
+    { 0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL },
+    { 0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL },
+    { 0xa0555e361951c366ULL, 0xd7e105bcc332621fULL },
+    { 0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL },
+    { 0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL },
+    { 0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL },
+    { 0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL },
+    { 0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL },
+    { 0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL },
+    { 0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL },
+    { 0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL },
+    { 0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL },
+    { 0xbaa718e68396cffdULL, 0xd30560258f54e6baULL },
+    { 0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL },
+    { 0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL },
+    { 0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL },
+    { 0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL },
+    { 0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL }
+};
+
+
+// bits of a double: stored mantissa and biased exponent
+struct BinaryNumber
+{
+    unsigned long long mantissa;
+    int exponent;
+};
+
+
+inline int leading_zeros(unsigned long long const value)
+{
+    return 64 - bit_length(value);
+}
+
+
+// full product of two 64-bit integers: the low word, and the high one in 
+// high
+inline unsigned long long multiply_64(unsigned long long const a, 
+    unsigned long long const b, unsigned long long* high)
+{
+#ifdef __SIZEOF_INT128__
+    uint128 const product = static_cast<uint128>(a) * b;
+    *high = static_cast<unsigned long long>(product >> 64);
+    return static_cast<unsigned long long>(product);
+#else
+    unsigned long long const a_low = a & 0xFFFFFFFFULL;
+    unsigned long long const a_high = a >> 32;
+    unsigned long long const b_low = b & 0xFFFFFFFFULL;
+    unsigned long long const b_high = b >> 32;
+    unsigned long long const low_low = a_low * b_low;
+    unsigned long long const middle = a_high * b_low + (low_low >> 32);
+    unsigned long long const cross = a_low * b_high + 
+        (middle & 0xFFFFFFFFULL);
+    *high = a_high * b_high + (middle >> 32) + (cross >> 32);
+    return (cross << 32) | (low_low & 0xFFFFFFFFULL);
+#endif
+}
+
+
+// Eisel-Lemire: the double nearest to w * 10^q, for w > 0 and q in 
+// [POW5_128_MIN, POW5_128_MAX], from a 128-bit approximation of w * 5^q, 
+// which has always enough bits to round (Mushtak and Lemire, "Fast number 
+// parsing without fallback")
+BinaryNumber eisel_lemire(unsigned long long w, int const q)
+{
+    int const lz = leading_zeros(w);
+    w = w << lz;
+
+    // the first 64 bits of the power, and the next ones when the product 
+    // could carry into the mantissa bits
+    unsigned long long const* const power = POW5_128[q - POW5_128_MIN];
+    unsigned long long high;
+    unsigned long long low = multiply_64(w, power[0], &high);
+    unsigned long long const precision_mask = ~0ULL >> (DOUBLE_MANTISSA + 3);
+    if ((high & precision_mask) == precision_mask)
+    {
+        unsigned long long carry;
+        multiply_64(w, power[1], &carry);
+        low = low + carry;
+        if (carry > low)
+        {
+            ++high;
+        }
+    }
+
+    BinaryNumber result;
+    int const upper = static_cast<int>(high >> 63);
+    int const shift = upper + 64 - DOUBLE_MANTISSA - 3;
+    result.mantissa = high >> shift;
+    // floor(log2(10^q)) + 63, plus the bias
+    result.exponent = (((152170 + 65536) * q) >> 16) + 63 + upper - lz + 
+        DOUBLE_BIAS;
+
+    if (result.exponent <= 0)
+    {
+        // subnormal, or zero
+        if (1 - result.exponent >= 64)
+        {
+            result.mantissa = 0;
+            result.exponent = 0;
+            return result;
+        }
+        result.mantissa = result.mantissa >> (1 - result.exponent);
+        result.mantissa = (result.mantissa + (result.mantissa & 1)) >> 1;
+        result.exponent = 
+            result.mantissa < (1ULL << DOUBLE_MANTISSA) ? 0 : 1;
+        result.mantissa = result.mantissa & ((1ULL << DOUBLE_MANTISSA) - 1);
+        return result;
+    }
+
+    // an exact product halfway between two doubles rounds to even; only 
+    // small powers of ten can be exact
+    if (low <= 1 && q >= -4 && q <= 23 && (result.mantissa & 3) == 1 && 
+        (result.mantissa << shift) == high)
+    {
+        result.mantissa = result.mantissa & ~1ULL;
+    }
+    result.mantissa = (result.mantissa + (result.mantissa & 1)) >> 1;
+    if (result.mantissa >= (2ULL << DOUBLE_MANTISSA))
+    {
+        result.mantissa = 1ULL << DOUBLE_MANTISSA;
+        ++result.exponent;
+    }
+    result.mantissa = result.mantissa & ((1ULL << DOUBLE_MANTISSA) - 1);
+    if (result.exponent >= DOUBLE_INFINITE_EXPONENT)
+    {
+        result.mantissa = 0;
+        result.exponent = DOUBLE_INFINITE_EXPONENT;
+    }
+    return result;
+}
+
+
+inline double binary_to_double(BinaryNumber const& number)
+{
+    unsigned long long const bits = 
+        (static_cast<unsigned long long>(number.exponent) << DOUBLE_MANTISSA) |
+        number.mantissa;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+// correctly rounded by the C library, from the normalized digits: no 
+// decimal point to depend on the locale
+double slow_decimal_to_double(DecimalNumber const* const number)
+{
+    char text[MAX_INPUT_DIGITS + 32];
+    memcpy(text, number->digits, number->count);
+    char* put = text + number->count;
+    *put++ = 'e';
+    if (number->exponent < 0)
+    {
+        *put++ = '-';
+    }
+    unsigned long long const magnitude = number->exponent < 0 ? 
+        -number->exponent : number->exponent;
+    put = put + write_decimal(put, magnitude);
+    *put = '\0';
+    return strtod(text, NULL);
+}
+
+
+double decimal_to_double(DecimalNumber const* const number)
+{
+    double value = 0.0;
+    if (DECIMAL_INFINITY == number->kind)
+    {
+        value = HUGE_VAL;
+    }
+    else if (DECIMAL_NAN == number->kind)
+    {
+        value = NAN;
+    }
+    else if (number->count > 0)
+    {
+        // the first digits, and the power of ten they're multiplied by
+        size_t const used = std::min(number->count, MAX_EXACT_DIGITS);
+        unsigned long long mantissa = 0;
+        for (size_t n = 0; n < used; ++n)
+        {
+            mantissa = mantissa * 10 + (number->digits[n] - '0');
+        }
+        long const exponent = number->exponent + 
+            static_cast<long>(number->count - used);
+
+        if (number->count <= 15 && exponent >= -22 && exponent <= 22)
+        {
+            // exact operands, a single rounding (Clinger's fast path)
+            value = static_cast<double>(mantissa);
+            if (exponent < 0)
+            {
+                value = value / POW10_DOUBLE[-exponent];
+            }
+            else
+            {
+                value = value * POW10_DOUBLE[exponent];
+            }
+        }
+        else if (exponent < POW5_128_MIN)
+        {
+            value = 0.0;
+        }
+        else if (exponent > POW5_128_MAX)
+        {
+            value = HUGE_VAL;
+        }
+        else
+        {
+            int const q = static_cast<int>(exponent);
+            BinaryNumber const result = eisel_lemire(mantissa, q);
+            // with digits left out, the value is between those of the 
+            // first digits and of their successor: when they round the 
+            // same, so does the value
+            if (number->count > used && 
+                binary_to_double(eisel_lemire(mantissa + 1, q)) != 
+                binary_to_double(result))
+            {
+                value = slow_decimal_to_double(number);
+            }
+            else
+            {
+                value = binary_to_double(result);
+            }
+        }
+    }
+    return number->negative ? -value : value;
+}
+
+
+//
+// Storing fields into targets
+//
+
+bool store_integer(FormatTarget const& target, bool const negative, 
+    unsigned long long const magnitude)
+{
+    switch (target.type)
+    {
+        case FTGT_INT:
+        {
+            unsigned long long const limit = 
+                (1ULL << (8 * target.size - 1)) - (negative ? 0 : 1);
+            if (magnitude > limit)
+            {
+                return false;
+            }
+            long long const value = negative ? 
+                static_cast<long long>(0ULL - magnitude) : 
+                static_cast<long long>(magnitude);
+            switch (target.size)
+            {
+                case 1: *static_cast<int8_t*>(target.pointer) = 
+                    static_cast<int8_t>(value); break;
+                case 2: *static_cast<int16_t*>(target.pointer) = 
+                    static_cast<int16_t>(value); break;
+                case 4: *static_cast<int32_t*>(target.pointer) = 
+                    static_cast<int32_t>(value); break;
+                default: *static_cast<int64_t*>(target.pointer) = value;
+            }
+            return true;
+        }
+
+        case FTGT_UINT:
+        {
+            unsigned long long const limit = target.size < 8 ? 
+                (1ULL << (8 * target.size)) - 1 : ~0ULL;
+            if (magnitude > limit || (negative && magnitude != 0))
+            {
+                return false;
+            }
+            switch (target.size)
+            {
+                case 1: *static_cast<uint8_t*>(target.pointer) = 
+                    static_cast<uint8_t>(magnitude); break;
+                case 2: *static_cast<uint16_t*>(target.pointer) = 
+                    static_cast<uint16_t>(magnitude); break;
+                case 4: *static_cast<uint32_t*>(target.pointer) = 
+                    static_cast<uint32_t>(magnitude); break;
+                default: *static_cast<uint64_t*>(target.pointer) = magnitude;
+            }
+            return true;
+        }
+
+        case FTGT_FLOAT:
+        case FTGT_DOUBLE:
+        {
+            double const value = static_cast<double>(magnitude);
+            if (FTGT_FLOAT == target.type)
+            {
+                *static_cast<float*>(target.pointer) = 
+                    static_cast<float>(negative ? -value : value);
+            }
             else
             {
-                fill_with_char(put, OVERFLOW_FILL_CHAR, width);
+                *static_cast<double*>(target.pointer) = 
+                    negative ? -value : value;
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+
+bool store_real(FormatTarget const& target, DecimalNumber const* number)
+{
+    if (FTGT_DOUBLE == target.type)
+    {
+        *static_cast<double*>(target.pointer) = decimal_to_double(number);
+        return true;
+    }
+    if (FTGT_FLOAT == target.type)
+    {
+        *static_cast<float*>(target.pointer) = 
+            static_cast<float>(decimal_to_double(number));
+        return true;
+    }
+    return false;
+}
+
+
+// Logical field: optional blanks and point, then T or F; the rest is 
+// ignored (.TRUE., FALSE)
+bool store_logical(FormatTarget const& target, char const* field, 
+    size_t const length)
+{
+    char const* const end = field + length;
+    while (field < end && ' ' == *field)
+    {
+        ++field;
+    }
+    if (field < end && '.' == *field)
+    {
+        ++field;
+    }
+    if (field == end || target.type != FTGT_BOOL)
+    {
+        return false;
+    }
+
+    char const c = static_cast<char>(toupper(static_cast<unsigned char>(
+        *field)));
+    if (c != FORTRAN_TRUE && c != FORTRAN_FALSE)
+    {
+        return false;
+    }
+    *static_cast<bool*>(target.pointer) = FORTRAN_TRUE == c;
+    return true;
+}
+
+
+// Character field of width columns (length of them in the record, the rest
+// blanks). A character array of length len (without its NUL) takes the 
+// rightmost len columns when width is larger, and is padded with blanks 
+// otherwise, as a Fortran CHARACTER*len variable; a std::string takes the 
+// whole field, and a view the part of it in the record
+bool store_characters(FormatTarget const& target, char const* field, 
+    size_t const length, size_t const width)
+{
+    if (FTGT_STRING == target.type)
+    {
+        std::string& value = *static_cast<std::string*>(target.pointer);
+        value.assign(field, length);
+        value.append(width - length, ' ');
+        return true;
+    }
+    if (FTGT_VIEW == target.type)
+    {
+        FormatArg::String* const value = 
+            static_cast<FormatArg::String*>(target.pointer);
+        value->data   = field;
+        value->length = length;
+        return true;
+    }
+#if __cplusplus >= 201703L
+    if (FTGT_STRING_VIEW == target.type)
+    {
+        *static_cast<std::string_view*>(target.pointer) = 
+            std::string_view(field, length);
+        return true;
+    }
+#endif
+    if (FTGT_CHARS == target.type && target.size > 0)
+    {
+        char* const value = static_cast<char*>(target.pointer);
+        size_t const len = target.size - 1;
+        size_t skip = width > len ? width - len : 0;
+        size_t copied = 0;
+        if (skip < length)
+        {
+            copied = std::min(length - skip, len);
+            memcpy(value, field + skip, copied);
+        }
+        memset(value + copied, ' ', len - copied);
+        value[len] = '\0';
+        return true;
+    }
+    return false;
+}
+
+
+//
+// List-directed reading
+//
+// Values are separated by blanks, by a comma with optional blanks around it
+// or by the end of a record, and r*c stands for r values c. A comma without
+// a value before it and r* are null values, which leave their targets 
+// unchanged; a slash leaves the remaining ones unchanged. Character values
+// are quoted, doubling the quote inside them, or end at a separator.
+//
+
+inline bool is_list_blank(char const c)
+{
+    return ' ' == c || '\t' == c;
+}
+
+
+inline bool is_list_separator(char const c)
+{
+    return is_list_blank(c) || ',' == c || '/' == c;
+}
+
+
+// Character value, the quotes of a quoted one (quote) removed but doubled
+// quotes inside it kept: they're collapsed into a std::string or a 
+// character array, which takes the leftmost len characters and is padded 
+// with blanks, while a view refers to the value as it is in the record
+bool store_list_characters(FormatTarget const& target, char const* value, 
+    size_t const length, char const quote)
+{
+    if (FTGT_STRING == target.type)
+    {
+        std::string& str = *static_cast<std::string*>(target.pointer);
+        str.clear();
+        for (size_t n = 0; n < length; ++n)
+        {
+            str.push_back(value[n]);
+            n = n + (0 != quote && quote == value[n]);
+        }
+        return true;
+    }
+    if (FTGT_CHARS == target.type && target.size > 0)
+    {
+        char* const str = static_cast<char*>(target.pointer);
+        size_t const len = target.size - 1;
+        size_t copied = 0;
+        for (size_t n = 0; n < length && copied < len; ++n)
+        {
+            str[copied] = value[n];
+            copied = copied + 1;
+            n = n + (0 != quote && quote == value[n]);
+        }
+        memset(str + copied, ' ', len - copied);
+        str[len] = '\0';
+        return true;
+    }
+    return store_characters(target, value, length, length);
+}
+
+
+// Value (not null) of a list-directed item into target
+bool store_list_value(FormatTarget const& target, char const* value, 
+    size_t const length, char const quote)
+{
+    switch (target.type)
+    {
+        case FTGT_INT:
+        case FTGT_UINT:
+        {
+            bool negative;
+            unsigned long long magnitude;
+            return 0 == quote && 
+                decode_integer(value, length, false, &negative, &magnitude) &&
+                store_integer(target, negative, magnitude);
+        }
+
+        case FTGT_FLOAT:
+        case FTGT_DOUBLE:
+        {
+            DecimalNumber number;
+            return 0 == quote && 
+                decode_real(value, length, 0, 0, false, &number) && 
+                store_real(target, &number);
+        }
+
+        case FTGT_BOOL:
+            return 0 == quote && store_logical(target, value, length);
+
+        default:
+            return store_list_characters(target, value, length, quote);
+    }
+}
+
+
+// Reads the targets from the current record on, up to a slash (or to the end
+// of the record, with in->single_record)
+void read_list(Input* in, TargetCursor* targets)
+{
+    // whether a comma would only separate the previous value from the next
+    bool after_value = false;
+
+    while (has_target(targets) && !in->failed)
+    {
+        while (in->column < in->length && 
+            is_list_blank(in->record[in->column]))
+        {
+            in->column = in->column + 1;
+        }
+        if (in->column >= in->length)
+        {
+            if (in->single_record)
+            {
+                return;
+            }
+            read_record(in);
+            continue;
+        }
+
+        char const* const record = in->record;
+        size_t const length = in->length;
+        size_t pos = in->column;
+        if ('/' == record[pos])
+        {
+            return;
+        }
+        if (',' == record[pos])
+        {
+            if (!after_value)
+            {
+                targets->current = targets->current + 1;
+            }
+            after_value = false;
+            in->column = pos + 1;
+            continue;
+        }
+
+        // repeat count
+        unsigned long long repeat = 1;
+        size_t digits = pos;
+        while (digits < length && is_digit(record[digits]))
+        {
+            digits = digits + 1;
+        }
+        if (digits > pos && digits < length && '*' == record[digits])
+        {
+            bool negative;
+            if (!decode_integer(record + pos, digits - pos, false, &negative,
+                &repeat) || 0 == repeat)
+            {
+                in->failed = true;
+                return;
+            }
+            pos = digits + 1;
+        }
+
+        // the value, quoted or up to the next separator; none with r*
+        char quote = 0;
+        char const* value = record + pos;
+        size_t len = 0;
+        if (pos < length && ('\'' == record[pos] || '"' == record[pos]))
+        {
+            quote = record[pos];
+            size_t close = pos + 1;
+            while (close < length && (quote != record[close] || 
+                (close + 1 < length && quote == record[close + 1])))
+            {
+                close = close + (quote == record[close]) + 1;
+            }
+            if (close >= length)
+            {
+                in->failed = true;
+                return;
+            }
+            value = record + pos + 1;
+            len = close - pos - 1;
+            pos = close + 1;
+        }
+        else
+        {
+            while (pos + len < length && !is_list_separator(record[pos + len]))
+            {
+                len = len + 1;
+            }
+            pos = pos + len;
+        }
+        in->column = pos;
+
+        for (unsigned long long n = 0; n < repeat && has_target(targets); ++n)
+        {
+            bool const null = 0 == len && 0 == quote;
+            if (!null && !store_list_value(*targets->current, value, len, 
+                quote))
+            {
+                in->failed = true;
+                return;
+            }
+            targets->current = targets->current + 1;
+        }
+        after_value = true;
+    }
+}
+
+
+//
+// Format read edit descriptors
+//
+// Data edit descriptors return false when there are no targets left for 
+// them; an invalid field sets in->failed.
+//
+
+bool read_i(Input* in, FormatItem const& item, TargetCursor* targets)
+{
+    IntegerDecoder const decoder = best_integer_decoder();
+    IntegerField fields[INTEGER_BATCH];
+
+    size_t repcount = 0;
+    while (repcount < item.repeat && !in->failed)
+    {
+        if (!has_target(targets))
+        {
+            return false;
+        }
+
+        // the fields wholly in the record are decoded a batch at a time
+        size_t batch = std::min(INTEGER_BATCH, std::min<size_t>(
+            item.repeat - repcount, targets->end - targets->current));
+        if (in->column < in->length)
+        {
+            batch = std::min(batch, (in->length - in->column) / item.width);
+        }
+        else
+        {
+            batch = 0;
+        }
+        if (batch > 0)
+        {
+            decode_integer_fields(decoder, in->record, 
+                in->record + in->length, in->record + in->column, item.width, 
+                batch, in->blank_zero, fields);
+            in->column = in->column + batch * item.width;
+        }
+        else
+        {
+            char const* field;
+            size_t const length = take_field(in, item.width, &field);
+            fields[0].valid = decode_integer(field, length, in->blank_zero, 
+                &fields[0].negative, &fields[0].magnitude);
+            batch = 1;
+        }
+
+        for (size_t n = 0; n < batch; ++n)
+        {
+            if (!fields[n].valid || !store_integer(*targets->current, 
+                fields[n].negative, fields[n].magnitude))
+            {
+                in->failed = true;
+                break;
+            }
+            targets->current = targets->current + 1;
+        }
+        repcount = repcount + batch;
+    }
+    return true;
+}
+
+
+bool read_real(Input* in, FormatItem const& item, TargetCursor* targets)
+{
+    DecimalNumber number;
+    for (size_t repcount = 0; repcount < item.repeat && !in->failed; 
+        ++repcount)
+    {
+        if (!has_target(targets))
+        {
+            return false;
+        }
+        char const* field;
+        size_t const length = take_field(in, item.width, &field);
+
+        // G edits take any type
+        FormatTarget const& target = *targets->current;
+        bool stored = false;
+        if (FOP_G == item.op && (FTGT_INT == target.type || 
+            FTGT_UINT == target.type))
+        {
+            bool negative;
+            unsigned long long magnitude;
+            stored = decode_integer(field, length, in->blank_zero, &negative, 
+                &magnitude) && store_integer(target, negative, magnitude);
+        }
+        else if (FOP_G == item.op && FTGT_BOOL == target.type)
+        {
+            stored = store_logical(target, field, length);
+        }
+        else if (FOP_G == item.op && (FTGT_STRING == target.type || 
+            FTGT_CHARS == target.type || FTGT_VIEW == target.type || 
+            FTGT_STRING_VIEW == target.type))
+        {
+            stored = store_characters(target, field, length, item.width);
+        }
+        else
+        {
+            stored = decode_real(field, length, item.digits, in->scale, 
+                in->blank_zero, &number) && store_real(target, &number);
+        }
+        if (!stored)
+        {
+            in->failed = true;
+            break;
+        }
+        targets->current = targets->current + 1;
+    }
+    return true;
+}
+
+
+bool read_l(Input* in, FormatItem const& item, TargetCursor* targets)
+{
+    for (size_t repcount = 0; repcount < item.repeat && !in->failed; 
+        ++repcount)
+    {
+        if (!has_target(targets))
+        {
+            return false;
+        }
+        char const* field;
+        size_t const length = take_field(in, item.width, &field);
+        if (!store_logical(*targets->current, field, length))
+        {
+            in->failed = true;
+            break;
+        }
+        targets->current = targets->current + 1;
+    }
+    return true;
+}
+
+
+bool read_a(Input* in, FormatItem const& item, TargetCursor* targets)
+{
+    for (size_t repcount = 0; repcount < item.repeat && !in->failed; 
+        ++repcount)
+    {
+        if (!has_target(targets))
+        {
+            return false;
+        }
+
+        // without a width, the length of the character array or the rest 
+        // of the record
+        FormatTarget const& target = *targets->current;
+        size_t width = item.width;
+        if (0 == width)
+        {
+            if (FTGT_CHARS == target.type && target.size > 0)
+            {
+                width = target.size - 1;
+            }
+            else if (in->column < in->length)
+            {
+                width = in->length - in->column;
+            }
+        }
+        char const* field;
+        size_t const length = take_field(in, width, &field);
+        if (!store_characters(target, field, length, width))
+        {
+            in->failed = true;
+            break;
+        }
+        targets->current = targets->current + 1;
+    }
+    return true;
+}
+
+
+// Reads the items [first, last), returning false when the format control 
+// terminates for lack of targets
+bool read_group(Input* in, FortranFormat const& format, size_t const first, 
+    size_t const last, TargetCursor* targets)
+{
+    FormatItemList const& items = format.items();
+    bool more = true;
+
+    for (size_t n = first; n < last && more && !in->failed; ++n)
+    {
+        FormatItem const& item = items[n];
+        switch(item.op)
+        {
+            case FOP_GROUP:
+                for (size_t repcount = 0; repcount < item.repeat && more && 
+                    !in->failed; ++repcount)
+                {
+                    more = read_group(in, format, n + 1, n + 1 + item.length, 
+                        targets);
+                }
+                n = n + item.length;
+            break;
+
+            case FOP_A:
+                more = read_a(in, item, targets);
+            break;
+
+            case FOP_D:
+            case FOP_E:
+            case FOP_F:
+            case FOP_G:
+                more = read_real(in, item, targets);
+            break;
+
+            case FOP_I:
+                more = read_i(in, item, targets);
+            break;
+
+            case FOP_L:
+                more = read_l(in, item, targets);
+            break;
+
+            case FOP_SP:
+            case FOP_SS:
+            break;
+
+            case FOP_BN:
+                in->blank_zero = false;
+            break;
+
+            case FOP_BZ:
+                in->blank_zero = true;
+            break;
+
+            case FOP_P:
+                in->scale = item.scale;
+            break;
+
+            case FOP_X:
+                in->column = in->column + item.repeat;
+            break;
+
+            case FOP_STR:
+                // character constants are skipped over on input
+                in->column = in->column + item.length;
+            break;
+
+            case FOP_NL:
+                for (size_t repcount = 0; repcount < item.repeat && 
+                    !in->failed; ++repcount)
+                {
+                    read_record(in);
+                }
+            break;
+        }
+    }
+
+    return more;
+}
+
+
+// Reads the targets from the first record on, returning how many of them
+// were read
+size_t read_records(Input* in, FortranFormat const& format, 
+    FormatTarget const* targets, size_t const count)
+{
+    if (!read_record(in))
+    {
+        return 0;
+    }
+
+    size_t const last = format.items().size();
+    TargetCursor cursor(targets, count);
+    if (format.list_directed())
+    {
+        read_list(in, &cursor);
+    }
+    else if (read_group(in, format, 0, last, &cursor))
+    {
+        // format reversion: the remaining targets from the next records,
+        // left without data edit descriptors to read them
+        size_t const reversion = reversion_point(format);
+        bool const reverts = count_items(format.items(), reversion, last) > 0;
+        while (reverts && has_target(&cursor) && !in->failed)
+        {
+            if (!read_record(in) || 
+                !read_group(in, format, reversion, last, &cursor))
+            {
+                break;
+            }
+        }
+    }
+    return cursor.current - targets;
+}
+
+
+size_t format_scanfor(std::istream& stream, FortranFormat const& format, 
+    FormatTarget const* targets, size_t const count)
+{
+    // records are read into the same string, so that reading doesn't 
+    // allocate once it's grown to the longest record
+    static thread_local std::string line;
+
+    Input in(stream, line);
+    return read_records(&in, format, targets, count);
+}
+
+
+size_t format_from_buffer(char const* src, size_t const size, 
+    FortranFormat const& format, FormatTarget const* targets, 
+    size_t const count, size_t* consumed)
+{
+    Input in(src, size);
+    size_t const read = read_records(&in, format, targets, count);
+    if (consumed != NULL)
+    {
+        *consumed = in.next - src;
+    }
+    return read;
+}
+
+
+//
+// Projected reading
+//
+// Fixed-width fields are at the same columns of every record: a projection
+// knows the line, the columns and the modes of each of its fields, and 
+// decodes them straight from there with the edit readers.
+//
+
+// Mode and position after the items located so far
+struct FieldLocator
+{
+    size_t line;
+    size_t column;
+    bool blank_zero;
+    int scale;
+    // fields to locate, from the first one
+    size_t wanted;
+};
+
+
+inline void advance_column(FieldLocator* const at, size_t const columns)
+{
+    if (at->column != FORMAT_COLUMN_UNKNOWN)
+    {
+        at->column = at->column + columns;
+    }
+}
+
+
+// Appends the fields of a pass over items [first, last), up to at->wanted 
+// of them
+void locate_fields(FormatItemList const& items, size_t const first,
+    size_t const last, FieldLocator* const at, 
+    std::vector<FormatField>* fields)
+{
+    for (size_t n = first; n < last && fields->size() < at->wanted; ++n)
+    {
+        FormatItem const& item = items[n];
+        switch (item.op)
+        {
+            case FOP_GROUP:
+                for (size_t repcount = 0; repcount < item.repeat && 
+                    fields->size() < at->wanted; ++repcount)
+                {
+                    locate_fields(items, n + 1, n + 1 + item.length, at, 
+                        fields);
+                }
+                n = n + item.length;
+            break;
+
+            case FOP_A:
+            case FOP_D:
+            case FOP_E:
+            case FOP_F:
+            case FOP_G:
+            case FOP_I:
+            case FOP_L:
+                for (size_t repcount = 0; repcount < item.repeat && 
+                    fields->size() < at->wanted; ++repcount)
+                {
+                    FormatField field;
+                    field.op         = item.op;
+                    field.width      = item.width;
+                    field.digits     = item.digits;
+                    field.line       = at->line;
+                    field.column     = at->column;
+                    field.blank_zero = at->blank_zero;
+                    field.scale      = at->scale;
+                    fields->push_back(field);
+
+                    // the width of an A edit without one depends on its 
+                    // target
+                    if (0 == item.width)
+                    {
+                        at->column = FORMAT_COLUMN_UNKNOWN;
+                    }
+                    advance_column(at, item.width);
+                }
+            break;
+
+            case FOP_SP:
+            case FOP_SS:
+            break;
+
+            case FOP_BN:
+                at->blank_zero = false;
+            break;
+
+            case FOP_BZ:
+                at->blank_zero = true;
+            break;
+
+            case FOP_P:
+                at->scale = item.scale;
+            break;
+
+            case FOP_X:
+                advance_column(at, item.repeat);
+            break;
+
+            case FOP_STR:
+                advance_column(at, item.length);
+            break;
+
+            case FOP_NL:
+                at->line = at->line + item.repeat;
+                at->column = 0;
+            break;
+        }
+    }
+}
+
+
+void FormatProjection::locate(FortranFormat const& format, 
+    size_t const* positions, size_t const count)
+{
+    FormatItemList const& items = format.items();
+    this->format_ = &format;
+    this->record_lines_ = 1 + count_lines(items, 0, items.size());
+
+    // the fields of a pass up to the last one wanted
+    FieldLocator at;
+    at.line = 0;
+    at.column = 0;
+    at.blank_zero = false;
+    at.scale = 0;
+    at.wanted = 0;
+    for (size_t n = 0; n < count; ++n)
+    {
+        at.wanted = std::max(at.wanted, positions[n] + 1);
+    }
+    std::vector<FormatField> pass;
+    locate_fields(items, 0, items.size(), &at, &pass);
+
+    this->valid_ = true;
+    this->fields_.reserve(count);
+    for (size_t n = 0; n < count; ++n)
+    {
+        if (positions[n] >= pass.size() || 
+            FORMAT_COLUMN_UNKNOWN == pass[positions[n]].column)
+        {
+            this->valid_ = false;
+            this->fields_.clear();
+            return;
+        }
+        this->fields_.push_back(pass[positions[n]]);
+    }
+}
+
+
+FormatProjection::FormatProjection(FortranFormat const& format, 
+    size_t const* positions, size_t const count)
+{
+    this->locate(format, positions, count);
+}
+
+
+// Reads a field with the edit reader of its descriptor
+void read_field(Input* in, FormatField const& field, 
+    FormatTarget const& target)
+{
+    FormatItem item = make_item(field.op, 1);
+    item.width  = field.width;
+    item.digits = field.digits;
+    in->column = field.column;
+    in->blank_zero = field.blank_zero;
+    in->scale = field.scale;
+
+    TargetCursor cursor(&target, 1);
+    switch (field.op)
+    {
+        case FOP_A:
+            read_a(in, item, &cursor);
+        break;
+
+        case FOP_I:
+            read_i(in, item, &cursor);
+        break;
+
+        case FOP_L:
+            read_l(in, item, &cursor);
+        break;
+
+        default:
+            read_real(in, item, &cursor);
+    }
+}
+
+
+// Reads the projected fields of the record starting at the next line of 
+// in, returning how many of them were read before an invalid one. The 
+// lines of the record after the last field read are left to the caller.
+size_t read_projected(Input* in, FormatProjection const& projection, 
+    FormatTarget const* targets, size_t const count)
+{
+    std::vector<FormatField> const& fields = projection.fields();
+    if (!projection.valid())
+    {
+        return 0;
+    }
+    assert(count <= fields.size());
+
+    size_t const before = in->records;
+    if (!read_record(in))
+    {
+        return 0;
+    }
+    Input const first_line = *in;
+
+    size_t read = 0;
+    while (read < count)
+    {
+        FormatField const& field = fields[read];
+
+        // back to the first line for a field on an earlier one
+        size_t const line = field.line + before + 1;
+        if (line < in->records)
+        {
+            *in = first_line;
+        }
+        while (in->records < line && read_record(in))
+        {
+        }
+        if (in->failed)
+        {
+            break;
+        }
+
+        read_field(in, field, targets[read]);
+        if (in->failed)
+        {
+            break;
+        }
+        ++read;
+    }
+    return read;
+}
+
+
+//
+// Mapped files
+//
+
+MappedFile::MappedFile(char const* const path)
+    : data_(""), size_(0), error_(0), mapped_(false)
+{
+#ifdef _WIN32
+    FILE* const file = fopen(path, "rb");
+    if (NULL == file)
+    {
+        this->error_ = errno;
+        return;
+    }
+    std::vector<char> content;
+    char chunk[STREAM_BUFFER_SIZE * 64];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        content.insert(content.end(), chunk, chunk + read);
+    }
+    if (ferror(file))
+    {
+        this->error_ = errno;
+    }
+    fclose(file);
+    if (!content.empty())
+    {
+        char* const data = new char[content.size()];
+        memcpy(data, content.data(), content.size());
+        this->data_ = data;
+        this->size_ = content.size();
+    }
+#else
+    int const fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        this->error_ = errno;
+        return;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        this->error_ = errno;
+        close(fd);
+        return;
+    }
+    // an empty file can't be mapped, and needn't be
+    if (status.st_size > 0)
+    {
+        void* const data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, 
+            fd, 0);
+        if (MAP_FAILED == data)
+        {
+            this->error_ = errno;
+        }
+        else
+        {
+#ifdef MADV_WILLNEED
+            madvise(data, status.st_size, MADV_WILLNEED);
+#endif
+            this->data_ = static_cast<char const*>(data);
+            this->size_ = status.st_size;
+            this->mapped_ = true;
+        }
+    }
+    close(fd);
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (this->size_ > 0)
+    {
+        delete[] this->data_;
+    }
+#else
+    if (this->mapped_)
+    {
+        munmap(const_cast<char*>(this->data_), this->size_);
+    }
+#endif
+}
+
+
+//
+// Record index
+//
+// New lines are found 64 bytes at a time: the bytes are compared with '\n'
+// and the comparison masks turned into a bit per byte, whose set bits are 
+// then counted, or taken one by one as offsets.
+//
+
+enum NewlineScanner
+{
+    NEWLINE_SCANNER_SCALAR,
+    NEWLINE_SCANNER_SSE2,
+    NEWLINE_SCANNER_AVX2
+};
+
+
+// bytes scanned per step by the vectorized scanners
+size_t const NEWLINE_BLOCK = 64;
+
+
+size_t count_newlines_scalar(char const* data, size_t const size)
+{
+    char const* const end = data + size;
+    size_t count = 0;
+    while (data < end)
+    {
+        data = static_cast<char const*>(memchr(data, '\n', end - data));
+        if (NULL == data)
+        {
+            break;
+        }
+        ++count;
+        ++data;
+    }
+    return count;
+}
+
+
+// appends base plus the offset after each new line of data
+void find_newlines_scalar(char const* const data, size_t const size, 
+    size_t const base, std::vector<size_t>* starts)
+{
+    char const* pos = data;
+    char const* const end = data + size;
+    while (pos < end)
+    {
+        pos = static_cast<char const*>(memchr(pos, '\n', end - pos));
+        if (NULL == pos)
+        {
+            break;
+        }
+        ++pos;
+        starts->push_back(base + (pos - data));
+    }
+}
+
+
+#if FORTRANFORMAT_X86_SIMD
+
+// appends offset plus the position after each new line of a mask
+inline void push_newlines(unsigned long long mask, size_t const offset, 
+    std::vector<size_t>* starts)
+{
+    while (mask != 0)
+    {
+        starts->push_back(offset + __builtin_ctzll(mask) + 1);
+        mask = mask & (mask - 1);
+    }
+}
+
+
+__attribute__((target("sse2")))
+inline unsigned long long newline_mask_sse2(char const* const block)
+{
+    __m128i const newline = _mm_set1_epi8('\n');
+    unsigned long long mask = 0;
+    for (int n = 0; n < 4; ++n)
+    {
+        __m128i const bytes = _mm_loadu_si128(
+            reinterpret_cast<__m128i const*>(block + 16 * n));
+        mask = mask | (static_cast<unsigned long long>(static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)))) << (16 * n));
+    }
+    return mask;
+}
+
+
+__attribute__((target("avx2")))
+inline unsigned long long newline_mask_avx2(char const* const block)
+{
+    __m256i const newline = _mm256_set1_epi8('\n');
+    __m256i const low = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const*>(block));
+    __m256i const high = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const*>(block + 32));
+    unsigned int const low_mask = static_cast<unsigned int>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline)));
+    unsigned int const high_mask = static_cast<unsigned int>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)));
+    return low_mask | (static_cast<unsigned long long>(high_mask) << 32);
+}
+
+
+__attribute__((target("sse2,popcnt")))
+size_t count_newlines_sse2(char const* const data, size_t const size)
+{
+    size_t count = 0;
+    size_t n = 0;
+    for (; n + NEWLINE_BLOCK <= size; n = n + NEWLINE_BLOCK)
+    {
+        count = count + __builtin_popcountll(newline_mask_sse2(data + n));
+    }
+    return count + count_newlines_scalar(data + n, size - n);
+}
+
+
+__attribute__((target("avx2,popcnt")))
+size_t count_newlines_avx2(char const* const data, size_t const size)
+{
+    size_t count = 0;
+    size_t n = 0;
+    for (; n + NEWLINE_BLOCK <= size; n = n + NEWLINE_BLOCK)
+    {
+        count = count + __builtin_popcountll(newline_mask_avx2(data + n));
+    }
+    return count + count_newlines_scalar(data + n, size - n);
+}
+
+
+__attribute__((target("sse2")))
+void find_newlines_sse2(char const* const data, size_t const size, 
+    size_t const base, std::vector<size_t>* starts)
+{
+    size_t n = 0;
+    for (; n + NEWLINE_BLOCK <= size; n = n + NEWLINE_BLOCK)
+    {
+        push_newlines(newline_mask_sse2(data + n), base + n, starts);
+    }
+    find_newlines_scalar(data + n, size - n, base + n, starts);
+}
+
+
+__attribute__((target("avx2")))
+void find_newlines_avx2(char const* const data, size_t const size, 
+    size_t const base, std::vector<size_t>* starts)
+{
+    size_t n = 0;
+    for (; n + NEWLINE_BLOCK <= size; n = n + NEWLINE_BLOCK)
+    {
+        push_newlines(newline_mask_avx2(data + n), base + n, starts);
+    }
+    find_newlines_scalar(data + n, size - n, base + n, starts);
+}
+
+#endif
+
+
+// whether the machine running has the scanner's instructions
+bool newline_scanner_supported(NewlineScanner const scanner)
+{
+#if FORTRANFORMAT_X86_SIMD
+    switch (scanner)
+    {
+        case NEWLINE_SCANNER_AVX2:
+            return __builtin_cpu_supports("avx2") && 
+                __builtin_cpu_supports("popcnt");
+        case NEWLINE_SCANNER_SSE2:
+            return __builtin_cpu_supports("sse2") && 
+                __builtin_cpu_supports("popcnt");
+        default:
+            return true;
+    }
+#else
+    return NEWLINE_SCANNER_SCALAR == scanner;
+#endif
+}
+
+
+NewlineScanner best_newline_scanner()
+{
+    static NewlineScanner const scanner = 
+        newline_scanner_supported(NEWLINE_SCANNER_AVX2) ? 
+        NEWLINE_SCANNER_AVX2 : 
+        newline_scanner_supported(NEWLINE_SCANNER_SSE2) ? 
+        NEWLINE_SCANNER_SSE2 : NEWLINE_SCANNER_SCALAR;
+    return scanner;
+}
+
+
+size_t count_newlines(NewlineScanner const scanner, char const* const data, 
+    size_t const size)
+{
+#if FORTRANFORMAT_X86_SIMD
+    if (NEWLINE_SCANNER_AVX2 == scanner)
+    {
+        return count_newlines_avx2(data, size);
+    }
+    if (NEWLINE_SCANNER_SSE2 == scanner)
+    {
+        return count_newlines_sse2(data, size);
+    }
+#endif
+    (void)scanner;
+    return count_newlines_scalar(data, size);
+}
+
+
+void find_newlines(NewlineScanner const scanner, char const* const data, 
+    size_t const size, size_t const base, std::vector<size_t>* starts)
+{
+#if FORTRANFORMAT_X86_SIMD
+    if (NEWLINE_SCANNER_AVX2 == scanner)
+    {
+        find_newlines_avx2(data, size, base, starts);
+        return;
+    }
+    if (NEWLINE_SCANNER_SSE2 == scanner)
+    {
+        find_newlines_sse2(data, size, base, starts);
+        return;
+    }
+#endif
+    (void)scanner;
+    find_newlines_scalar(data, size, base, starts);
+}
+
+
+size_t count_newlines(char const* const data, size_t const size)
+{
+    return count_newlines(best_newline_scanner(), data, size);
+}
+
+
+RecordIndex::RecordIndex()
+{
+    this->build(NULL, 0);
+}
+
+
+RecordIndex::RecordIndex(char const* const src, size_t const size)
+{
+    this->build(src, size);
+}
+
+
+void RecordIndex::build(char const* const src, size_t const size)
+{
+    this->data_ = src;
+    this->size_ = size;
+    this->starts_.clear();
+    this->starts_.push_back(0);
+    if (size > 0)
+    {
+        // (growing the index measured faster than counting its lines first)
+        find_newlines(best_newline_scanner(), src, size, 0, &this->starts_);
+        if (src[size - 1] != '\n')
+        {
+            this->starts_.push_back(size + 1);
+        }
+    }
+}
+
+
+//
+// Parallel reading
+//
+// The input is split in chunks of about the same size, whose new lines are
+// counted first, so that the number of the first line starting in each 
+// chunk is known. Workers then decode the records starting in each chunk 
+// straight from the input, a record being the lines read by a pass over the
+// format.
+//
+
+// chunks per worker, so that uneven ones balance out
+size_t const READ_CHUNKS_PER_WORKER = 8;
+
+// smallest chunk worth handing to a worker, in bytes, or in records of an
+// indexed input
+size_t const READ_MIN_CHUNK = 16384;
+size_t const READ_MIN_CHUNK_RECORDS = 256;
+
+
+// the data edit descriptors of a pass over items [first, last), in order
+void pass_fields(FormatItemList const& items, size_t const first, 
+    size_t const last, std::vector<FormatOp>* fields)
+{
+    for (size_t n = first; n < last; ++n)
+    {
+        FormatItem const& item = items[n];
+        if (item.op == FOP_GROUP)
+        {
+            for (size_t repcount = 0; repcount < item.repeat; ++repcount)
+            {
+                pass_fields(items, n + 1, n + 1 + item.length, fields);
+            }
+            n = n + item.length;
+        }
+        else if (item.op <= FOP_A)
+        {
+            fields->insert(fields->end(), item.repeat, item.op);
+        }
+    }
+}
+
+
+// number of lines, the last one possibly without a new line
+size_t count_input_lines(char const* const src, size_t const size)
+{
+    size_t lines = count_newlines(src, size);
+    if (size > 0 && src[size - 1] != '\n')
+    {
+        ++lines;
+    }
+    return lines;
+}
+
+
+// Shared state of a parallel read
+struct ParallelRead
+{
+    FortranFormat const* format;
+    char const* src;
+    size_t size;
+    // lines and values of a record
+    size_t record_lines;
+    std::vector<FormatOp> fields;
+
+    // either a callback or columns of at most rows values
+    FormatRecordCallback callback;
+    void* context;
+    FormatTarget const* columns;
+    size_t rows;
+    // the fields read, when not all of them
+    FormatProjection const* projection;
+    // vectors sized once the records are counted, becoming the columns
+    FormatColumn const* vectors;
+    std::vector<FormatTarget> vector_columns;
+    // the lines of src, when indexed already: chunks are then of records
+    RecordIndex const* index;
+    size_t records;
+
+    size_t chunk_size;
+    size_t chunks;
+    // new lines before each chunk
+    std::vector<size_t> chunk_lines;
+
+    std::atomic<size_t> next_chunk;
+    // first record with an invalid field
+    std::atomic<size_t> failed;
+};
+
+
+inline size_t column_stride(FormatTarget const& column)
+{
+    return FTGT_STRING == column.type ? sizeof(std::string) : column.size;
+}
+
+
+void note_failed(ParallelRead* const job, size_t const record)
+{
+    size_t failed = job->failed.load();
+    while (record < failed && 
+        !job->failed.compare_exchange_weak(failed, record))
+    {
+    }
+}
+
+
+void count_chunk_lines(ParallelRead* const job)
+{
+    for (;;)
+    {
+        size_t const chunk = job->next_chunk.fetch_add(1);
+        if (chunk >= job->chunks)
+        {
+            break;
+        }
+        size_t const first = chunk * job->chunk_size;
+        size_t const last = std::min(job->size, first + job->chunk_size);
+        job->chunk_lines[chunk + 1] = count_newlines(job->src + first, 
+            last - first);
+    }
+}
+
+
+// Reads a record from in into its row of the columns, or for the callback;
+// false when the columns have no row for it
+bool read_job_record(ParallelRead* const job, Input* const in, 
+    size_t const record, std::vector<FormatTarget>& targets, 
+    std::vector<FormatArg>& values)
+{
+    size_t const count = job->fields.size();
+    if (job->columns != NULL)
+    {
+        if (record >= job->rows)
+        {
+            note_failed(job, record);
+            return false;
+        }
+        for (size_t n = 0; n < count; ++n)
+        {
+            targets[n] = job->columns[n];
+            targets[n].pointer = static_cast<char*>(targets[n].pointer) + 
+                record * column_stride(job->columns[n]);
+        }
+    }
+
+    in->single_record = true;
+    size_t const read = NULL == job->projection ? 
+        read_records(in, *job->format, targets.data(), count) :
+        read_projected(in, *job->projection, targets.data(), count);
+    if (read < count)
+    {
+        note_failed(job, record);
+    }
+    else if (job->callback != NULL)
+    {
+        job->callback(job->context, record, values.data(), count);
+    }
+    return true;
+}
+
+
+// Reads the records starting in the chunk
+void read_chunk(ParallelRead* const job, size_t const chunk, 
+    std::vector<FormatTarget>& targets, std::vector<FormatArg>& values)
+{
+    char const* const end = job->src + job->size;
+    char const* const first = job->src + chunk * job->chunk_size;
+    char const* const last = job->src + std::min(job->size, 
+        (chunk + 1) * job->chunk_size);
+
+    // the first line starting in the chunk, and the first record
+    char const* pos = first;
+    size_t line = job->chunk_lines[chunk];
+    if (pos > job->src && pos[-1] != '\n')
+    {
+        pos = static_cast<char const*>(memchr(pos, '\n', last - pos));
+        if (NULL == pos)
+        {
+            return;
+        }
+        ++pos;
+        ++line;
+    }
+    while (pos < last && line % job->record_lines != 0)
+    {
+        pos = static_cast<char const*>(memchr(pos, '\n', end - pos));
+        if (NULL == pos)
+        {
+            return;
+        }
+        ++pos;
+        ++line;
+    }
+
+    for (size_t record = line / job->record_lines; pos < last; ++record)
+    {
+        Input in(pos, end - pos);
+        if (!read_job_record(job, &in, record, targets, values))
+        {
+            return;
+        }
+
+        // the lines of the record left unread, if any
+        while (in.records < job->record_lines && read_record(&in))
+        {
+        }
+        pos = in.next;
+    }
+}
+
+
+// Reads the records of the chunk, from the index
+void read_indexed_chunk(ParallelRead* const job, size_t const chunk, 
+    std::vector<FormatTarget>& targets, std::vector<FormatArg>& values)
+{
+    size_t const first = chunk * job->chunk_size;
+    size_t const last = std::min(job->records, first + job->chunk_size);
+    for (size_t record = first; record < last; ++record)
+    {
+        Input in(*job->index, record * job->record_lines);
+        if (!read_job_record(job, &in, record, targets, values))
+        {
+            return;
+        }
+    }
+}
+
+
+void read_worker(ParallelRead* const job)
+{
+    // callbacks take the values of a record from here
+    size_t const count = job->fields.size();
+    std::vector<FormatArg> values(count + 1);
+    std::vector<FormatTarget> targets(count + 1);
+    for (size_t n = 0; n < count && NULL == job->columns; ++n)
+    {
+        FormatArg& value = values[n];
+        switch (job->fields[n])
+        {
+            case FOP_I:
+                value.type = FARG_INT;
+                targets[n] = make_format_target(&value.integer);
+            break;
+
+            case FOP_L:
+                value.type = FARG_BOOL;
+                targets[n] = make_format_target(&value.logical);
+            break;
+
+            case FOP_A:
+                value.type = FARG_STRING;
+                targets[n] = make_format_target(&value.string);
+            break;
+
+            default:
+                value.type = FARG_DOUBLE;
+                targets[n] = make_format_target(&value.real);
+        }
+    }
+
+    for (;;)
+    {
+        size_t const chunk = job->next_chunk.fetch_add(1);
+        if (chunk >= job->chunks)
+        {
+            break;
+        }
+        if (NULL == job->index)
+        {
+            read_chunk(job, chunk, targets, values);
+        }
+        else
+        {
+            read_indexed_chunk(job, chunk, targets, values);
+        }
+    }
+}
+
+
+size_t format_read_parallel(ParallelRead* const job, 
+    FortranFormat const& format, char const* const src, size_t const size, 
+    unsigned int threads)
+{
+    FormatItemList const& items = format.items();
+
+    job->format = &format;
+    job->src = src;
+    job->size = size;
+    job->record_lines = 1 + count_lines(items, 0, items.size());
+    if (job->projection != NULL)
+    {
+        std::vector<FormatField> const& fields = job->projection->fields();
+        for (size_t n = 0; n < fields.size(); ++n)
+        {
+            job->fields.push_back(fields[n].op);
+        }
+    }
+    else if (!format.list_directed())
+    {
+        pass_fields(items, 0, items.size(), &job->fields);
+    }
+    job->failed = ~size_t(0);
+
+    if (0 == threads)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<std::thread> workers;
+    size_t lines = 0;
+    if (job->index != NULL)
+    {
+        // chunks of whole records, whose lines are known
+        lines = job->index->lines();
+        size_t const records = 
+            (lines + job->record_lines - 1) / job->record_lines;
+        job->chunk_size = std::max(READ_MIN_CHUNK_RECORDS, 
+            records / (threads * READ_CHUNKS_PER_WORKER) + 1);
+        job->chunks = (records + job->chunk_size - 1) / job->chunk_size;
+    }
+    else
+    {
+        job->chunk_size = std::max(READ_MIN_CHUNK, 
+            size / (threads * READ_CHUNKS_PER_WORKER) + 1);
+        job->chunks = (size + job->chunk_size - 1) / job->chunk_size;
+    }
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, 
+        std::max(size_t(1), job->chunks)));
+
+    if (NULL == job->index)
+    {
+        // new lines per chunk, then before each chunk
+        job->chunk_lines.assign(job->chunks + 1, 0);
+        job->next_chunk = 0;
+        for (unsigned int n = 1; n < threads; ++n)
+        {
+            workers.push_back(std::thread(count_chunk_lines, job));
+        }
+        count_chunk_lines(job);
+        for (size_t n = 0; n < workers.size(); ++n)
+        {
+            workers[n].join();
+        }
+        for (size_t n = 1; n <= job->chunks; ++n)
+        {
+            job->chunk_lines[n] = 
+                job->chunk_lines[n] + job->chunk_lines[n - 1];
+        }
+        // and the last line, without a new line
+        lines = job->chunk_lines[job->chunks];
+        if (size > 0 && src[size - 1] != '\n')
+        {
+            ++lines;
+        }
+    }
+    size_t const records = 
+        (lines + job->record_lines - 1) / job->record_lines;
+    job->records = records;
+
+    if (job->vectors != NULL)
+    {
+        for (size_t n = 0; n < job->fields.size(); ++n)
+        {
+            FormatColumn const& vector = job->vectors[n];
+            FormatTarget column = vector.element;
+            column.pointer = vector.resize(vector.vector, records);
+            job->vector_columns.push_back(column);
+        }
+        job->columns = job->vector_columns.data();
+        job->rows = records;
+    }
+
+    // records
+    workers.clear();
+    job->next_chunk = 0;
+    for (unsigned int n = 1; n < threads; ++n)
+    {
+        workers.push_back(std::thread(read_worker, job));
+    }
+    read_worker(job);
+    for (size_t n = 0; n < workers.size(); ++n)
+    {
+        workers[n].join();
+    }
+
+    return std::min(records, job->failed.load());
+}
+
+
+// Columns of a pass over items [first, last), new lines included, or 
+// FORMAT_COLUMN_UNKNOWN with an A edit without a width
+size_t pass_columns(FormatItemList const& items, size_t const first,
+    size_t const last)
+{
+    size_t columns = 0;
+    for (size_t n = first; n < last; ++n)
+    {
+        FormatItem const& item = items[n];
+        size_t length = 0;
+        if (item.op == FOP_GROUP)
+        {
+            length = pass_columns(items, n + 1, n + 1 + item.length);
+            if (FORMAT_COLUMN_UNKNOWN == length)
+            {
+                return length;
+            }
+            length = length * item.repeat;
+            n = n + item.length;
+        }
+        else if (item.op == FOP_A && 0 == item.width)
+        {
+            return FORMAT_COLUMN_UNKNOWN;
+        }
+        else if (item.op <= FOP_A)
+        {
+            length = item.width * item.repeat;
+        }
+        else if (item.op == FOP_X || item.op == FOP_NL)
+        {
+            length = item.repeat;
+        }
+        else if (item.op == FOP_STR)
+        {
+            length = item.length;
+        }
+        columns = columns + length;
+    }
+    return columns;
+}
+
+
+// Reads into vectors: they're reserved the records that full-length lines
+// would make, sized to the records counted, then to the records read
+size_t format_read_vectors(ParallelRead* const job, 
+    FortranFormat const& format, char const* const src, size_t const size, 
+    FormatColumn const* columns, size_t const count, 
+    unsigned int const threads)
+{
+    FormatItemList const& items = format.items();
+    size_t const record_length = pass_columns(items, 0, items.size());
+    if (record_length != FORMAT_COLUMN_UNKNOWN)
+    {
+        // and the new line ending the record
+        size_t const estimate = size / (record_length + 1) + 1;
+        for (size_t n = 0; n < count; ++n)
+        {
+            columns[n].reserve(columns[n].vector, estimate);
+        }
+    }
+
+    job->callback = NULL;
+    job->context = NULL;
+    job->columns = NULL;
+    job->rows = 0;
+    job->vectors = columns;
+    if (format.list_directed())
+    {
+        job->fields.assign(count, FOP_G);
+    }
+    size_t const read = format_read_parallel(job, format, src, size, threads);
+    for (size_t n = 0; n < count; ++n)
+    {
+        columns[n].resize(columns[n].vector, read);
+    }
+    return read;
+}
+
+
+//
+// Format cache
+//
+
+// Each thread keeps its own cache of compiled formats, so that the lookup
+// never takes a lock. Entries are found by the format string address and, 
+// when the address is unknown (e.g. a format built in a buffer), by the hash
+// of its contents. The least recently used entry is evicted first.
+
+struct CachedFormat
+{
+    std::string source;
+    size_t hash;
+    FortranFormat format;
+    // addresses the format string was seen at
+    std::vector<char const*> addresses;
+
+    CachedFormat(char const* const formatstr, size_t const hash)
+        : source(formatstr), hash(hash), format(formatstr)
+    {
+    }
+};
+
+
+typedef std::list<CachedFormat> CachedFormatList;
+
+
+// counters written by the owner thread only, read by format_cache_stats
+struct CacheCounters
+{
+    std::atomic<unsigned long long> hits;
+    std::atomic<unsigned long long> misses;
+    std::atomic<unsigned long long> evictions;
+    // entries of by_address
+    std::atomic<unsigned long long> addresses;
+
+    CacheCounters() : hits(0), misses(0), evictions(0), addresses(0)
+    {
+    }
+};
+
+
+struct FormatCache
+{
+    // most recently used first
+    CachedFormatList entries;
+    std::unordered_map<char const*, CachedFormatList::iterator> by_address;
+    std::unordered_multimap<size_t, CachedFormatList::iterator> by_hash;
+    // last compiled format, when caching is disabled
+    std::unique_ptr<FortranFormat> uncached;
+    CacheCounters counters;
+
+    FormatCache();
+    ~FormatCache();
+};
+
+
+// registry of the live thread caches, for statistics only
+struct FormatCacheRegistry
+{
+    std::mutex mutex;
+    std::vector<FormatCache const*> caches;
+    // counters of the threads that already exited
+    FormatCacheStats retired;
+
+    FormatCacheRegistry()
+    {
+        this->retired.hits      = 0;
+        this->retired.misses    = 0;
+        this->retired.evictions = 0;
+        this->retired.addresses = 0;
+    }
+};
+
+
+std::atomic<size_t> format_cache_capacity_(DEFAULT_FORMAT_CACHE_CAPACITY);
+
+
+FormatCacheRegistry& format_cache_registry()
+{
+    static FormatCacheRegistry registry;
+    return registry;
+}
+
+
+FormatCache::FormatCache()
+{
+    FormatCacheRegistry& registry = format_cache_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.caches.push_back(this);
+}
+
+
+FormatCache::~FormatCache()
+{
+    FormatCacheRegistry& registry = format_cache_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.retired.hits      += this->counters.hits.load();
+    registry.retired.misses    += this->counters.misses.load();
+    registry.retired.evictions += this->counters.evictions.load();
+    for (size_t n = 0; n < registry.caches.size(); ++n)
+    {
+        if (registry.caches[n] == this)
+        {
+            registry.caches.erase(registry.caches.begin() + n);
+            break;
+        }
+    }
+}
+
+
+inline void increment(std::atomic<unsigned long long>& counter)
+{
+    // single writer, no need for an atomic read-modify-write
+    counter.store(counter.load(std::memory_order_relaxed) + 1, 
+        std::memory_order_relaxed);
+}
+
+
+inline void decrement(std::atomic<unsigned long long>& counter)
+{
+    counter.store(counter.load(std::memory_order_relaxed) - 1, 
+        std::memory_order_relaxed);
+}
+
+
+// Remembers another address of the format of entry, forgetting its oldest
+// one past MAX_FORMAT_ADDRESSES: formats built in ever new buffers would
+// otherwise grow by_address without bound
+void add_format_address(FormatCache* cache, CachedFormatList::iterator entry,
+    char const* const formatstr)
+{
+    std::vector<char const*>& addresses = entry->addresses;
+    if (addresses.size() >= MAX_FORMAT_ADDRESSES)
+    {
+        cache->by_address.erase(addresses.front());
+        addresses.erase(addresses.begin());
+        decrement(cache->counters.addresses);
+    }
+    addresses.push_back(formatstr);
+    cache->by_address[formatstr] = entry;
+    increment(cache->counters.addresses);
+}
+
+
+size_t format_hash(char const* formatstr)
+{
+    // FNV-1a
+    size_t hash = static_cast<size_t>(14695981039346656037ULL);
+    for (; *formatstr != '\0'; ++formatstr)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*formatstr)) * 
+            static_cast<size_t>(1099511628211ULL);
+    }
+    return hash;
+}
+
+
+void evict_format(FormatCache* cache)
+{
+    CachedFormatList::iterator last = --cache->entries.end();
+    for (size_t n = 0; n < last->addresses.size(); ++n)
+    {
+        cache->by_address.erase(last->addresses[n]);
+        decrement(cache->counters.addresses);
+    }
+
+    typedef std::unordered_multimap<size_t, CachedFormatList::iterator>::iterator
+        HashIterator;
+    std::pair<HashIterator, HashIterator> range = 
+        cache->by_hash.equal_range(last->hash);
+    for (HashIterator it = range.first; it != range.second; ++it)
+    {
+        if (it->second == last)
+        {
+            cache->by_hash.erase(it);
+            break;
+        }
+    }
+
+    cache->entries.erase(last);
+    increment(cache->counters.evictions);
+}
+
+
+FortranFormat const& cached_format(char const* const formatstr)
+{
+    static thread_local FormatCache cache;
+
+    // known address, as long as its contents did not change
+    std::unordered_map<char const*, CachedFormatList::iterator>::iterator 
+        address = cache.by_address.find(formatstr);
+    if (address != cache.by_address.end())
+    {
+        CachedFormatList::iterator entry = address->second;
+        if (strcmp(entry->source.c_str(), formatstr) == 0)
+        {
+            cache.entries.splice(cache.entries.begin(), cache.entries, entry);
+            increment(cache.counters.hits);
+            return entry->format;
+        }
+        // the buffer was reused for another format
+        std::vector<char const*>& addresses = entry->addresses;
+        for (size_t n = 0; n < addresses.size(); ++n)
+        {
+            if (addresses[n] == formatstr)
+            {
+                addresses.erase(addresses.begin() + n);
+                break;
             }
         }
-        else
+        cache.by_address.erase(address);
+        decrement(cache.counters.addresses);
+    }
+
+    // same contents at another address
+    size_t const hash = format_hash(formatstr);
+    typedef std::unordered_multimap<size_t, CachedFormatList::iterator>::iterator
+        HashIterator;
+    std::pair<HashIterator, HashIterator> range = 
+        cache.by_hash.equal_range(hash);
+    for (HashIterator it = range.first; it != range.second; ++it)
+    {
+        CachedFormatList::iterator entry = it->second;
+        if (strcmp(entry->source.c_str(), formatstr) == 0)
         {
-            format_i(put, rounded_intval, width - 1, 0, plus_sign);
-            put[width - 1] = '.';
+            cache.entries.splice(cache.entries.begin(), cache.entries, entry);
+            add_format_address(&cache, entry, formatstr);
+            increment(cache.counters.hits);
+            return entry->format;
         }
     }
-    else
+
+    // compile and insert
+    increment(cache.counters.misses);
+    size_t const capacity = format_cache_capacity_.load(std::memory_order_relaxed);
+    while (!cache.entries.empty() && cache.entries.size() >= capacity)
+    {
+        evict_format(&cache);
+    }
+    if (0 == capacity)
+    {
+        // caching disabled, keep only the last compiled format alive
+        cache.uncached.reset(new FortranFormat(formatstr));
+        return *cache.uncached;
+    }
+
+    cache.entries.push_front(CachedFormat(formatstr, hash));
+    CachedFormatList::iterator entry = cache.entries.begin();
+    add_format_address(&cache, entry, formatstr);
+    cache.by_hash.insert(std::make_pair(hash, entry));
+    return entry->format;
+}
+
+
+void set_format_cache_capacity(size_t const capacity)
+{
+    format_cache_capacity_.store(capacity);
+}
+
+
+size_t format_cache_capacity()
+{
+    return format_cache_capacity_.load();
+}
+
+
+FormatCacheStats format_cache_stats()
+{
+    FormatCacheRegistry& registry = format_cache_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    FormatCacheStats stats = registry.retired;
+    for (size_t n = 0; n < registry.caches.size(); ++n)
+    {
+        CacheCounters const& counters = registry.caches[n]->counters;
+        stats.hits      += counters.hits.load(std::memory_order_relaxed);
+        stats.misses    += counters.misses.load(std::memory_order_relaxed);
+        stats.evictions += counters.evictions.load(std::memory_order_relaxed);
+        stats.addresses += counters.addresses.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+
+//
+// Deferred logging
+//
+// Every logging thread has a single-producer, single-consumer ring of each
+// logger: the producer appends records at head, and the consumer formats 
+// them and moves tail past them. Positions only grow, their offset in the 
+// ring being the position modulo its size. A record is contiguous: one that
+// doesn't fit before the end of the ring starts over at its beginning, the
+// rest being skipped (marked as such when there's room for a header).
+//
+
+// the consumer waits this long for records when it finds none
+std::chrono::microseconds const LOG_IDLE_WAIT(1000);
+
+// distance between data written by different threads
+size_t const CACHE_LINE = 64;
+
+
+// Header of a record, followed by its arguments and then by their strings
+struct LogRecord
+{
+    // NULL for the rest of the ring, skipped
+    FortranFormat const* format;
+    size_t count;
+    // bytes taken in the ring, header included
+    size_t size;
+};
+
+
+struct LogRing
+{
+    // the producer's
+    std::atomic<size_t> head;
+    // last tail seen by the producer, which has room up to it
+    size_t tail_seen;
+    std::atomic<unsigned long long> dropped;
+    char producer_line[CACHE_LINE];
+
+    // the consumer's
+    std::atomic<size_t> tail;
+    char consumer_line[CACHE_LINE];
+
+    std::vector<char> storage;
+    size_t mask;
+    // rings are listed from the last one registered
+    LogRing* next;
+    // the logger, and the thread logging into the ring if any: a ring of a
+    // thread that exited is taken by the next one, and the last user 
+    // deletes it
+    std::atomic<unsigned int> users;
+
+    explicit LogRing(size_t const size) 
+        : head(0), tail_seen(0), dropped(0), tail(0), storage(size), 
+          mask(size - 1), next(NULL), users(2)
+    {
+    }
+};
+
+
+struct LogState
+{
+    FormatSink* sink;
+    LogOverflow overflow;
+    size_t ring_size;
+    unsigned long long id;
+    std::atomic<LogRing*> rings;
+
+    // registration of rings, and waiting
+    std::mutex mutex;
+    std::condition_variable work;
+    std::condition_variable flushed;
+    std::condition_variable room;
+    std::atomic<unsigned long long> flush_requested;
+    unsigned long long flush_done;
+    // producers waiting for room (LOG_BLOCK), and how many times they did
+    std::atomic<unsigned int> blocked;
+    std::atomic<unsigned long long> wakeups;
+    std::atomic<bool> stopping;
+    std::thread consumer;
+};
+
+
+// loggers and record queues are told apart by an id, never reused, rather
+// than by address
+std::atomic<unsigned long long> next_owner_id(1);
+
+
+// What a thread keeps for a logger or a record queue, owned by the latter
+// unless it's released by the thread
+struct ThreadObject
+{
+    unsigned long long owner;
+    void* object;
+    // called when the thread exits, or NULL
+    void (*release)(void* object);
+    // whether the owner is gone, the object being the thread's alone
+    bool (*abandoned)(void const* object);
+};
+
+
+// The objects of a thread, released when it exits
+struct ThreadObjects
+{
+    std::vector<ThreadObject> objects;
+
+    ~ThreadObjects()
     {
-        // actual length, possibly including a leading zero for x < 1.0
-        size_t len = maxlen;
-        bool include_leading_zero = width > len && optional_intvalue;
-        if (include_leading_zero)
+        for (size_t n = 0; n < this->objects.size(); ++n)
         {
-            // include optional 0 in the maxlen, if its not accounted for initially
-            len = len + 1;
+            if (this->objects[n].release != NULL)
+            {
+                this->objects[n].release(this->objects[n].object);
+            }
         }
-        size_t pos = 0;
+    }
+};
 
-        // right-alignment whitespace
-        if (width > len)
+
+thread_local ThreadObject last_thread_object = { 0, NULL, NULL, NULL };
+thread_local ThreadObjects thread_objects;
+
+
+// the calling thread's object for owner, or NULL
+void* find_thread_object(unsigned long long const owner)
+{
+    if (last_thread_object.owner == owner)
+    {
+        return last_thread_object.object;
+    }
+    std::vector<ThreadObject> const& objects = thread_objects.objects;
+    for (size_t n = 0; n < objects.size(); ++n)
+    {
+        if (objects[n].owner == owner)
+        {
+            last_thread_object = objects[n];
+            return last_thread_object.object;
+        }
+    }
+    return NULL;
+}
+
+
+// Registers the object of the calling thread for owner, after releasing 
+// those whose owners are gone
+void add_thread_object(unsigned long long const owner, void* const object,
+    void (*release)(void*) = NULL, bool (*abandoned)(void const*) = NULL)
+{
+    std::vector<ThreadObject>& objects = thread_objects.objects;
+    size_t kept = 0;
+    for (size_t n = 0; n < objects.size(); ++n)
+    {
+        if (objects[n].abandoned != NULL && 
+            objects[n].abandoned(objects[n].object))
+        {
+            objects[n].release(objects[n].object);
+            continue;
+        }
+        objects[kept] = objects[n];
+        kept = kept + 1;
+    }
+    objects.resize(kept);
+
+    last_thread_object.owner = owner;
+    last_thread_object.object = object;
+    last_thread_object.release = release;
+    last_thread_object.abandoned = abandoned;
+    objects.push_back(last_thread_object);
+}
+
+
+// drops a user of the ring, deleting it after the last one
+void release_ring(LogRing* const ring)
+{
+    if (ring->users.fetch_sub(1) == 1)
+    {
+        delete ring;
+    }
+}
+
+
+// when the thread logging into the ring exits
+void release_thread_ring(void* const ring)
+{
+    release_ring(static_cast<LogRing*>(ring));
+}
+
+
+bool thread_ring_abandoned(void const* const ring)
+{
+    return static_cast<LogRing const*>(ring)->users.load() == 1;
+}
+
+
+// The calling thread's ring of the logger, registered on first use: that of
+// a thread that exited, or a new one
+LogRing* thread_ring(LogState* const state)
+{
+    LogRing* ring = static_cast<LogRing*>(find_thread_object(state->id));
+    if (ring != NULL)
+    {
+        return ring;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        for (ring = state->rings.load(std::memory_order_relaxed); 
+            ring != NULL; ring = ring->next)
         {
-            for (;pos < width - len; ++pos)
+            // the records left by the last thread come first
+            unsigned int users = 1;
+            if (ring->users.compare_exchange_strong(users, 2))
             {
-                put[pos] = ' ';
-            } 
+                break;
+            }
+        }
+        if (NULL == ring)
+        {
+            ring = new LogRing(state->ring_size);
+            ring->next = state->rings.load(std::memory_order_relaxed);
+            state->rings.store(ring, std::memory_order_release);
         }
+    }
+    add_thread_object(state->id, ring, release_thread_ring, 
+        thread_ring_abandoned);
+    return ring;
+}
 
-        // minus sign
-        if (require_sign)
+
+inline size_t align_record(size_t const size)
+{
+    return (size + alignof(FormatArg) - 1) & ~(alignof(FormatArg) - 1);
+}
+
+
+// bytes of the string arguments, array elements included
+size_t string_bytes(FormatArg const* args, size_t const count, 
+    size_t* values)
+{
+    size_t bytes = 0;
+    *values = 0;
+    for (size_t n = 0; n < count; ++n)
+    {
+        FormatArg const& arg = args[n];
+        if (FARG_STRING == arg.type)
+        {
+            bytes = bytes + arg.string.length;
+        }
+        else if (FARG_ARRAY == arg.type)
         {
-            if (is_negative(value))
+            for (size_t e = 0; e < arg.array.length; ++e)
             {
-                put[pos] = '-'; 
+                FormatArg const value = arg.array.element(arg.array.data, e);
+                if (FARG_STRING == value.type)
+                {
+                    bytes = bytes + value.string.length;
+                }
             }
-            else
+            *values = *values + arg.array.length;
+            continue;
+        }
+        *values = *values + 1;
+    }
+    return bytes;
+}
+
+
+// Copies the arguments to values, arrays as their elements, and their 
+// strings to strings
+void copy_args(FormatArg* value, char* strings, FormatArg const* args, 
+    size_t const count)
+{
+    for (size_t n = 0; n < count; ++n)
+    {
+        size_t const length = FARG_ARRAY == args[n].type ? 
+            args[n].array.length : 1;
+        for (size_t e = 0; e < length; ++e)
+        {
+            *value = FARG_ARRAY == args[n].type ? 
+                args[n].array.element(args[n].array.data, e) : args[n];
+            if (FARG_STRING == value->type)
             {
-                put[pos] = '+';
+                memcpy(strings, value->string.data, value->string.length);
+                value->string.data = strings;
+                strings = strings + value->string.length;
             }
-            
-            pos = pos + 1;
-        } 
+            value = value + 1;
+        }
+    }
+}
+
+
+// Copies the arguments after the header at record, with their strings
+void copy_record(char* const record, FormatArg const* args, size_t const count)
+{
+    LogRecord const* const header = reinterpret_cast<LogRecord*>(record);
+    FormatArg* const values = reinterpret_cast<FormatArg*>(record + 
+        align_record(sizeof(LogRecord)));
+    copy_args(values, reinterpret_cast<char*>(values + header->count), args, 
+        count);
+}
+
+
+// Formats the records logged up to now, returning whether there were any
+bool drain_ring(LogState* const state, LogRing* const ring)
+{
+    size_t const size = ring->mask + 1;
+    size_t const head = ring->head.load(std::memory_order_acquire);
+    size_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail == head)
+    {
+        return false;
+    }
+
+    while (tail != head)
+    {
+        size_t const offset = tail & ring->mask;
+        LogRecord const* const record = 
+            reinterpret_cast<LogRecord const*>(&ring->storage[offset]);
+        if (size - offset < sizeof(LogRecord) || NULL == record->format)
+        {
+            tail = tail + (size - offset);
+            continue;
+        }
+        FormatArg const* const args = reinterpret_cast<FormatArg const*>(
+            &ring->storage[offset] + align_record(sizeof(LogRecord)));
+        format_printfor(*state->sink, *record->format, args, record->count);
+        tail = tail + record->size;
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    // ordered before the consumer looks for blocked producers
+    ring->tail.store(tail);
+    return true;
+}
+
+
+void log_consumer(LogState* const state)
+{
+    bool written = false;
+    for (;;)
+    {
+        // what was logged before these were requested is drained below
+        unsigned long long const request = state->flush_requested.load();
+        unsigned long long const wakeups = state->wakeups.load();
+        bool const stopping = state->stopping.load();
+
+        bool drained = false;
+        for (LogRing* ring = state->rings.load(std::memory_order_acquire); 
+            ring != NULL; ring = ring->next)
+        {
+            drained = drain_ring(state, ring) || drained;
+        }
+        written = written || drained;
 
-        // leading zero
-        if (include_leading_zero)
+        // blocked producers check the tails after saying so
+        if (drained && state->blocked.load() > 0)
         {
-            put[pos] = '0';
-            pos = pos + 1;
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->room.notify_all();
         }
-        else if (intval != 0)
+
+        if (request != state->flush_done)
         {
-            // integer part value
-            for(size_t n = 0; n < INTLEN; ++n, ++pos)
-            {
-                put[pos] = intstr[n];
-            }
+            state->sink->flush();
+            written = false;
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->flush_done = request;
+            state->flushed.notify_all();
+        }
+        if (drained)
+        {
+            continue;
+        }
+        if (stopping)
+        {
+            break;
         }
-        put[pos] = '.';
-        pos = pos + 1;
 
-        // fractional part value
-        for(size_t n = 0; n < FRACLEN; ++n, ++pos)
+        // idle: records don't wait in the sink's buffer
+        if (written)
         {
-            put[pos] = fracstr[n];
-        }   
+            state->sink->flush();
+            written = false;
+        }
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->work.wait_for(lock, LOG_IDLE_WAIT, 
+            [state, request, wakeups]() {
+                return state->stopping.load() || 
+                    state->flush_requested.load() != request ||
+                    state->wakeups.load() != wakeups;
+            });
     }
-    put[width] = '\0';
+    state->sink->flush();
 }
 
 
-void format_e(char* put, double const value, size_t const width, 
-    size_t const precision, char const expchar, size_t const exponent_width,
-    bool const plus_sign)
+FormatLogger::FormatLogger(FormatSink& sink, size_t const ring_size, 
+    LogOverflow const overflow)
+    : state_(new LogState)
 {
-    assert(exponent_width > 0);
+    // a power of two, holding at least a record without arguments
+    size_t size = 1;
+    while (size < std::max(ring_size, align_record(sizeof(LogRecord))))
+    {
+        size = size * 2;
+    }
 
-    double absvalue = fabs(value);
-    bool require_sign = is_negative(value) || plus_sign;
+    LogState* const state = this->state_;
+    state->sink = &sink;
+    state->overflow = overflow;
+    state->ring_size = size;
+    state->id = next_owner_id.fetch_add(1);
+    state->rings = NULL;
+    state->flush_requested = 0;
+    state->flush_done = 0;
+    state->blocked = 0;
+    state->wakeups = 0;
+    state->stopping = false;
+    state->consumer = std::thread(log_consumer, state);
+}
 
-    // minimum length without leading zero
-    // . precision D+00, ., D, and + = 3
-    size_t const FORMATCHARS = 3;
-    size_t const MINLEN = require_sign + FORMATCHARS + precision + exponent_width;
 
-    // check whether there's space for a leading zero
-    bool include_leading_zero = width > MINLEN;
-    size_t const LEN = MINLEN + include_leading_zero;
+FormatLogger::~FormatLogger()
+{
+    LogState* const state = this->state_;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->stopping = true;
+        state->work.notify_one();
+    }
+    state->consumer.join();
 
-    size_t pos = 0;
-    if (LEN > width)
+    // rings still logged into are deleted by their threads
+    LogRing* ring = state->rings.load();
+    while (ring != NULL)
     {
-        fill_with_char(put, OVERFLOW_FILL_CHAR, width);
-        pos = pos + width;
+        LogRing* const next = ring->next;
+        release_ring(ring);
+        ring = next;
+    }
+    delete state;
+}
+
+
+bool FormatLogger::log_args(FortranFormat const& format, 
+    FormatArg const* args, size_t const count)
+{
+    LogState* const state = this->state_;
+    LogRing* const ring = thread_ring(state);
+
+    size_t values;
+    size_t const strings = string_bytes(args, count, &values);
+    size_t const record_size = align_record(align_record(sizeof(LogRecord)) +
+        values * sizeof(FormatArg) + strings);
+
+    // a record that doesn't fit before the end of the ring starts over
+    size_t const size = ring->mask + 1;
+    size_t const head = ring->head.load(std::memory_order_relaxed);
+    size_t const offset = head & ring->mask;
+    size_t const skipped = offset + record_size > size ? size - offset : 0;
+    if (record_size > size)
+    {
+        increment(ring->dropped);
+        return false;
+    }
+    size_t const end = head + skipped + record_size;
+    if (end - ring->tail_seen > size)
+    {
+        ring->tail_seen = ring->tail.load(std::memory_order_acquire);
+    }
+    if (end - ring->tail_seen > size && LOG_DROP == state->overflow)
+    {
+        increment(ring->dropped);
+        return false;
+    }
+    if (end - ring->tail_seen > size)
+    {
+        // wakes the consumer up, which wakes producers up once it's drained
+        // some records
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->blocked.fetch_add(1);
+        state->wakeups.fetch_add(1);
+        state->work.notify_one();
+        state->room.wait(lock, [ring, end, size]() {
+            ring->tail_seen = ring->tail.load();
+            return end - ring->tail_seen <= size;
+        });
+        state->blocked.fetch_sub(1);
+    }
+
+    if (skipped >= sizeof(LogRecord))
+    {
+        LogRecord* const rest = 
+            reinterpret_cast<LogRecord*>(&ring->storage[offset]);
+        rest->format = NULL;
+    }
+    char* const record = &ring->storage[(head + skipped) & ring->mask];
+    LogRecord* const header = reinterpret_cast<LogRecord*>(record);
+    header->format = &format;
+    header->count = values;
+    header->size = record_size;
+    copy_record(record, args, count);
+
+    ring->head.store(end, std::memory_order_release);
+    return true;
+}
+
+
+void FormatLogger::flush()
+{
+    LogState* const state = this->state_;
+    std::unique_lock<std::mutex> lock(state->mutex);
+    unsigned long long const request = state->flush_requested.load() + 1;
+    state->flush_requested.store(request);
+    state->work.notify_one();
+    state->flushed.wait(lock, [state, request]() {
+        return state->flush_done >= request;
+    });
+}
+
+
+unsigned long long FormatLogger::dropped() const
+{
+    unsigned long long dropped = 0;
+    for (LogRing* ring = this->state_->rings.load(); ring != NULL; 
+        ring = ring->next)
+    {
+        dropped = dropped + ring->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+
+size_t FormatLogger::rings() const
+{
+    size_t rings = 0;
+    for (LogRing* ring = this->state_->rings.load(); ring != NULL; 
+        ring = ring->next)
+    {
+        rings = rings + 1;
+    }
+    return rings;
+}
+
+
+//
+// Record queue
+//
+// An intrusive multi-producer, single-consumer queue (Vyukov's): producers
+// exchange the tail for their record and then link the previous one to it,
+// and the writer follows the links from a stub, the last record it wrote. 
+// Records go back to the thread that formatted them once they are no longer
+// the stub, through a list of its own; a thread holds up to a number of 
+// them, waiting for one to come back or dropping the record past that.
+//
+
+// the writer's buffer when writing to a stream
+size_t const QUEUE_STREAM_BUFFER_SIZE = 1 << 16;
+
+// initial room of a record
+size_t const QUEUE_RECORD_SIZE = 256;
+
+// times the writer yields, looking for records, before it sleeps
+size_t const QUEUE_WRITER_SPINS = 64;
+
+
+struct RecordPool;
+
+
+struct QueuedRecord
+{
+    std::atomic<QueuedRecord*> next;
+    // the formatted record, its length first characters being written
+    std::vector<char> text;
+    size_t length;
+    // NULL for the first stub
+    RecordPool* pool;
+
+    QueuedRecord() : next(NULL), length(0), pool(NULL)
+    {
+    }
+};
+
+
+// The records of a thread: free ones, and those the writer gave back
+struct RecordPool
+{
+    QueuedRecord* free;
+    std::atomic<QueuedRecord*> returned;
+    std::vector<std::unique_ptr<QueuedRecord> > records;
+    std::atomic<unsigned long long> dropped;
+    // pools are listed from the last one registered
+    RecordPool* next;
+
+    RecordPool() : free(NULL), returned(NULL), dropped(0), next(NULL)
+    {
+    }
+};
+
+
+struct RecordQueueState
+{
+    FormatSink* sink;
+    // stream output
+    std::vector<char> buffer;
+    std::unique_ptr<FormatSink> stream_sink;
+
+    unsigned long long id;
+    std::atomic<QueuedRecord*> tail;
+    QueuedRecord* head;
+    QueuedRecord stub;
+    // records of a thread, at most
+    size_t records;
+    LogOverflow overflow;
+
+    // registration of pools, and waiting
+    std::mutex mutex;
+    std::vector<std::unique_ptr<RecordPool> > pools;
+    std::condition_variable work;
+    std::condition_variable flushed;
+    std::condition_variable room;
+    // producers waiting for a record (LOG_BLOCK)
+    std::atomic<unsigned int> blocked;
+    std::atomic<bool> sleeping;
+    std::atomic<unsigned long long> flush_requested;
+    unsigned long long flush_done;
+    std::atomic<bool> stopping;
+    std::thread writer;
+};
+
+
+// The calling thread's pool of the queue, registered on first use
+RecordPool* thread_pool(RecordQueueState* const state)
+{
+    RecordPool* pool = static_cast<RecordPool*>(find_thread_object(state->id));
+    if (pool != NULL)
+    {
+        return pool;
+    }
+
+    pool = new RecordPool;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->pools.push_back(std::unique_ptr<RecordPool>(pool));
+    }
+    add_thread_object(state->id, pool);
+    return pool;
+}
+
+
+// A free record of the pool, or NULL when the record is dropped
+QueuedRecord* take_record(RecordQueueState* const state, 
+    RecordPool* const pool)
+{
+    if (NULL == pool->free)
+    {
+        pool->free = pool->returned.exchange(NULL, std::memory_order_acquire);
+    }
+    if (NULL == pool->free && pool->records.size() >= state->records)
+    {
+        if (LOG_DROP == state->overflow)
+        {
+            increment(pool->dropped);
+            return NULL;
+        }
+        // the writer has the others, and wakes producers up once it's 
+        // given some back
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->blocked.fetch_add(1);
+        state->room.wait(lock, [pool]() {
+            return pool->returned.load() != NULL;
+        });
+        state->blocked.fetch_sub(1);
+        pool->free = pool->returned.exchange(NULL, std::memory_order_acquire);
+    }
+    QueuedRecord* record = pool->free;
+    if (record != NULL)
+    {
+        pool->free = record->next.load(std::memory_order_relaxed);
     }
     else
     {
-        // calculate the fractional part and the exponent
-        double finalnumber;
-        int const exponent = base10_exponent(value);
-        // print exponent, since the number starts with 0.
-        int const expfort = exponent + 1;
-        // power of 10 to extract the values to print in the space given the precision
-        double power;
-        if (exponent >= 0)
+        record = new QueuedRecord;
+        record->text.resize(QUEUE_RECORD_SIZE);
+        record->pool = pool;
+        pool->records.push_back(std::unique_ptr<QueuedRecord>(record));
+    }
+    record->next.store(NULL, std::memory_order_relaxed);
+    return record;
+}
+
+
+// gives a record back to its thread, by the writer
+void return_record(QueuedRecord* const record)
+{
+    RecordPool* const pool = record->pool;
+    if (NULL == pool)
+    {
+        return;
+    }
+    QueuedRecord* returned = pool->returned.load(std::memory_order_relaxed);
+    do
+    {
+        record->next.store(returned, std::memory_order_relaxed);
+    } while (!pool->returned.compare_exchange_weak(returned, record, 
+        std::memory_order_release, std::memory_order_relaxed));
+}
+
+
+void queue_writer(RecordQueueState* const state)
+{
+    bool written = false;
+    for (;;)
+    {
+        unsigned long long const request = state->flush_requested.load();
+        bool const stopping = state->stopping.load();
+
+        // every record pushed so far
+        QueuedRecord* const last = state->tail.load();
+        bool const pushed = state->head != last;
+        while (state->head != last)
         {
-            if (expfort >= static_cast<int>(precision))
+            QueuedRecord* const next = 
+                state->head->next.load(std::memory_order_acquire);
+            if (NULL == next)
             {
-                power = 1.0 / static_cast<double>(fast_10pow(expfort - precision));
-            }
-            else
-            {
-                power = static_cast<double>(fast_10pow(precision - expfort));
+                // pushed, but not linked yet
+                std::this_thread::yield();
+                continue;
             }
+            state->sink->write(next->text.data(), next->length);
+            return_record(state->head);
+            state->head = next;
+            written = true;
         }
-        else
+
+        // blocked producers check their pools after saying so
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (pushed && state->blocked.load() > 0)
         {
-            // -exponent + 1 = numbers of zeroes in the fractional part
-            int const zeroes = -(exponent + 1);
-            power = static_cast<double>(fast_10pow(zeroes + precision));
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->room.notify_all();
         }
-        // final number after the decimal separator
-
-        finalnumber = absvalue * power;
-        unsigned int intval = static_cast<unsigned int>(round(finalnumber));
 
-        // right-alignment whitespace
-        if (width > LEN)
+        if (request != state->flush_done)
         {
-            for (;pos < width - LEN; ++pos)
-            {
-                put[pos] = ' ';
-            } 
+            state->sink->flush();
+            written = false;
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->flush_done = request;
+            state->flushed.notify_all();
         }
-
-        // minus sign
-        if (require_sign)
+        if (stopping)
         {
-            if (is_negative(value))
-            {
-                put[pos] = '-'; 
-            }
-            else
-            {
-                put[pos] = '+';
-            }
-            
-            pos = pos + 1;
+            break;
         }
 
-        // leading zero
-        if (include_leading_zero)
+        // records coming in quick succession don't put the writer to sleep
+        size_t spins = 0;
+        while (spins < QUEUE_WRITER_SPINS && state->tail.load() == last)
         {
-            put[pos] = '0';
-            pos = pos + 1;
+            std::this_thread::yield();
+            spins = spins + 1;
         }
-        put[pos] = '.';
-        pos = pos + 1;
-
-        // number value
-        format_i(put + pos, intval, precision, 0, false);
-        pos = pos + precision;
-
-        // exponent sign
-        put[pos] = expchar;
-        pos = pos + 1;
-        if (expfort >= 0)
+        if (spins < QUEUE_WRITER_SPINS)
         {
-            put[pos] = '+';
+            continue;
         }
-        else
+        if (written)
         {
-            put[pos] = '-';
+            state->sink->flush();
+            written = false;
         }
-        pos = pos + 1;
 
-        // exponent value
-        format_i(put + pos, abs(expfort), exponent_width, exponent_width, false);
-        pos = pos + exponent_width;
+        // producers only wake the writer up when it says it's sleeping
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->sleeping.store(true);
+        state->work.wait(lock, [state, last, request]() {
+            return state->tail.load() != last || state->stopping.load() || 
+                state->flush_requested.load() != request;
+        });
+        state->sleeping.store(false);
     }
-    put[pos] = '\0';
+    state->sink->flush();
 }
 
 
-void format_g(char* put, double const value, size_t const width, 
-    size_t const precision, size_t const exponent, bool const plus_sign)
+void start_queue(RecordQueueState* const state, size_t const records, 
+    LogOverflow const overflow)
+{
+    // the writer keeps the last record it wrote
+    state->records = std::max(records, size_t(2));
+    state->overflow = overflow;
+    state->id = next_owner_id.fetch_add(1);
+    state->tail = &state->stub;
+    state->head = &state->stub;
+    state->blocked = 0;
+    state->sleeping = false;
+    state->flush_requested = 0;
+    state->flush_done = 0;
+    state->stopping = false;
+    state->writer = std::thread(queue_writer, state);
+}
+
+
+RecordQueue::RecordQueue(FormatSink& sink, size_t const records, 
+    LogOverflow const overflow)
+    : state_(new RecordQueueState)
+{
+    this->state_->sink = &sink;
+    start_queue(this->state_, records, overflow);
+}
+
+
+RecordQueue::RecordQueue(ostream& stream, size_t const records, 
+    LogOverflow const overflow)
+    : state_(new RecordQueueState)
 {
-    assert(exponent > 0);
+    RecordQueueState* const state = this->state_;
+    state->buffer.resize(QUEUE_STREAM_BUFFER_SIZE);
+    state->stream_sink.reset(new StreamSink(stream, state->buffer.data(), 
+        state->buffer.size()));
+    state->sink = state->stream_sink.get();
+    start_queue(state, records, overflow);
+}
 
-    double const MIN = 0.1;
-    double const MAX = fast_10pow(precision);
-    double absvalue = fabs(value);
 
-    if (MIN > absvalue || absvalue >= MAX)
+RecordQueue::~RecordQueue()
+{
+    RecordQueueState* const state = this->state_;
     {
-        // format as Ew.dEe
-        format_e(put, value, width, precision, EXPONENTIAL_E, 
-            exponent, plus_sign);
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->stopping = true;
+        state->work.notify_one();
     }
-    else
+    state->writer.join();
+    delete state;
+}
+
+
+bool RecordQueue::write_args(FortranFormat const& format, 
+    FormatArg const* args, size_t const count)
+{
+    RecordQueueState* const state = this->state_;
+    QueuedRecord* const record = take_record(state, thread_pool(state));
+    if (NULL == record)
+    {
+        return false;
+    }
+
+    // the record and its new line, in the room it's kept from before
+    std::vector<char>& text = record->text;
+    size_t length = format_to_buffer(text.data(), text.size(), format, args, 
+        count);
+    if (length + 1 >= text.size())
+    {
+        text.resize(length + 2);
+        length = format_to_buffer(text.data(), text.size(), format, args, 
+            count);
+    }
+    text[length] = '\n';
+    record->length = length + 1;
+
+    QueuedRecord* const previous = state->tail.exchange(record);
+    previous->next.store(record, std::memory_order_release);
+    // the first record pushed while the writer sleeps wakes it up
+    if (state->sleeping.exchange(false))
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->work.notify_one();
+    }
+    return true;
+}
+
+
+void RecordQueue::flush()
+{
+    RecordQueueState* const state = this->state_;
+    std::unique_lock<std::mutex> lock(state->mutex);
+    unsigned long long const request = state->flush_requested.load() + 1;
+    state->flush_requested.store(request);
+    state->work.notify_one();
+    state->flushed.wait(lock, [state, request]() {
+        return state->flush_done >= request;
+    });
+}
+
+
+unsigned long long RecordQueue::dropped() const
+{
+    std::lock_guard<std::mutex> lock(this->state_->mutex);
+    std::vector<std::unique_ptr<RecordPool> > const& pools = 
+        this->state_->pools;
+    unsigned long long dropped = 0;
+    for (size_t n = 0; n < pools.size(); ++n)
+    {
+        dropped = dropped + pools[n]->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+
+//
+// Ordered pipeline
+//
+// Records are numbered as they're submitted, and record n takes slot n 
+// modulo the window, which keeps the room for its captured arguments and
+// its text from one use to the next. Workers have a queue of record numbers
+// each, and take the first one of their own queue or, when it's empty, of
+// another's. Whichever worker completes the next record to write writes it
+// out, with the completed ones following it.
+//
+
+// initial room for the text of a record
+size_t const PIPELINE_RECORD_SIZE = 256;
+
+
+struct PipelineSlot
+{
+    // LogRecord, arguments and strings
+    std::vector<char> record;
+    std::vector<char> text;
+    size_t length;
+    std::atomic<bool> done;
+
+    PipelineSlot() : length(0), done(false)
+    {
+    }
+};
+
+
+struct PipelineQueue
+{
+    std::mutex mutex;
+    std::deque<unsigned long long> records;
+};
+
+
+struct PipelineState
+{
+    FormatSink* sink;
+    size_t window;
+    std::unique_ptr<PipelineSlot[]> slots;
+    std::vector<std::unique_ptr<PipelineQueue> > queues;
+    std::vector<std::thread> workers;
+
+    // records submitted, and written out by the worker that says it's 
+    // writing
+    unsigned long long submitted;
+    std::atomic<unsigned long long> written;
+    std::atomic<bool> writing;
+
+    // records in the queues, workers waiting for them and woken up (under
+    // the mutex), and the records written the submitter waits for, if any
+    std::atomic<unsigned long long> queued;
+    std::atomic<unsigned int> idle;
+    unsigned int wakeups;
+    std::atomic<unsigned long long> awaited;
+    std::mutex mutex;
+    std::condition_variable work;
+    std::condition_variable room;
+    bool stopping;
+};
+
+
+// the first record of the worker's queue, or of another one
+bool take_pipeline_record(PipelineState* const state, size_t const worker, 
+    unsigned long long* record)
+{
+    size_t const count = state->queues.size();
+    for (size_t n = 0; n < count; ++n)
     {
-        if (width > 2 + exponent)
+        PipelineQueue* const queue = state->queues[(worker + n) % count].get();
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (!queue->records.empty())
         {
-            // first, check range
-            size_t d;
-            for (d = 0; d <= precision; ++d)
-            {
-                double min;
-                if (d == 0) min = 0.1;
-                else        min = fast_10pow(d-1);
-                double max = fast_10pow(d);
+            *record = queue->records.front();
+            queue->records.pop_front();
+            state->queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
 
-                if (min <= absvalue && absvalue < max)
-                {
-                    break;
-                }
-            }
 
-            // format as Fw.d (no exponential part)
-            size_t w = width - (2 + exponent);
-            format_f(put, value, w, precision - d, plus_sign);  
+void format_pipeline_record(PipelineState* const state, 
+    unsigned long long const number)
+{
+    PipelineSlot& slot = state->slots[number % state->window];
+    LogRecord const* const record = 
+        reinterpret_cast<LogRecord const*>(slot.record.data());
+    FormatArg const* const args = reinterpret_cast<FormatArg const*>(
+        slot.record.data() + align_record(sizeof(LogRecord)));
+
+    // the record and its new line, in the room kept from before
+    std::vector<char>& text = slot.text;
+    if (text.empty())
+    {
+        text.resize(PIPELINE_RECORD_SIZE);
+    }
+    size_t length = format_to_buffer(text.data(), text.size(), 
+        *record->format, args, record->count);
+    if (length + 1 >= text.size())
+    {
+        text.resize(length + 2);
+        length = format_to_buffer(text.data(), text.size(), 
+            *record->format, args, record->count);
+    }
+    text[length] = '\n';
+    slot.length = length + 1;
+    slot.done.store(true);
+}
 
-            // complete remaining blank spaces
-            for (size_t white = w; white < width; ++white)
-            {
-                put[white] = ' ';
-            }
-            put[width] = '\0';
+
+// Writes out the completed records that follow those written, unless 
+// another worker is doing it
+void write_pipeline_records(PipelineState* const state)
+{
+    while (!state->writing.exchange(true))
+    {
+        unsigned long long next = state->written.load();
+        PipelineSlot* slot = &state->slots[next % state->window];
+        while (slot->done.load())
+        {
+            state->sink->write(slot->text.data(), slot->length);
+            slot->done.store(false, std::memory_order_relaxed);
+            next = next + 1;
+            state->written.store(next);
+            slot = &state->slots[next % state->window];
+        }
+        state->writing.store(false);
+
+        unsigned long long const awaited = state->awaited.load();
+        if (awaited != 0 && next >= awaited)
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->room.notify_all();
+        }
+        // a record completed meanwhile would be left to no one
+        if (!slot->done.load())
+        {
+            break;
+        }
+    }
+}
+
+
+void pipeline_worker(PipelineState* const state, size_t const worker)
+{
+    for (;;)
+    {
+        unsigned long long record;
+        if (take_pipeline_record(state, worker, &record))
+        {
+            format_pipeline_record(state, record);
+            write_pipeline_records(state);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        if (state->stopping)
+        {
+            break;
+        }
+        state->idle.fetch_add(1);
+        state->work.wait(lock, [state]() {
+            return state->queued.load() > 0 || state->stopping;
+        });
+        // not woken up, but finding records
+        if (state->wakeups > 0)
+        {
+            state->wakeups = state->wakeups - 1;
         }
         else
         {
-            fill_with_char(put, OVERFLOW_FILL_CHAR, width);
-            put[width] = '\0';
+            state->idle.fetch_sub(1);
         }
     }
 }
 
 
-//
-// Format write edit descriptors
-//
-
-void write_i(ostream& stream, Scanner* scanner, va_list* ap, 
-    size_t const repeat, bool const plus_sign)
+// waits until the given number of records are written out
+void wait_pipeline(PipelineState* const state, 
+    unsigned long long const records)
+{
+    if (state->written.load() >= records)
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->awaited.store(records);
+    state->room.wait(lock, [state, records]() {
+        return state->written.load() >= records;
+    });
+    state->awaited.store(0);
+}
+
+
+FormatPipeline::FormatPipeline(FormatSink& sink, unsigned int threads, 
+    size_t const window)
+    : state_(new PipelineState)
 {
-    consume(scanner);
-
-    int width = integer(scanner);
-    assert(width > 0);
-    int fill = 0;
-    
-    if (peek(scanner) == '.')
+    assert(window > 0);
+    if (0 == threads)
     {
-        advance(scanner);
-        consume(scanner);
-        fill = integer(scanner);
+        threads = std::max(1u, std::thread::hardware_concurrency());
     }
 
-    // pop arg value(s)
-    for (size_t repcount = 0; repcount < repeat; ++repcount)
+    PipelineState* const state = this->state_;
+    state->sink = &sink;
+    state->window = window;
+    state->slots.reset(new PipelineSlot[window]);
+    state->submitted = 0;
+    state->written = 0;
+    state->writing = false;
+    state->queued = 0;
+    state->idle = 0;
+    state->wakeups = 0;
+    state->awaited = 0;
+    state->stopping = false;
+    for (unsigned int n = 0; n < threads; ++n)
     {
-        int value = va_arg(*ap, int); 
-        char put[MAX_STR_LEN];
-
-        format_i(put, value, width, fill, plus_sign);
-        stream << put;
+        state->queues.push_back(
+            std::unique_ptr<PipelineQueue>(new PipelineQueue));
+    }
+    for (unsigned int n = 0; n < threads; ++n)
+    {
+        state->workers.push_back(std::thread(pipeline_worker, state, n));
     }
 }
 
 
-void write_f(ostream& stream, Scanner* scanner, va_list* ap, 
-    size_t const repeat, bool const plus_sign)
+FormatPipeline::~FormatPipeline()
 {
-    consume(scanner);
+    this->flush();
 
-    int width = integer(scanner);
-    assert(width > 0);
-    int fractional = 0;
-
-    // dot character
-    advance(scanner); 
-    consume(scanner);
-    fractional = integer(scanner);
-    
-    // pop arg value(s)
-    for (size_t repcount = 0; repcount < repeat; ++repcount)
+    PipelineState* const state = this->state_;
     {
-        double value = va_arg(*ap, double); 
-        char put[MAX_STR_LEN];
-
-        format_f(put, value, width, fractional, plus_sign);
-        stream << put;
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->stopping = true;
+        state->work.notify_all();
+    }
+    for (size_t n = 0; n < state->workers.size(); ++n)
+    {
+        state->workers[n].join();
     }
+    delete state;
 }
 
 
-void write_d(ostream& stream, Scanner* scanner, va_list* ap, 
-    size_t const repeat, bool const plus_sign)
+void FormatPipeline::submit_args(FortranFormat const& format, 
+    FormatArg const* args, size_t const count)
 {
-    // TODO: similar to write_e
-    consume(scanner);
-
-    int width = integer(scanner);
-    assert(width > 0);
-    int fractional = 0;
+    PipelineState* const state = this->state_;
+    // with the window full, until half of it is free
+    unsigned long long const number = state->submitted;
+    size_t const window = state->window;
+    if (number >= window && state->written.load() <= number - window)
+    {
+        wait_pipeline(state, number - window + 1 + window / 2);
+    }
 
-    // dot character
-    advance(scanner); 
-    consume(scanner);
-    fractional = integer(scanner);
-    
-    // pop arg value(s)
-    for (size_t repcount = 0; repcount < repeat; ++repcount)
+    // captured like a logged record
+    PipelineSlot& slot = state->slots[number % state->window];
+    size_t values;
+    size_t const strings = string_bytes(args, count, &values);
+    size_t const size = align_record(sizeof(LogRecord)) + 
+        values * sizeof(FormatArg) + strings;
+    if (slot.record.size() < size)
+    {
+        slot.record.resize(size);
+    }
+    LogRecord* const record = reinterpret_cast<LogRecord*>(slot.record.data());
+    record->format = &format;
+    record->count = values;
+    record->size = size;
+    copy_record(slot.record.data(), args, count);
+
+    PipelineQueue* const queue = 
+        state->queues[number % state->queues.size()].get();
     {
-        double value = va_arg(*ap, double); 
-        char put[MAX_STR_LEN];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->records.push_back(number);
+    }
+    state->submitted = number + 1;
 
-        format_e(put, value, width, fractional, EXPONENTIAL_D, DEFAULT_EXPONENT, 
-            plus_sign);  
-        stream << put;
+    // idle workers check the count after saying they're idle
+    // and are woken up once
+    state->queued.fetch_add(1);
+    if (state->idle.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->idle.load() > 0)
+        {
+            state->idle.fetch_sub(1);
+            state->wakeups = state->wakeups + 1;
+            state->work.notify_one();
+        }
     }
 }
 
 
-void write_e(ostream& stream, Scanner* scanner, va_list* ap, 
-    size_t const repeat, bool const plus_sign)
+void FormatPipeline::flush()
 {
-    // TODO: similar to write_d
-    consume(scanner);
+    PipelineState* const state = this->state_;
+    wait_pipeline(state, state->submitted);
+    state->sink->flush();
+}
 
-    int width = integer(scanner);
-    assert(width > 0);
-    int fractional = 0;
 
-    // dot character
-    advance(scanner); 
-    consume(scanner);
-    fractional = integer(scanner);
+//
+// Arena
+//
+// Blocks are kept in a list, in the order they're used, and the arena 
+// carves allocations out of the current one, moving on to the next block 
+// that has room (taking a new one when none has) once it's full. reset 
+// goes back to the first block.
+//
 
-    size_t exponent = DEFAULT_EXPONENT;
-    if (peek(scanner) == 'E')
-    {
-        advance(scanner); 
-        consume(scanner);
-        exponent = integer(scanner);
-    }
-    
-    // pop arg value(s)
-    for (size_t repcount = 0; repcount < repeat; ++repcount)
-    {
-        double value = va_arg(*ap, double); 
-        char put[MAX_STR_LEN];
+struct FormatArena::Block
+{
+    Block* next;
+    size_t size;
+    // followed by size bytes, aligned like a header
+    std::max_align_t data[1];
+};
 
-        format_e(put, value, width, fractional, EXPONENTIAL_E, exponent, 
-            plus_sign);  
-        stream << put;
-    }
+
+FormatArena::FormatArena(size_t const block_size)
+    : first_(NULL), current_(NULL), pos_(NULL), end_(NULL), 
+      block_size_(block_size), used_(0), reserved_(0)
+#if __cplusplus >= 201703L
+    , upstream_(std::pmr::new_delete_resource())
+#endif
+{
+    assert(block_size > 0);
 }
 
 
-void write_g(ostream& stream, Scanner* scanner, va_list* ap, 
-    size_t const repeat, bool const plus_sign)
+#if __cplusplus >= 201703L
+FormatArena::FormatArena(size_t const block_size, 
+    std::pmr::memory_resource* const upstream)
+    : first_(NULL), current_(NULL), pos_(NULL), end_(NULL), 
+      block_size_(block_size), used_(0), reserved_(0), upstream_(upstream)
 {
-    // TODO: similar to write_d and write_e
-    consume(scanner);
-
-    int width = integer(scanner);
-    assert(width > 0);
-    int fractional = 0;
+    assert(block_size > 0 && upstream != NULL);
+}
+#endif
 
-    // dot character
-    advance(scanner); 
-    consume(scanner);
-    fractional = integer(scanner);
 
-    size_t exponent = DEFAULT_EXPONENT;
-    if (peek(scanner) == EXPONENTIAL_E)
+FormatArena::~FormatArena()
+{
+    Block* block = this->first_;
+    while (block != NULL)
     {
-        advance(scanner); 
-        consume(scanner);
-        exponent = integer(scanner);
+        Block* const next = block->next;
+        size_t const bytes = offsetof(Block, data) + block->size;
+#if __cplusplus >= 201703L
+        this->upstream_->deallocate(block, bytes, alignof(Block));
+#else
+        (void)bytes;
+        ::operator delete(block);
+#endif
+        block = next;
     }
-    
-    // pop arg value(s)
-    for (size_t repcount = 0; repcount < repeat; ++repcount)
-    {
-        double value = va_arg(*ap, double); 
-        char put[MAX_STR_LEN];
+}
+
 
-        format_g(put, value, width, fractional, exponent, plus_sign);  
-        stream << put;
+void FormatArena::reset()
+{
+    this->current_ = this->first_;
+    this->pos_ = NULL;
+    this->end_ = NULL;
+    if (this->current_ != NULL)
+    {
+        this->pos_ = reinterpret_cast<char*>(this->current_->data);
+        this->end_ = this->pos_ + this->current_->size;
     }
+    this->used_ = 0;
 }
 
 
-void write_l(ostream& stream, Scanner* scanner, va_list* ap, 
-    size_t const repeat)
+void* FormatArena::carve(size_t const size, size_t const alignment)
 {
-    consume(scanner);
-    size_t width = integer(scanner);
-    assert(width > 0);
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
 
-    // pop arg value(s)
-    for (size_t repcount = 0; repcount < repeat; ++repcount)
+    for (;;)
     {
-        int value = va_arg(*ap, int);
-
-        size_t pos = 0;
-        char valstr[MAX_STR_LEN];
-        for (;pos < width - 1; ++pos)
+        // aligned in the current block
+        if (this->pos_ != NULL)
         {
-            valstr[pos] = ' ';
+            uintptr_t const pos = reinterpret_cast<uintptr_t>(this->pos_);
+            size_t const padding = (alignment - pos % alignment) % alignment;
+            if (static_cast<size_t>(this->end_ - this->pos_) >= padding && 
+                static_cast<size_t>(this->end_ - this->pos_) - padding >= size)
+            {
+                char* const memory = this->pos_ + padding;
+                this->pos_ = memory + size;
+                this->used_ = this->used_ + padding + size;
+                return memory;
+            }
         }
-        if (value)
+
+        // the next block with room, or a new one after the current block
+        Block* next = this->current_ != NULL ? 
+            this->current_->next : this->first_;
+        while (next != NULL && next->size < size + alignment)
         {
-            valstr[pos] = FORTRAN_TRUE;
+            next = next->next;
         }
-        else
+        if (NULL == next)
         {
-            valstr[pos] = FORTRAN_FALSE;   
+            size_t const room = std::max(this->block_size_, size + alignment);
+            size_t const bytes = offsetof(Block, data) + room;
+#if __cplusplus >= 201703L
+            void* const memory = this->upstream_->allocate(bytes, 
+                alignof(Block));
+#else
+            void* const memory = ::operator new(bytes);
+#endif
+            next = static_cast<Block*>(memory);
+            next->size = room;
+            if (NULL == this->current_)
+            {
+                next->next = this->first_;
+                this->first_ = next;
+            }
+            else
+            {
+                next->next = this->current_->next;
+                this->current_->next = next;
+            }
+            this->reserved_ = this->reserved_ + bytes;
         }
-        valstr[width] = '\0';
-        stream << valstr;
+        this->current_ = next;
+        this->pos_ = reinterpret_cast<char*>(next->data);
+        this->end_ = this->pos_ + next->size;
     }
 }
 
 
-void write_a(ostream& stream, Scanner* scanner, va_list* ap, 
-    size_t const repeat)
+FormatRecord capture_record_args(FormatArena& arena, 
+    FortranFormat const& format, FormatArg const* args, size_t const count)
 {
-    consume(scanner);
-    size_t width = 0;
-    if (is_digit(peek(scanner)))
-    {
-        // if the user specify a width, it must be nonzero
-        width = integer(scanner);
-        assert(width > 0);
-    }
+    size_t values;
+    size_t const strings = string_bytes(args, count, &values);
+    FormatArg* const copies = static_cast<FormatArg*>(arena.allocate(
+        values * sizeof(FormatArg), alignof(FormatArg)));
+    char* const chars = static_cast<char*>(arena.allocate(strings, 1));
+    copy_args(copies, chars, args, count);
+
+    FormatRecord record;
+    record.format = &format;
+    record.args = copies;
+    record.count = values;
+    return record;
+}
 
-    // pop arg value(s)
-    for (size_t repcount = 0; repcount < repeat; ++repcount)
-    {
-        char const* value = va_arg(*ap, char const*); 
-        size_t value_width = strlen(value);
 
-        if (width > 0)
-        {
-            char valsub[MAX_STR_LEN];
+//
+// Public Interface
+//
 
-            size_t pos = 0;
-            size_t whats_left = width;
-            if (width > value_width)
-            {
-                // pad with whitespace
-                for (; pos < width - value_width; ++pos)
-                {
-                    valsub[pos] = ' ';
-                }
-                whats_left = value_width;
-            }
-            
-            strncpy(valsub + pos, value, whats_left);
-            valsub[width] = '\0';
+void FortranFormat::write_args(ostream& stream, FormatArg const* args, 
+    size_t const count) const
+{
+    format_printfor(stream, *this, args, count);
+}
 
-            stream << valsub; 
-        }
-        else
-        {
-            stream << value;  
-        }
-    }
+
+void vprintfor(ostream& stream, char const* formatstr, FormatArg const* args, 
+    size_t const count)
+{
+    format_printfor(stream, cached_format(formatstr), args, count);
 }
 
 
-void write_x(ostream& stream, Scanner* scanner, 
-    size_t const repeat)
+void vprintfor(char const* formatstr, FormatArg const* args, 
+    size_t const count)
 {
-    consume(scanner); // consume X
+    vprintfor(std::cout, formatstr, args, count);
+}
 
-    // print whitespace
-    for (size_t repcount = 0; repcount < repeat; ++repcount)
-    {
-        stream << " ";
-    }
+
+void FortranFormat::write_args(FormatSink& sink, FormatArg const* args, 
+    size_t const count) const
+{
+    format_printfor(sink, *this, args, count);
 }
 
 
-void write_str(ostream& stream, Scanner* scanner, char const opening)
+void FortranFormat::write_arg_parallel(FormatSink& sink, 
+    FormatArg const& values, unsigned int const threads) const
 {
-    // extracted string
-    char valstr[MAX_STR_LEN];
-    // pointer to current character being written
-    char* strinit = valstr;
+    format_parallel(sink, *this, values, threads);
+}
 
-    size_t length_left = MAX_STR_LEN;
 
-    consume(scanner); // consume opening ' or "
-    for (;;)
-    {
-        // TODO: test length_left for 0 value or underflow
-        char c = peek(scanner);
-        if (opening == c)
-        {
-            if (peek_next(scanner) != opening)
-            {
-                break;
-            }
-            else
-            {
-                // consume one of the quotation marks
-                advance(scanner);
-                // copy characters until the first quotation mark
-                extract(scanner, strinit, length_left);
-                // move pointer
-                strinit = strinit + strlen(strinit);
-                length_left = MAX_STR_LEN - (strinit - valstr);
-                // jump escape character
-                advance(scanner);
-                consume(scanner);
-            }
-        }
-        else
-        {
-            advance(scanner);
-        }
-    }
-    // extract string before last '
-    
-    extract(scanner, strinit, length_left);
+void FortranFormat::write_arg_parallel(ostream& stream, 
+    FormatArg const& values, unsigned int const threads) const
+{
+    char buffer[STREAM_BUFFER_SIZE];
+    StreamSink sink(stream, buffer, STREAM_BUFFER_SIZE);
 
-    advance(scanner);
-    consume(scanner); // consume last '
+    format_parallel(sink, *this, values, threads);
+    sink.flush();
+}
 
-    // print user string
-    stream << valstr;
+
+void vprintfor(FormatSink& sink, char const* formatstr, FormatArg const* args, 
+    size_t const count)
+{
+    format_printfor(sink, cached_format(formatstr), args, count);
 }
 
 
-void write_nl(ostream& stream, Scanner* scanner)
+size_t FortranFormat::write_args_to_buffer(char* dst, size_t const size, 
+    FormatArg const* args, size_t const count) const
 {
-    consume(scanner); // consume the slash
-    stream << '\n';
+    return format_to_buffer(dst, size, *this, args, count);
 }
 
 
-void write_h(ostream& stream, Scanner* scanner, 
-    size_t const length)
+size_t vprintfor_to_buffer(char* dst, size_t const size, 
+    char const* formatstr, FormatArg const* args, size_t const count)
 {
-    consume(scanner); // consume opening '
-    for (size_t count = 0; count < length; ++count)
-    {
-        // TODO: deal with '' escape. count it as 1 char.
-        advance(scanner);
-    }
-    // extract string before last '
-    char valstr[MAX_STR_LEN];
-    extract(scanner, valstr, MAX_STR_LEN);
+    return format_to_buffer(dst, size, cached_format(formatstr), args, count);
+}
 
-    // consume last '
-    advance(scanner);
-    consume(scanner); 
 
-    // print user string
-    stream << valstr;
+size_t FortranFormat::read_args(std::istream& stream, 
+    FormatTarget const* targets, size_t const count) const
+{
+    return format_scanfor(stream, *this, targets, count);
 }
 
 
-bool write_group(ostream& stream, Scanner* scanner, va_list* ap, 
-    bool const plus_sign)
+size_t vscanfor(std::istream& stream, char const* formatstr, 
+    FormatTarget const* targets, size_t const count)
 {
-    // consume open paren and following whitespace
-    skip_whitespace(scanner);
-    consume(scanner);
+    return format_scanfor(stream, cached_format(formatstr), targets, count);
+}
 
-    // force optional plus sign for I, F, D, E, G descriptors
-    bool opt_plus_sign = plus_sign;
 
-    for (;;)
-    {
-        char c = advance(scanner);
+size_t vscanfor(char const* formatstr, FormatTarget const* targets, 
+    size_t const count)
+{
+    return vscanfor(std::cin, formatstr, targets, count);
+}
 
-        // repeat count
-        unsigned int repeat = 1;
-        if (is_digit(c))
-        {
-            repeat = integer(scanner);
-            assert(repeat > 0);
-            c = advance(scanner);
-        }
 
-        // nested group
-        if ('(' == c)
-        {
-            char const* previous = scanner->current;
-            for (size_t repcount = 0; repcount < repeat; ++repcount)
-            {
-                scanner->start = previous;
-                scanner->current = previous;
-                opt_plus_sign = write_group(stream, scanner, ap, opt_plus_sign);    
-            }
-        }
-        // edit descriptors
-        else if (is_alpha(c))
-        {
-            switch(c)
-            {
-                case 'A':
-                    write_a(stream, scanner, ap, repeat); 
-                break;
+size_t FortranFormat::read_args_from_buffer(char const* src, 
+    size_t const size, FormatTarget const* targets, size_t const count, 
+    size_t* consumed) const
+{
+    return format_from_buffer(src, size, *this, targets, count, consumed);
+}
 
-                case 'D':
-                    write_d(stream, scanner, ap, repeat, opt_plus_sign); 
-                break;
 
-                case 'E':
-                    write_e(stream, scanner, ap, repeat, opt_plus_sign); 
-                break;
+size_t vscanfor_from_buffer(char const* src, size_t const size, 
+    char const* formatstr, FormatTarget const* targets, size_t const count)
+{
+    return format_from_buffer(src, size, cached_format(formatstr), targets, 
+        count, NULL);
+}
 
-                case 'F':
-                    write_f(stream, scanner, ap, repeat, opt_plus_sign); 
-                break;
 
-                case 'G':
-                    write_g(stream, scanner, ap, repeat, opt_plus_sign); 
-                break;
+size_t FortranFormat::read_args_from_index(RecordIndex const& index, 
+    size_t const line, FormatTarget const* targets, size_t const count, 
+    size_t* next_line) const
+{
+    Input in(index, line);
+    size_t const read = read_records(&in, *this, targets, count);
+    if (next_line != NULL)
+    {
+        *next_line = in.index_line;
+    }
+    return read;
+}
 
-                case 'H':
-                    write_h(stream, scanner, repeat); 
-                break;
 
-                case 'I':
-                    write_i(stream, scanner, ap, repeat, opt_plus_sign); 
-                break;
+size_t FortranFormat::read_parallel(char const* src, size_t const size, 
+    FormatRecordCallback callback, void* context, 
+    unsigned int const threads) const
+{
+    // the values of a list-directed record aren't known without columns
+    assert(!this->list_directed_);
+    ParallelRead job;
+    job.callback = callback;
+    job.context = context;
+    job.columns = NULL;
+    job.rows = 0;
+    job.projection = NULL;
+    job.vectors = NULL;
+    job.index = NULL;
+    return format_read_parallel(&job, *this, src, size, threads);
+}
 
-                case 'L':
-                    write_l(stream, scanner, ap, repeat); 
-                break;
 
-                case 'S':
-                    opt_plus_sign = format_sign(scanner, opt_plus_sign); 
-                break;
+size_t FortranFormat::read_parallel(RecordIndex const& index, 
+    FormatRecordCallback callback, void* context, 
+    unsigned int const threads) const
+{
+    // the values of a list-directed record aren't known without columns
+    assert(!this->list_directed_);
+    ParallelRead job;
+    job.callback = callback;
+    job.context = context;
+    job.columns = NULL;
+    job.rows = 0;
+    job.projection = NULL;
+    job.vectors = NULL;
+    job.index = &index;
+    return format_read_parallel(&job, *this, index.data(), index.size(), 
+        threads);
+}
 
-                case 'X':
-                    write_x(stream, scanner, repeat); 
-                break;
-            }
-        }
-        else if ('/' == c)
-        {
-            write_nl(stream, scanner);
-        }
-        else if ('\'' == c)
-        {
-            write_str(stream, scanner, '\'');
-        }
-        else if ('"' == c)
-        {
-            write_str(stream, scanner, '"');
-        }
-        else if (')' == c)
-        {
-            consume(scanner);
-            break;
-        }
-        else if (',' == c)
-        {
-            consume(scanner);
-        }
 
-        if (is_at_end(scanner))
-        {
-            break;
-        }
+size_t FortranFormat::read_columns(RecordIndex const& index, 
+    FormatTarget const* columns, size_t const count, size_t const rows, 
+    unsigned int const threads) const
+{
+    ParallelRead job;
+    job.callback = NULL;
+    job.context = NULL;
+    job.columns = columns;
+    job.rows = rows;
+    job.projection = NULL;
+    job.vectors = NULL;
+    job.index = &index;
+    // a column per data edit descriptor, or per value of a list
+    assert(this->list_directed_ || 
+        count_items(this->items_, 0, this->items_.size()) == count);
+    if (this->list_directed_)
+    {
+        job.fields.assign(count, FOP_G);
+    }
+    return format_read_parallel(&job, *this, index.data(), index.size(), 
+        threads);
+}
 
-        skip_whitespace(scanner);
-        consume(scanner);
+
+size_t FortranFormat::read_columns(char const* src, size_t const size, 
+    FormatTarget const* columns, size_t const count, size_t const rows, 
+    unsigned int const threads) const
+{
+    ParallelRead job;
+    job.callback = NULL;
+    job.context = NULL;
+    job.columns = columns;
+    job.rows = rows;
+    job.projection = NULL;
+    job.vectors = NULL;
+    job.index = NULL;
+    // a column per data edit descriptor, or per value of a list
+    assert(this->list_directed_ || 
+        count_items(this->items_, 0, this->items_.size()) == count);
+    if (this->list_directed_)
+    {
+        job.fields.assign(count, FOP_G);
     }
+    return format_read_parallel(&job, *this, src, size, threads);
+}
+
 
-    // spill group options
-    return opt_plus_sign;
+size_t FortranFormat::read_vectors(char const* src, size_t const size, 
+    FormatColumn const* columns, size_t const count, 
+    unsigned int const threads) const
+{
+    ParallelRead job;
+    job.projection = NULL;
+    job.index = NULL;
+    // a column per data edit descriptor, or per value of a list
+    assert(this->list_directed_ || 
+        count_items(this->items_, 0, this->items_.size()) == count);
+    return format_read_vectors(&job, *this, src, size, columns, count, 
+        threads);
 }
 
 
-//
-// Public Interface
-//
+size_t FortranFormat::count_records(char const* src, size_t const size) const
+{
+    size_t const record_lines = 1 + count_lines(this->items_, 0, 
+        this->items_.size());
+    return (count_input_lines(src, size) + record_lines - 1) / record_lines;
+}
 
-void stream_printfor(ostream& stream, char const* const formatstr, va_list* ap)
+
+size_t FortranFormat::count_records(RecordIndex const& index) const
 {
-    bool const OPTIONAL_PLUS_SIGN = false;
+    size_t const record_lines = 1 + count_lines(this->items_, 0, 
+        this->items_.size());
+    return (index.lines() + record_lines - 1) / record_lines;
+}
 
-    Scanner scanner(formatstr);
-    skip_whitespace(&scanner);
-    char c = advance(&scanner);
-    if ('(' == c)
+
+size_t FormatProjection::read_args_from_buffer(char const* src, 
+    size_t const size, FormatTarget const* targets, size_t const count, 
+    size_t* consumed) const
+{
+    Input in(src, size);
+    size_t const read = read_projected(&in, *this, targets, count);
+    if (consumed != NULL && !this->valid_)
     {
-        write_group(stream, &scanner, ap, OPTIONAL_PLUS_SIGN);
+        *consumed = 0;
+    }
+    else if (consumed != NULL)
+    {
+        // the lines of the record left unread
+        while (in.records < this->record_lines_ && read_record(&in))
+        {
+        }
+        *consumed = in.next - src;
     }
-    stream << '\n';
+    return read;
 }
 
 
-void printfor(char const* formatstr, ...)
+size_t FormatProjection::read_args_from_index(RecordIndex const& index, 
+    size_t const line, FormatTarget const* targets, size_t const count) const
 {
-    va_list ap;
-    va_start(ap, formatstr);
-    stream_printfor(std::cout, formatstr, &ap);
-    va_end(ap);
+    Input in(index, line);
+    return read_projected(&in, *this, targets, count);
 }
 
 
-void printfor(ostream& stream, char const* formatstr, ...)
+size_t FormatProjection::read_columns(RecordIndex const& index, 
+    FormatTarget const* columns, size_t const count, size_t const rows, 
+    unsigned int const threads) const
 {
-    va_list ap;
-    va_start(ap, formatstr);
-    stream_printfor(stream, formatstr, &ap);
-    va_end(ap);
+    ParallelRead job;
+    job.callback = NULL;
+    job.context = NULL;
+    job.columns = columns;
+    job.rows = rows;
+    job.projection = this;
+    job.vectors = NULL;
+    job.index = &index;
+    if (!this->valid_)
+    {
+        return 0;
+    }
+    // a column per projected field
+    assert(this->fields_.size() == count);
+    (void)count;
+    return format_read_parallel(&job, *this->format_, index.data(), 
+        index.size(), threads);
+}
+
+
+size_t FormatProjection::read_columns(char const* src, size_t const size, 
+    FormatTarget const* columns, size_t const count, size_t const rows, 
+    unsigned int const threads) const
+{
+    ParallelRead job;
+    job.callback = NULL;
+    job.context = NULL;
+    job.columns = columns;
+    job.rows = rows;
+    job.projection = this;
+    job.vectors = NULL;
+    job.index = NULL;
+    if (!this->valid_)
+    {
+        return 0;
+    }
+    // a column per projected field
+    assert(this->fields_.size() == count);
+    (void)count;
+    return format_read_parallel(&job, *this->format_, src, size, threads);
 }
 
+
+size_t FormatProjection::read_vectors(char const* src, size_t const size, 
+    FormatColumn const* columns, size_t const count, 
+    unsigned int const threads) const
+{
+    ParallelRead job;
+    job.projection = this;
+    job.index = NULL;
+    if (!this->valid_)
+    {
+        return 0;
+    }
+    // a column per projected field
+    assert(this->fields_.size() == count);
+    return format_read_vectors(&job, *this->format_, src, size, columns, 
+        count, threads);
+}
@@ -24,10 +24,1341 @@
 #ifndef H_FORTRANFORMAT__
 #define H_FORTRANFORMAT__
 
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <istream>
 #include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#if __cplusplus >= 201703L
+#include <memory_resource>
+#include <string_view>
+#endif
+#if __cplusplus >= 202002L
+#include <span>
+#endif
 
-void printfor(char const* formatstr, ...);
 
-void printfor(std::ostream& stream, char const* formatstr, ...);
+// Operations of a compiled format
+enum FormatOp
+{
+    // data edit descriptors (consume arguments)
+    FOP_I,
+    FOP_F,
+    FOP_D,
+    FOP_E,
+    FOP_G,
+    FOP_L,
+    FOP_A,
+    // control and character string edit descriptors
+    FOP_X,
+    FOP_STR,
+    FOP_NL,
+    FOP_SP,
+    FOP_SS,
+    // blank interpretation, on input
+    FOP_BN,
+    FOP_BZ,
+    // scale factor, on input and output
+    FOP_P,
+    // parenthesized group, followed by its length items
+    FOP_GROUP
+};
+
+
+// A single compiled edit descriptor
+struct FormatItem
+{
+    FormatOp     op;
+    unsigned int repeat;    // repeat count (also n for nX and n/)
+    unsigned int width;     // w
+    unsigned int digits;    // m for Iw.m, d for Fw.d, Dw.d, Ew.d and Gw.d
+    unsigned int exponent;  // e for Ew.dEe and Gw.dEe, 0 without it
+    int          scale;     // k for kP
+    size_t       offset;    // literal offset in the literal pool
+    size_t       length;    // literal length, or number of items in a group
+};
+
+
+// Largest magnitude of a scale factor, larger ones being clamped to it: 
+// any double times 10^k then overflows an F field or rounds to 0, and the 
+// shifts of the decimal point don't overflow an int
+int const FORMAT_MAX_SCALE = 1 << 16;
+
+
+// Type of a printfor argument
+enum FormatArgType
+{
+    FARG_INT,
+    FARG_UINT,
+    FARG_DOUBLE,
+    FARG_BOOL,
+    FARG_STRING,
+    FARG_ARRAY,
+    // a float, kept in real: only list-directed output tells it apart
+    FARG_FLOAT,
+    // 64-bit integers, kept in integer and unsigned_integer: likewise told
+    // apart from FARG_INT and FARG_UINT by list-directed output alone
+    FARG_INT64,
+    FARG_UINT64
+};
+
+
+// A printfor argument, captured with its type instead of going through C
+// variadic arguments and their default promotions
+struct FormatArg
+{
+    struct String
+    {
+        char const* data;
+        size_t length;
+    };
+
+    // contiguous elements, each one taken as an argument
+    struct Array
+    {
+        void const* data;
+        size_t length;
+        FormatArg (*element)(void const* data, size_t index);
+    };
+
+    FormatArgType type;
+    union
+    {
+        long long integer;
+        unsigned long long unsigned_integer;
+        double real;
+        bool logical;
+        String string;
+        Array array;
+    };
+};
+
+
+inline FormatArg make_format_arg(long long const value)
+{
+    FormatArg arg;
+    arg.type = FARG_INT64;
+    arg.integer = value;
+    return arg;
+}
+
+
+inline FormatArg make_format_arg(unsigned long long const value)
+{
+    FormatArg arg;
+    arg.type = FARG_UINT64;
+    arg.unsigned_integer = value;
+    return arg;
+}
+
+
+inline FormatArg make_format_arg(double const value)
+{
+    FormatArg arg;
+    arg.type = FARG_DOUBLE;
+    arg.real = value;
+    return arg;
+}
+
+
+inline FormatArg make_format_arg(bool const value)
+{
+    FormatArg arg;
+    arg.type = FARG_BOOL;
+    arg.logical = value;
+    return arg;
+}
+
+
+inline FormatArg make_format_arg(char const* value, size_t const length)
+{
+    FormatArg arg;
+    arg.type = FARG_STRING;
+    arg.string.data = value;
+    arg.string.length = length;
+    return arg;
+}
+
+
+inline FormatArg make_format_arg(char const* value)
+{
+    if (NULL == value)
+    {
+        return make_format_arg("", 0);
+    }
+    return make_format_arg(value, strlen(value));
+}
+
+
+inline FormatArg make_format_arg(std::string const& value)
+{
+    return make_format_arg(value.data(), value.size());
+}
+
+
+#if __cplusplus >= 201703L
+inline FormatArg make_format_arg(std::string_view const value)
+{
+    return make_format_arg(value.data(), value.size());
+}
+#endif
+
+
+inline FormatArg make_format_arg(int const value)
+{
+    FormatArg arg;
+    arg.type = FARG_INT;
+    arg.integer = value;
+    return arg;
+}
+
+
+inline FormatArg make_format_arg(short const value)
+{
+    return make_format_arg(static_cast<int>(value));
+}
+
+
+// 32 or 64 bits, depending on the platform
+inline FormatArg make_format_arg(long const value)
+{
+    return sizeof(long) > sizeof(int) ? 
+        make_format_arg(static_cast<long long>(value)) : 
+        make_format_arg(static_cast<int>(value));
+}
+
+
+inline FormatArg make_format_arg(unsigned int const value)
+{
+    FormatArg arg;
+    arg.type = FARG_UINT;
+    arg.unsigned_integer = value;
+    return arg;
+}
+
+
+inline FormatArg make_format_arg(unsigned short const value)
+{
+    return make_format_arg(static_cast<unsigned int>(value));
+}
+
+
+inline FormatArg make_format_arg(unsigned long const value)
+{
+    return sizeof(unsigned long) > sizeof(unsigned int) ? 
+        make_format_arg(static_cast<unsigned long long>(value)) : 
+        make_format_arg(static_cast<unsigned int>(value));
+}
+
+
+inline FormatArg make_format_arg(float const value)
+{
+    FormatArg arg;
+    arg.type = FARG_FLOAT;
+    arg.real = value;
+    return arg;
+}
+
+
+inline FormatArg make_format_arg(long double const value)
+{
+    return make_format_arg(static_cast<double>(value));
+}
+
+
+// other pointers would silently be taken as logicals
+template <class T>
+FormatArg make_format_arg(T const* value) = delete;
+
+
+// View of contiguous values given as a single printfor argument. Like a
+// Fortran array in an output list, its elements are taken one by one by the
+// data edit descriptors, reverting the format when they outlast it.
+template <class T>
+class FormatSpan
+{
+public:
+    FormatSpan(T const* data, size_t size) : data_(data), size_(size) {}
+
+    T const* data() const { return this->data_; }
+    size_t size() const { return this->size_; }
+
+private:
+    T const* data_;
+    size_t size_;
+};
+
+
+template <class T>
+FormatSpan<T> format_span(T const* data, size_t size)
+{
+    return FormatSpan<T>(data, size);
+}
+
+
+template <class T>
+FormatArg format_span_element(void const* data, size_t index)
+{
+    return make_format_arg(static_cast<T const*>(data)[index]);
+}
+
+
+template <class T>
+FormatArg make_format_arg(FormatSpan<T> const& values)
+{
+    FormatArg arg;
+    arg.type = FARG_ARRAY;
+    arg.array.data = values.data();
+    arg.array.length = values.size();
+    arg.array.element = &format_span_element<T>;
+    return arg;
+}
+
+
+template <class T, class Allocator>
+FormatArg make_format_arg(std::vector<T, Allocator> const& values)
+{
+    return make_format_arg(format_span(values.data(), values.size()));
+}
+
+
+template <class T, size_t N>
+FormatArg make_format_arg(std::array<T, N> const& values)
+{
+    return make_format_arg(format_span(values.data(), N));
+}
+
+
+#if __cplusplus >= 202002L
+template <class T, size_t Extent>
+FormatArg make_format_arg(std::span<T, Extent> const values)
+{
+    return make_format_arg(format_span<std::remove_cv_t<T> >(values.data(), 
+        values.size()));
+}
+#endif
+
+
+// Type of a scanfor target
+enum FormatTargetType
+{
+    FTGT_INT,     // signed integer of size bytes
+    FTGT_UINT,    // unsigned integer of size bytes
+    FTGT_FLOAT,
+    FTGT_DOUBLE,
+    FTGT_BOOL,
+    FTGT_STRING,  // std::string
+    FTGT_CHARS,   // character array of size bytes, NUL-terminated
+    FTGT_VIEW,    // FormatArg::String pointing into the input
+    FTGT_STRING_VIEW  // std::string_view pointing into the input (C++17)
+};
+
+
+// A scanfor target: the variable a field is read into
+struct FormatTarget
+{
+    FormatTargetType type;
+    void* pointer;
+    size_t size;
+};
+
+
+inline FormatTarget make_format_target(FormatTargetType const type, 
+    void* const pointer, size_t const size)
+{
+    FormatTarget target;
+    target.type = type;
+    target.pointer = pointer;
+    target.size = size;
+    return target;
+}
+
+
+inline FormatTarget make_format_target(double* const value)
+{
+    return make_format_target(FTGT_DOUBLE, value, sizeof(double));
+}
+
+
+inline FormatTarget make_format_target(float* const value)
+{
+    return make_format_target(FTGT_FLOAT, value, sizeof(float));
+}
+
+
+inline FormatTarget make_format_target(bool* const value)
+{
+    return make_format_target(FTGT_BOOL, value, sizeof(bool));
+}
+
+
+inline FormatTarget make_format_target(std::string* const value)
+{
+    return make_format_target(FTGT_STRING, value, 0);
+}
+
+
+// views of character fields, valid as long as the input is; blanks padding
+// a short record are left out
+inline FormatTarget make_format_target(FormatArg::String* const value)
+{
+    return make_format_target(FTGT_VIEW, value, sizeof(FormatArg::String));
+}
+
+
+#if __cplusplus >= 201703L
+inline FormatTarget make_format_target(std::string_view* const value)
+{
+    return make_format_target(FTGT_STRING_VIEW, value, 
+        sizeof(std::string_view));
+}
+#endif
+
+
+// character arrays, given as &array
+template <size_t N>
+FormatTarget make_format_target(char (*value)[N])
+{
+    return make_format_target(FTGT_CHARS, *value, N);
+}
+
+
+// integers of any size and signedness
+template <class T>
+typename std::enable_if<std::is_integral<T>::value, FormatTarget>::type 
+make_format_target(T* const value)
+{
+    return make_format_target(std::is_signed<T>::value ? FTGT_INT : FTGT_UINT,
+        value, sizeof(T));
+}
+
+
+// a char pointer would be read as a one-byte integer
+FormatTarget make_format_target(char* value) = delete;
+
+
+// Bump allocator for compiled formats and captured records: allocations 
+// are carved out of blocks taken from the heap (with C++17, from an 
+// upstream std::pmr::memory_resource, of which the arena is one too), and 
+// only given back all at once, by reset, which keeps the blocks for the 
+// next batch, or on destruction. An arena is not thread-safe.
+class FormatArena
+#if __cplusplus >= 201703L
+    : public std::pmr::memory_resource
+#endif
+{
+public:
+    explicit FormatArena(size_t block_size = 4096);
+#if __cplusplus >= 201703L
+    FormatArena(size_t block_size, std::pmr::memory_resource* upstream);
+#endif
+    ~FormatArena();
+
+#if __cplusplus < 201703L
+    void* allocate(size_t size, 
+        size_t alignment = alignof(std::max_align_t))
+    {
+        return this->carve(size, alignment);
+    }
+
+    void deallocate(void*, size_t, size_t = alignof(std::max_align_t))
+    {
+    }
+#endif
+
+    // releases everything allocated, keeping the blocks
+    void reset();
+    // bytes allocated since the last reset, alignment included, and taken 
+    // from upstream
+    size_t used() const { return this->used_; }
+    size_t reserved() const { return this->reserved_; }
+
+#if __cplusplus >= 201703L
+protected:
+    void* do_allocate(size_t size, size_t alignment) override
+    {
+        return this->carve(size, alignment);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override
+    {
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const 
+        noexcept override
+    {
+        return this == &other;
+    }
+#endif
+
+private:
+    FormatArena(FormatArena const&);
+    FormatArena& operator=(FormatArena const&);
+
+    void* carve(size_t size, size_t alignment);
+
+    struct Block;
+    // blocks in the order they're used, from the current one
+    Block* first_;
+    Block* current_;
+    char* pos_;
+    char* end_;
+    size_t block_size_;
+    size_t used_;
+    size_t reserved_;
+#if __cplusplus >= 201703L
+    std::pmr::memory_resource* upstream_;
+#endif
+};
+
+
+// Allocator of standard containers from an arena, or from the heap without
+// one
+template <class T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    ArenaAllocator() : arena_(NULL) {}
+    explicit ArenaAllocator(FormatArena* arena) : arena_(arena) {}
+
+    template <class U>
+    ArenaAllocator(ArenaAllocator<U> const& other) : arena_(other.arena())
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        void* const memory = NULL == this->arena_ ? 
+            ::operator new(count * sizeof(T)) :
+            this->arena_->allocate(count * sizeof(T), alignof(T));
+        return static_cast<T*>(memory);
+    }
+
+    void deallocate(T* memory, size_t)
+    {
+        if (NULL == this->arena_)
+        {
+            ::operator delete(memory);
+        }
+    }
+
+    FormatArena* arena() const { return this->arena_; }
+
+private:
+    FormatArena* arena_;
+};
+
+
+template <class T, class U>
+bool operator==(ArenaAllocator<T> const& a, ArenaAllocator<U> const& b)
+{
+    return a.arena() == b.arena();
+}
+
+
+template <class T, class U>
+bool operator!=(ArenaAllocator<T> const& a, ArenaAllocator<U> const& b)
+{
+    return a.arena() != b.arena();
+}
+
+
+typedef std::vector<FormatItem, ArenaAllocator<FormatItem> > FormatItemList;
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char> >
+    FormatLiterals;
+
+
+// Destination of formatted records with its own buffer. Records are
+// formatted directly into the buffer, which is written out only when it's 
+// full, on flush, or (for derived classes that say so) on destruction. A 
+// sink is not thread-safe.
+class FormatSink
+{
+public:
+    // sink with its own buffer of capacity characters
+    explicit FormatSink(size_t capacity);
+    // sink using an external buffer
+    FormatSink(char* buffer, size_t capacity);
+    virtual ~FormatSink();
+
+    // appends characters, writing out the buffer when needed
+    void write(char const* data, size_t size);
+    void put(char c);
+    // writes out the buffered characters
+    void flush();
+
+    // buffered characters; after writing past them, set their new count 
+    // with resize
+    char* data() { return this->buffer_; }
+    size_t size() const { return this->size_; }
+    size_t capacity() const { return this->capacity_; }
+    void resize(size_t size) { this->size_ = size; }
+
+protected:
+    virtual void write_out(char const* data, size_t size) = 0;
+    // writes out the buffered characters followed by data, too large to be
+    // buffered
+    virtual void write_through(char const* buffered, size_t buffered_size, 
+        char const* data, size_t size);
+
+private:
+    FormatSink(FormatSink const&);
+    FormatSink& operator=(FormatSink const&);
+
+    std::vector<char> storage_;
+    char* buffer_;
+    size_t capacity_;
+    size_t size_;
+};
+
+
+// Sink writing to a file descriptor with write(2)/writev(2), bypassing
+// iostreams. The descriptor is not closed, but the buffer is flushed on
+// destruction.
+class FdSink : public FormatSink
+{
+public:
+    explicit FdSink(int fd, size_t capacity = 1 << 20);
+    ~FdSink();
+
+    int fd() const { return this->fd_; }
+    // errno of the first failed write, or 0; nothing is written after it
+    int error() const { return this->error_; }
+
+protected:
+    void write_out(char const* data, size_t size);
+    void write_through(char const* buffered, size_t buffered_size, 
+        char const* data, size_t size);
+
+private:
+    int fd_;
+    int error_;
+};
+
+
+// A whole file mapped into memory, read-only (read into memory where files
+// can't be mapped)
+class MappedFile
+{
+public:
+    explicit MappedFile(char const* path);
+    ~MappedFile();
+
+    char const* data() const { return this->data_; }
+    size_t size() const { return this->size_; }
+    // errno of the failed open or map, or 0
+    int error() const { return this->error_; }
+
+private:
+    MappedFile(MappedFile const&);
+    MappedFile& operator=(MappedFile const&);
+
+    char const* data_;
+    size_t size_;
+    int error_;
+    bool mapped_;
+};
+
+
+// Where the lines of a buffer start, found in a single pass (with SIMD 
+// instructions where available), so that readers go straight to any record
+// instead of looking for new lines again: an index built once serves any 
+// number of reads of the buffer, which must outlive it.
+class RecordIndex
+{
+public:
+    RecordIndex();
+    RecordIndex(char const* src, size_t size);
+
+    // indexes another buffer
+    void build(char const* src, size_t size);
+
+    char const* data() const { return this->data_; }
+    size_t size() const { return this->size_; }
+    // number of lines, the last one possibly without a new line
+    size_t lines() const { return this->starts_.size() - 1; }
+
+    // line n and its length, without the new line nor a carriage return 
+    // before it: readers pad a line shorter than the format with blanks
+    char const* line(size_t n, size_t* length) const
+    {
+        size_t const start = this->starts_[n];
+        size_t end = this->starts_[n + 1] - 1;
+        if (end > start && '\r' == this->data_[end - 1])
+        {
+            end = end - 1;
+        }
+        *length = end - start;
+        return this->data_ + start;
+    }
+
+    // offset of each line, then one past the new line ending the last line
+    // (as if it had one)
+    std::vector<size_t> const& starts() const { return this->starts_; }
+
+private:
+    char const* data_;
+    size_t size_;
+    std::vector<size_t> starts_;
+};
+
+
+// Called by FortranFormat::read_parallel with the number of a record and 
+// the values of its fields
+typedef void (*FormatRecordCallback)(void* context, size_t record, 
+    FormatArg const* values, size_t count);
+
+
+template <class Callback>
+void invoke_record_callback(void* context, size_t record, 
+    FormatArg const* values, size_t count)
+{
+    (*static_cast<Callback*>(context))(record, values, count);
+}
+
+
+// A column of FortranFormat::read_vectors: a std::vector of any element 
+// type with a make_format_target, resized to the number of records
+struct FormatColumn
+{
+    // type and size of the elements (no pointer)
+    FormatTarget element;
+    void* vector;
+    // reserve(vector, size), and resize(vector, size) returning the first 
+    // element
+    void (*reserve)(void* vector, size_t size);
+    void* (*resize)(void* vector, size_t size);
+};
+
+
+template <class T>
+void reserve_format_column(void* const vector, size_t const size)
+{
+    static_cast<std::vector<T>*>(vector)->reserve(size);
+}
+
+
+template <class T>
+void* resize_format_column(void* const vector, size_t const size)
+{
+    std::vector<T>& column = *static_cast<std::vector<T>*>(vector);
+    column.resize(size);
+    return column.empty() ? NULL : &column[0];
+}
+
+
+template <class T>
+FormatColumn make_format_column(std::vector<T>& column)
+{
+    FormatColumn result;
+    result.element = make_format_target(static_cast<T*>(NULL));
+    result.vector = &column;
+    result.reserve = &reserve_format_column<T>;
+    result.resize = &resize_format_column<T>;
+    return result;
+}
+
+
+// std::vector<bool> has no elements to point to
+FormatColumn make_format_column(std::vector<bool>& column) = delete;
+
+
+// A format string compiled once into a list of edit descriptors, which can
+// be executed many times without scanning the format string again. The
+// format "*" is list-directed, like Fortran's PRINT * and READ(*, *):
+// values are written in the layout of gfortran, and read separated by
+// blanks or commas. Writing a record to a buffer, a sink or a stream takes 
+// no heap allocations, but for fields wider than the sink's buffer.
+class FortranFormat
+{
+public:
+    explicit FortranFormat(char const* formatstr);
+    // the edit descriptors and literals allocated from the arena, which 
+    // must outlive the format
+    FortranFormat(char const* formatstr, FormatArena& arena);
+
+    // writes a record to the stream, like printfor
+    template <class... Args>
+    void write(std::ostream& stream, Args const&... args) const
+    {
+        // one extra argument, so that the array is never empty
+        FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+        this->write_args(stream, pack, sizeof...(Args));
+    }
+
+    void write_args(std::ostream& stream, FormatArg const* args, 
+        size_t count) const;
+
+    // appends a record to the sink, like printfor
+    template <class... Args>
+    void write(FormatSink& sink, Args const&... args) const
+    {
+        FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+        this->write_args(sink, pack, sizeof...(Args));
+    }
+
+    void write_args(FormatSink& sink, FormatArg const* args, 
+        size_t count) const;
+
+    // writes a record to a character buffer, like printfor_to_buffer
+    template <class... Args>
+    size_t write_to_buffer(char* dst, size_t size, Args const&... args) const
+    {
+        FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+        return this->write_args_to_buffer(dst, size, pack, sizeof...(Args));
+    }
+
+    size_t write_args_to_buffer(char* dst, size_t size, FormatArg const* args,
+        size_t count) const;
+
+    // writes the elements of an array argument like write, formatting 
+    // blocks of records on threads (all hardware threads when 0) and 
+    // writing the blocks in order
+    template <class T>
+    void write_parallel(FormatSink& sink, T const& values, 
+        unsigned int threads = 0) const
+    {
+        this->write_arg_parallel(sink, make_format_arg(values), threads);
+    }
+
+    template <class T>
+    void write_parallel(std::ostream& stream, T const& values, 
+        unsigned int threads = 0) const
+    {
+        this->write_arg_parallel(stream, make_format_arg(values), threads);
+    }
+
+    void write_arg_parallel(FormatSink& sink, FormatArg const& values, 
+        unsigned int threads) const;
+    void write_arg_parallel(std::ostream& stream, FormatArg const& values, 
+        unsigned int threads) const;
+
+    // reads a record from the stream, like scanfor
+    template <class... Args>
+    size_t read(std::istream& stream, Args*... args) const
+    {
+        FormatTarget const pack[] = { make_format_target(args)..., 
+            FormatTarget() };
+        return this->read_args(stream, pack, sizeof...(Args));
+    }
+
+    size_t read_args(std::istream& stream, FormatTarget const* targets, 
+        size_t count) const;
+
+    // reads a record from a character buffer, like scanfor_from_buffer
+    template <class... Args>
+    size_t read_from_buffer(char const* src, size_t size, Args*... args) const
+    {
+        FormatTarget const pack[] = { make_format_target(args)..., 
+            FormatTarget() };
+        return this->read_args_from_buffer(src, size, pack, sizeof...(Args));
+    }
+
+    // consumed, when given, is set to the number of characters read, up to 
+    // and including the new line of the last record
+    size_t read_args_from_buffer(char const* src, size_t size, 
+        FormatTarget const* targets, size_t count, 
+        size_t* consumed = NULL) const;
+
+    // reads a record from an indexed buffer, from line on
+    template <class... Args>
+    size_t read_from_index(RecordIndex const& index, size_t line, 
+        Args*... args) const
+    {
+        FormatTarget const pack[] = { make_format_target(args)..., 
+            FormatTarget() };
+        return this->read_args_from_index(index, line, pack, 
+            sizeof...(Args));
+    }
+
+    // next_line, when given, is set to the line after the last one read
+    size_t read_args_from_index(RecordIndex const& index, size_t line, 
+        FormatTarget const* targets, size_t count, 
+        size_t* next_line = NULL) const;
+
+    // Reads every record of src, a record being the lines read by a pass 
+    // over the format, on threads (all hardware threads when 0). The 
+    // callback is called as callback(record, values, count) for each one, 
+    // concurrently and in no particular order, with a value per data edit 
+    // descriptor: FARG_INT for I, FARG_DOUBLE for F, E, D and G, FARG_BOOL 
+    // for L, and FARG_STRING pointing into src for A. Returns the number of
+    // records read before the first one with an invalid field, or all of 
+    // them; records after it may have been read as well.
+    template <class Callback>
+    size_t read_parallel(char const* src, size_t size, Callback callback, 
+        unsigned int threads = 0) const
+    {
+        return this->read_parallel(src, size, 
+            &invoke_record_callback<Callback>, &callback, threads);
+    }
+
+    size_t read_parallel(char const* src, size_t size, 
+        FormatRecordCallback callback, void* context, 
+        unsigned int threads = 0) const;
+
+    // read_parallel over an indexed buffer, whose new lines aren't looked
+    // for again
+    template <class Callback>
+    size_t read_parallel(RecordIndex const& index, Callback callback, 
+        unsigned int threads = 0) const
+    {
+        return this->read_parallel(index, 
+            &invoke_record_callback<Callback>, &callback, threads);
+    }
+
+    size_t read_parallel(RecordIndex const& index, 
+        FormatRecordCallback callback, void* context, 
+        unsigned int threads = 0) const;
+
+    // Like read_parallel, reading the fields of record r into element r of
+    // the columns, one per data edit descriptor of a pass, each given as a 
+    // target for its first element (e.g. make_format_target(&x[0])). At 
+    // most rows records are read: size the columns with count_records.
+    // With a list-directed format, which read_parallel doesn't take, every
+    // line is a record of a value per column.
+    size_t read_columns(char const* src, size_t size, 
+        FormatTarget const* columns, size_t count, size_t rows, 
+        unsigned int threads = 0) const;
+
+    size_t read_columns(RecordIndex const& index, 
+        FormatTarget const* columns, size_t count, size_t rows, 
+        unsigned int threads = 0) const;
+
+    // Like read_columns into vectors, one per data edit descriptor of a 
+    // pass, which are resized to the number of records read: their 
+    // capacity is reserved from the record length first, and their size 
+    // taken from the count of lines made while splitting the input
+    template <class... Columns>
+    size_t read_vectors(char const* src, size_t size, 
+        std::vector<Columns>&... columns) const
+    {
+        FormatColumn const pack[] = { make_format_column(columns)..., 
+            FormatColumn() };
+        return this->read_vectors(src, size, pack, sizeof...(Columns));
+    }
+
+    size_t read_vectors(char const* src, size_t size, 
+        FormatColumn const* columns, size_t count, 
+        unsigned int threads = 0) const;
+
+    // number of records in src, as read by read_parallel
+    size_t count_records(char const* src, size_t size) const;
+    size_t count_records(RecordIndex const& index) const;
+
+    FormatItemList const& items() const { return this->items_; }
+    FormatLiterals const& literals() const { return this->literals_; }
+    bool list_directed() const { return this->list_directed_; }
+
+private:
+    FormatItemList items_;
+    // unescaped character strings and Hollerith constants
+    FormatLiterals literals_;
+    // "*", without items
+    bool list_directed_;
+};
+
+
+// column of the fields following an A edit without a width in their line
+size_t const FORMAT_COLUMN_UNKNOWN = ~size_t(0);
+
+// What FormatLogger::log does when the calling thread's ring is full, and 
+// RecordQueue::write when the calling thread's records are all queued
+enum LogOverflow
+{
+    // the record is dropped, and counted
+    LOG_DROP,
+    // the thread waits for the consumer to make room
+    LOG_BLOCK
+};
+
+
+struct LogState;
+
+
+// Deferred formatting: log only copies the address of a compiled format and
+// the arguments (strings and array elements included) into a ring buffer of
+// the calling thread, without locks, and a consumer thread formats the 
+// records into the sink, those of each thread in order. Every logging 
+// thread takes ring_size bytes, given back when it exits, and a record 
+// larger than that is dropped. 
+// The formats must outlive the logger, and the sink is the consumer's until
+// the logger is destroyed, which writes out the records logged so far.
+class FormatLogger
+{
+public:
+    explicit FormatLogger(FormatSink& sink, size_t ring_size = 1 << 16, 
+        LogOverflow overflow = LOG_DROP);
+    ~FormatLogger();
+
+    // false when the record was dropped
+    template <class... Args>
+    bool log(FortranFormat const& format, Args const&... args)
+    {
+        FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+        return this->log_args(format, pack, sizeof...(Args));
+    }
+
+    bool log_args(FortranFormat const& format, FormatArg const* args, 
+        size_t count);
+
+    // waits until the records logged before are written out, and flushes 
+    // the sink
+    void flush();
+
+    // number of records dropped so far
+    unsigned long long dropped() const;
+
+    // number of rings, as many as threads have logged at the same time: 
+    // the ring of a thread that exited is taken by the next one
+    size_t rings() const;
+
+private:
+    FormatLogger(FormatLogger const&);
+    FormatLogger& operator=(FormatLogger const&);
+
+    LogState* state_;
+};
+
+
+struct RecordQueueState;
+
+
+// Records written by any number of threads to a single sink or stream, 
+// never mixed up: each thread formats a whole record into memory of its 
+// own (kept for its next records), then pushes it onto a lock-free queue, 
+// which a writer thread drains into the sink in the order records were 
+// pushed. A thread holds up to records records (at least 2), past which it
+// waits for the writer to give one back or drops the record, so that a 
+// slow sink doesn't take ever more memory. The sink or stream is the 
+// writer's until the queue is destroyed, which writes out the records 
+// queued so far.
+class RecordQueue
+{
+public:
+    explicit RecordQueue(FormatSink& sink, size_t records = 1 << 10, 
+        LogOverflow overflow = LOG_BLOCK);
+    explicit RecordQueue(std::ostream& stream, size_t records = 1 << 10, 
+        LogOverflow overflow = LOG_BLOCK);
+    ~RecordQueue();
+
+    // false when the record was dropped
+    template <class... Args>
+    bool write(FortranFormat const& format, Args const&... args)
+    {
+        FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+        return this->write_args(format, pack, sizeof...(Args));
+    }
+
+    bool write_args(FortranFormat const& format, FormatArg const* args, 
+        size_t count);
+
+    // waits until the records queued before are written out, and flushes 
+    // the sink
+    void flush();
+
+    // number of records dropped so far
+    unsigned long long dropped() const;
+
+private:
+    RecordQueue(RecordQueue const&);
+    RecordQueue& operator=(RecordQueue const&);
+
+    RecordQueueState* state_;
+};
+
+
+struct PipelineState;
+
+
+// Records of any formats, independent of each other, formatted on threads 
+// (all hardware threads when 0) and written to the sink in the order they
+// were submitted. submit captures the arguments, strings and array 
+// elements included, and hands the record to a worker, idle workers taking
+// records from the others; completed records are written out as soon as 
+// those before them are. At most window records are in flight: submit 
+// waits for room beyond that. Records are submitted by a thread at a time,
+// and the formats must outlive the pipeline, which writes out the pending 
+// records on destruction.
+class FormatPipeline
+{
+public:
+    explicit FormatPipeline(FormatSink& sink, unsigned int threads = 0, 
+        size_t window = 4096);
+    ~FormatPipeline();
+
+    template <class... Args>
+    void submit(FortranFormat const& format, Args const&... args)
+    {
+        FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+        this->submit_args(format, pack, sizeof...(Args));
+    }
+
+    void submit_args(FortranFormat const& format, FormatArg const* args, 
+        size_t count);
+
+    // waits until the records submitted are written out, and flushes the 
+    // sink
+    void flush();
+
+private:
+    FormatPipeline(FormatPipeline const&);
+    FormatPipeline& operator=(FormatPipeline const&);
+
+    PipelineState* state_;
+};
+
+
+// A record captured to be formatted later, e.g. with 
+// format->write_args(sink, args, count): the arguments are copied, strings
+// and array elements included (array elements listed one by one)
+struct FormatRecord
+{
+    FortranFormat const* format;
+    FormatArg const* args;
+    size_t count;
+};
+
+
+// captures a record into the arena, which keeps it until reset; the 
+// format must outlive the record
+FormatRecord capture_record_args(FormatArena& arena, 
+    FortranFormat const& format, FormatArg const* args, size_t count);
+
+
+template <class... Args>
+FormatRecord capture_record(FormatArena& arena, FortranFormat const& format,
+    Args const&... args)
+{
+    FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+    return capture_record_args(arena, format, pack, sizeof...(Args));
+}
+
+
+// Where a data edit descriptor of a pass over a format reads its field 
+// from, with the modes set before it
+struct FormatField
+{
+    FormatOp     op;
+    unsigned int width;     // 0 for A without a width
+    unsigned int digits;    // implied decimals of F, E, D and G
+    size_t       line;      // line of the record, from 0
+    size_t       column;    // first column, from 0
+    bool         blank_zero;
+    int          scale;
+};
+
+
+// Some data edit descriptors of a pass over a format, by position (0 for 
+// the first one, counting each repetition), located once in the record so
+// that reading decodes their fields alone and skips the others untouched.
+// The fields to read may be given in any order, and must not follow an A
+// edit without a width in their line: a projection with such a field, or 
+// one past the fields of a pass, isn't valid and reads nothing. The format
+// must outlive the projection.
+class FormatProjection
+{
+public:
+    FormatProjection(FortranFormat const& format, size_t const* positions, 
+        size_t count);
+
+    template <size_t N>
+    FormatProjection(FortranFormat const& format, 
+        size_t const (&positions)[N])
+    {
+        this->locate(format, positions, N);
+    }
+
+    // reads the fields of a record from a character buffer, in the order of
+    // their positions, like FortranFormat::read_from_buffer
+    template <class... Args>
+    size_t read_from_buffer(char const* src, size_t size, Args*... args) const
+    {
+        FormatTarget const pack[] = { make_format_target(args)..., 
+            FormatTarget() };
+        return this->read_args_from_buffer(src, size, pack, sizeof...(Args));
+    }
+
+    size_t read_args_from_buffer(char const* src, size_t size, 
+        FormatTarget const* targets, size_t count, 
+        size_t* consumed = NULL) const;
+
+    // reads the fields of the record starting at a line of an indexed 
+    // buffer
+    template <class... Args>
+    size_t read_from_index(RecordIndex const& index, size_t line, 
+        Args*... args) const
+    {
+        FormatTarget const pack[] = { make_format_target(args)..., 
+            FormatTarget() };
+        return this->read_args_from_index(index, line, pack, 
+            sizeof...(Args));
+    }
+
+    size_t read_args_from_index(RecordIndex const& index, size_t line, 
+        FormatTarget const* targets, size_t count) const;
+
+    // like FortranFormat::read_columns and read_vectors, with a column per 
+    // projected field
+    size_t read_columns(char const* src, size_t size, 
+        FormatTarget const* columns, size_t count, size_t rows, 
+        unsigned int threads = 0) const;
+
+    size_t read_columns(RecordIndex const& index, 
+        FormatTarget const* columns, size_t count, size_t rows, 
+        unsigned int threads = 0) const;
+
+    template <class... Columns>
+    size_t read_vectors(char const* src, size_t size, 
+        std::vector<Columns>&... columns) const
+    {
+        FormatColumn const pack[] = { make_format_column(columns)..., 
+            FormatColumn() };
+        return this->read_vectors(src, size, pack, sizeof...(Columns));
+    }
+
+    size_t read_vectors(char const* src, size_t size, 
+        FormatColumn const* columns, size_t count, 
+        unsigned int threads = 0) const;
+
+    FortranFormat const& format() const { return *this->format_; }
+    // none when the projection isn't valid
+    std::vector<FormatField> const& fields() const { return this->fields_; }
+    // lines of a record
+    size_t record_lines() const { return this->record_lines_; }
+    bool valid() const { return this->valid_; }
+
+private:
+    void locate(FortranFormat const& format, size_t const* positions, 
+        size_t count);
+
+    FortranFormat const* format_;
+    std::vector<FormatField> fields_;
+    size_t record_lines_;
+    bool valid_;
+};
+
+
+// Counters of the compiled format cache used by printfor, summed over all
+// threads
+struct FormatCacheStats
+{
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    // format string addresses currently remembered by the live caches
+    unsigned long long addresses;
+};
+
+// maximum number of compiled formats cached by each thread (0 disables it)
+void set_format_cache_capacity(size_t capacity);
+
+size_t format_cache_capacity();
+
+FormatCacheStats format_cache_stats();
+
+
+// printfor with already captured arguments
+void vprintfor(std::ostream& stream, char const* formatstr, 
+    FormatArg const* args, size_t count);
+
+void vprintfor(char const* formatstr, FormatArg const* args, size_t count);
+
+void vprintfor(FormatSink& sink, char const* formatstr, 
+    FormatArg const* args, size_t count);
+
+
+size_t vprintfor_to_buffer(char* dst, size_t size, char const* formatstr, 
+    FormatArg const* args, size_t count);
+
+
+template <class... Args>
+void printfor(char const* formatstr, Args const&... args)
+{
+    FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+    vprintfor(formatstr, pack, sizeof...(Args));
+}
+
+
+template <class... Args>
+void printfor(std::ostream& stream, char const* formatstr, 
+    Args const&... args)
+{
+    FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+    vprintfor(stream, formatstr, pack, sizeof...(Args));
+}
+
+
+template <class... Args>
+void printfor(FormatSink& sink, char const* formatstr, Args const&... args)
+{
+    FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+    vprintfor(sink, formatstr, pack, sizeof...(Args));
+}
+
+
+// Writes a record into dst, like a Fortran internal WRITE: at most size 
+// characters including a terminating NUL, without the record's final new
+// line. Returns the length of the whole record, so a return value of size or
+// more means the output was truncated, in which case only the fields that 
+// fit completely are written. Nothing is allocated, apart from compiling the
+// format the first time it is used (see FortranFormat::write_to_buffer).
+template <class... Args>
+size_t printfor_to_buffer(char* dst, size_t size, char const* formatstr, 
+    Args const&... args)
+{
+    FormatArg const pack[] = { make_format_arg(args)..., FormatArg() };
+    return vprintfor_to_buffer(dst, size, formatstr, pack, sizeof...(Args));
+}
+
+
+// Formatted READ: fields are decoded from the fixed columns given by the 
+// format, following Fortran's rules for input (blanks are ignored in 
+// numeric fields, Fw.d without a decimal point has d implied decimals,
+// exponents may be written with E, D or just a sign). Arguments are 
+// pointers to the variables to read: integers, float, double, bool, 
+// std::string and character arrays (as &array). Returns the number of 
+// variables read, which is less than their count when a field is invalid or
+// the input ends. The stream is left after the new line of the last record.
+size_t vscanfor(std::istream& stream, char const* formatstr, 
+    FormatTarget const* targets, size_t count);
+
+size_t vscanfor(char const* formatstr, FormatTarget const* targets, 
+    size_t count);
+
+size_t vscanfor_from_buffer(char const* src, size_t size, 
+    char const* formatstr, FormatTarget const* targets, size_t count);
+
+
+// reads from standard input
+template <class... Args>
+size_t scanfor(char const* formatstr, Args*... args)
+{
+    FormatTarget const pack[] = { make_format_target(args)..., FormatTarget() };
+    return vscanfor(formatstr, pack, sizeof...(Args));
+}
+
+
+template <class... Args>
+size_t scanfor(std::istream& stream, char const* formatstr, Args*... args)
+{
+    FormatTarget const pack[] = { make_format_target(args)..., FormatTarget() };
+    return vscanfor(stream, formatstr, pack, sizeof...(Args));
+}
+
+
+// Reads from the records in src (separated by new lines), like a Fortran
+// internal READ
+template <class... Args>
+size_t scanfor_from_buffer(char const* src, size_t size, 
+    char const* formatstr, Args*... args)
+{
+    FormatTarget const pack[] = { make_format_target(args)..., FormatTarget() };
+    return vscanfor_from_buffer(src, size, formatstr, pack, sizeof...(Args));
+}
 
 #endif
\ No newline at end of file
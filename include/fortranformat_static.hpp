@@ -0,0 +1,1095 @@
+// C++ Fortran Format
+// https://github.com/dparrini/cpp-fortranformat
+// Copyright (c) 2019 David Parrini
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+
+// Format strings parsed at compile time.
+//
+// FORTRAN_FMT("(...)") turns a format string literal into a StaticFormat,
+// whose edit descriptors are template arguments: widths and precisions are
+// constants, there is no dispatch while writing, and a malformed format or a
+// wrong number of arguments fails to compile. With C++20, the format literal
+// can also be given directly as a template argument: printfor<"(...)">(...).
+
+#ifndef H_FORTRANFORMAT_STATIC__
+#define H_FORTRANFORMAT_STATIC__
+
+#include <cstddef>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include "fortranformat.hpp"
+
+
+// edit descriptor kernels (fortranformat.cpp)
+void format_i(char* put, long long const value, size_t const width,
+    size_t const fill, bool const plus_sign);
+void format_u(char* put, unsigned long long const value, size_t const width,
+    size_t const fill, bool const plus_sign);
+void format_f(char* put, double const value, size_t const width,
+    size_t const precision, int const scale, bool const plus_sign);
+void format_e(char* put, double const value, size_t const width,
+    size_t const precision, char const expchar, size_t const exponent_width,
+    int const scale, bool const plus_sign);
+void format_g(char* put, double const value, size_t const width,
+    size_t const precision, size_t const exponent, int const scale,
+    bool const plus_sign);
+
+
+namespace static_format
+{
+
+//
+// Compile-time scanner
+//
+// A format source S provides the format string through S::str() and its
+// characters through the constexpr S::at(pos), which returns '\0' past the
+// end of the string.
+
+constexpr bool is_digit(char const c)
+{
+    return c >= '0' && c <= '9';
+}
+
+
+template <class S>
+constexpr size_t skip_whitespace(size_t const pos)
+{
+    return (S::at(pos) == ' ' || S::at(pos) == '\t' || S::at(pos) == '\r' ||
+        S::at(pos) == '\n') ? skip_whitespace<S>(pos + 1) : pos;
+}
+
+
+template <class S>
+constexpr size_t integer_end(size_t const pos)
+{
+    return is_digit(S::at(pos)) ? integer_end<S>(pos + 1) : pos;
+}
+
+
+// saturated, like the runtime scanner's
+template <class S>
+constexpr unsigned int integer(size_t const pos, unsigned int const value = 0)
+{
+    return !is_digit(S::at(pos)) ? value : 
+        integer<S>(pos + 1, value > (~0u - (S::at(pos) - '0')) / 10 ? ~0u : 
+            value * 10 + (S::at(pos) - '0'));
+}
+
+
+// position of the closing quotation mark, or of the final '\0'
+template <class S>
+constexpr size_t string_end(size_t const pos, char const quote)
+{
+    return S::at(pos) == '\0' ? pos :
+        S::at(pos) != quote ? string_end<S>(pos + 1, quote) :
+        S::at(pos + 1) == quote ? string_end<S>(pos + 2, quote) : pos;
+}
+
+
+template <class S>
+constexpr bool has_escapes(size_t const first, size_t const last,
+    char const quote)
+{
+    return first < last &&
+        (S::at(first) == quote || has_escapes<S>(first + 1, last, quote));
+}
+
+
+template <class S>
+constexpr bool available(size_t const pos, size_t const length)
+{
+    return length == 0 ||
+        (S::at(pos) != '\0' && available<S>(pos + 1, length - 1));
+}
+
+
+//
+// Compiled edit descriptors
+//
+
+template <class... Items>
+struct ItemList
+{
+};
+
+
+template <class Item, class List>
+struct Prepend;
+
+
+template <class Item, class... Items>
+struct Prepend<Item, ItemList<Items...> >
+{
+    typedef ItemList<Item, Items...> type;
+};
+
+
+template <FormatOp Op, unsigned int Repeat, unsigned int Width = 0,
+    unsigned int Digits = 0, unsigned int Exponent = 0>
+struct Descriptor
+{
+};
+
+
+// characters [First, Last) of the format string, with doubled Quote
+// characters escaped (Quote is '\0' for Hollerith constants)
+template <class S, size_t First, size_t Last, char Quote>
+struct Literal
+{
+};
+
+
+template <unsigned int Repeat, class List>
+struct Group
+{
+};
+
+
+// kP
+template <int Scale>
+struct ScaleFactor
+{
+};
+
+
+//
+// Compile-time parser
+//
+
+template <class S, size_t Pos, char C = S::at(skip_whitespace<S>(Pos))>
+struct ParseList;
+
+
+// Repeat is 0 when the descriptor has no repeat count
+template <class S, size_t Pos, unsigned int Repeat, char C = S::at(Pos)>
+struct ParseDescriptor
+{
+    static_assert(C == '\0' && C != '\0',
+        "unsupported edit descriptor in format string");
+    typedef ItemList<> type;
+    static size_t const end = Pos + 1;
+};
+
+
+template <class S, size_t Pos, bool HasRepeat = is_digit(S::at(Pos))>
+struct ParseItem : ParseDescriptor<S, Pos, 0>
+{
+};
+
+
+template <class S, size_t Pos>
+struct ParseItem<S, Pos, true> : ParseDescriptor<S,
+    skip_whitespace<S>(integer_end<S>(Pos)), integer<S>(Pos)>
+{
+    // but for a scale factor
+    static_assert(integer<S>(Pos) > 0 ||
+        S::at(skip_whitespace<S>(integer_end<S>(Pos))) == 'P',
+        "repeat count must be positive");
+};
+
+
+// items until the closing parenthesis
+template <class S, size_t Pos, char C>
+struct ParseList
+{
+    typedef ParseItem<S, skip_whitespace<S>(Pos)> Item;
+    typedef ParseList<S, Item::end> Rest;
+
+    typedef typename Prepend<typename Item::type, typename Rest::type>::type
+        type;
+    static size_t const end = Rest::end;
+};
+
+
+template <class S, size_t Pos>
+struct ParseList<S, Pos, ')'>
+{
+    typedef ItemList<> type;
+    static size_t const end = skip_whitespace<S>(Pos) + 1;
+};
+
+
+template <class S, size_t Pos>
+struct ParseList<S, Pos, ','> : ParseList<S, skip_whitespace<S>(Pos) + 1>
+{
+};
+
+
+template <class S, size_t Pos>
+struct ParseList<S, Pos, '\0'>
+{
+    static_assert(Pos == 0 && Pos != 0,
+        "missing closing parenthesis in format string");
+    typedef ItemList<> type;
+    static size_t const end = Pos;
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, '('>
+{
+    typedef ParseList<S, Pos + 1> Body;
+
+    typedef Group<Repeat == 0 ? 1 : Repeat, typename Body::type> type;
+    static size_t const end = Body::end;
+};
+
+
+// w, w.d and w.dEe fields
+template <class S, size_t Pos, bool HasExponent>
+struct RealFields
+{
+    static size_t const width_end = integer_end<S>(Pos + 1);
+    static_assert(S::at(width_end) == '.',
+        "real edit descriptors require a .d field");
+
+    static size_t const digits_end = integer_end<S>(width_end + 1);
+    static bool const has_exponent = HasExponent && S::at(digits_end) == 'E';
+
+    static unsigned int const width = integer<S>(Pos + 1);
+    static unsigned int const digits = integer<S>(width_end + 1);
+    static unsigned int const exponent = has_exponent ?
+        integer<S>(digits_end + 1) : 0;
+    static size_t const end = has_exponent ?
+        integer_end<S>(digits_end + 1) : digits_end;
+
+    static_assert(width > 0, "edit descriptor width must be positive");
+    static_assert(!has_exponent || exponent > 0,
+        "exponent width must be positive");
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat, FormatOp Op,
+    bool HasExponent>
+struct ParseReal
+{
+    typedef RealFields<S, Pos, HasExponent> Fields;
+
+    typedef Descriptor<Op, Repeat == 0 ? 1 : Repeat, Fields::width,
+        Fields::digits, Fields::exponent> type;
+    static size_t const end = Fields::end;
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'D'>
+    : ParseReal<S, Pos, Repeat, FOP_D, false>
+{
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'E'>
+    : ParseReal<S, Pos, Repeat, FOP_E, true>
+{
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'F'>
+    : ParseReal<S, Pos, Repeat, FOP_F, false>
+{
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'G'>
+    : ParseReal<S, Pos, Repeat, FOP_G, true>
+{
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'I'>
+{
+    static size_t const width_end = integer_end<S>(Pos + 1);
+    static bool const has_fill = S::at(width_end) == '.';
+
+    static unsigned int const width = integer<S>(Pos + 1);
+    static unsigned int const fill = has_fill ? integer<S>(width_end + 1) : 0;
+    static_assert(width > 0, "edit descriptor width must be positive");
+
+    typedef Descriptor<FOP_I, Repeat == 0 ? 1 : Repeat, width, fill> type;
+    static size_t const end = has_fill ?
+        integer_end<S>(width_end + 1) : width_end;
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'L'>
+{
+    static unsigned int const width = integer<S>(Pos + 1);
+    static_assert(width > 0, "edit descriptor width must be positive");
+
+    typedef Descriptor<FOP_L, Repeat == 0 ? 1 : Repeat, width> type;
+    static size_t const end = integer_end<S>(Pos + 1);
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'A'>
+{
+    // 0 when the width is omitted
+    static unsigned int const width = integer<S>(Pos + 1);
+
+    typedef Descriptor<FOP_A, Repeat == 0 ? 1 : Repeat, width> type;
+    static size_t const end = integer_end<S>(Pos + 1);
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'X'>
+{
+    typedef Descriptor<FOP_X, Repeat == 0 ? 1 : Repeat> type;
+    static size_t const end = Pos + 1;
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, '/'>
+{
+    typedef Descriptor<FOP_NL, Repeat == 0 ? 1 : Repeat> type;
+    static size_t const end = Pos + 1;
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'S'>
+{
+    static_assert(Repeat == 0, "sign edit descriptors can't be repeated");
+    static bool const plus_sign = S::at(Pos + 1) == 'P';
+
+    typedef Descriptor<plus_sign ? FOP_SP : FOP_SS, 1> type;
+    static size_t const end =
+        (S::at(Pos + 1) == 'P' || S::at(Pos + 1) == 'S') ? Pos + 2 : Pos + 1;
+};
+
+
+// scale factor, Repeat being its value (0 when omitted); the descriptor it
+// prefixes, if any, follows as another item
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'P'>
+{
+    static_assert(Repeat <= unsigned(FORMAT_MAX_SCALE), 
+        "scale factor too large");
+
+    typedef ScaleFactor<static_cast<int>(Repeat)> type;
+    static size_t const end = Pos + 1;
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat, int Sign>
+struct ParseSignedScale
+{
+    static size_t const first = skip_whitespace<S>(Pos + 1);
+    static_assert(Repeat == 0 && is_digit(S::at(first)),
+        "unsupported edit descriptor in format string");
+    static size_t const last = skip_whitespace<S>(integer_end<S>(first));
+    static_assert(S::at(last) == 'P', "only scale factors can be signed");
+    static_assert(integer<S>(first) <= unsigned(FORMAT_MAX_SCALE), 
+        "scale factor too large");
+
+    typedef ScaleFactor<Sign * static_cast<int>(integer<S>(first))> type;
+    static size_t const end = last + 1;
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, '-'>
+    : ParseSignedScale<S, Pos, Repeat, -1>
+{
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, '+'>
+    : ParseSignedScale<S, Pos, Repeat, 1>
+{
+};
+
+
+// blank interpretation, which only matters on input
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'B'>
+{
+    static_assert(Repeat == 0, "blank edit descriptors can't be repeated");
+    static_assert(S::at(Pos + 1) == 'N' || S::at(Pos + 1) == 'Z',
+        "unsupported edit descriptor in format string");
+
+    typedef Descriptor<S::at(Pos + 1) == 'Z' ? FOP_BZ : FOP_BN, 1> type;
+    static size_t const end = Pos + 2;
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, 'H'>
+{
+    static_assert(Repeat > 0, "Hollerith constants require a length");
+    static_assert(available<S>(Pos + 1, Repeat),
+        "Hollerith constant longer than the format string");
+
+    typedef Literal<S, Pos + 1, Pos + 1 + Repeat, '\0'> type;
+    static size_t const end = Pos + 1 + Repeat;
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat, char Quote>
+struct ParseString
+{
+    static_assert(Repeat == 0, "character strings can't be repeated");
+    static size_t const last = string_end<S>(Pos + 1, Quote);
+    static_assert(S::at(last) == Quote, "unterminated character string");
+
+    typedef Literal<S, Pos + 1, last, Quote> type;
+    static size_t const end = last + 1;
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, '\''>
+    : ParseString<S, Pos, Repeat, '\''>
+{
+};
+
+
+template <class S, size_t Pos, unsigned int Repeat>
+struct ParseDescriptor<S, Pos, Repeat, '"'>
+    : ParseString<S, Pos, Repeat, '"'>
+{
+};
+
+
+template <class S>
+struct ParseFormat
+{
+    static size_t const start = skip_whitespace<S>(0);
+    static_assert(S::at(start) == '(', "format string must start with (");
+
+    typedef typename ParseList<S, start + 1>::type type;
+};
+
+
+//
+// Arguments consumed by the edit descriptors
+//
+
+template <class Item>
+struct ArgCount
+{
+    static size_t const value = 0;
+};
+
+
+template <class List>
+struct ListArgCount;
+
+
+template <>
+struct ListArgCount<ItemList<> >
+{
+    static size_t const value = 0;
+};
+
+
+template <class Item, class... Items>
+struct ListArgCount<ItemList<Item, Items...> >
+{
+    static size_t const value = ArgCount<Item>::value +
+        ListArgCount<ItemList<Items...> >::value;
+};
+
+
+template <FormatOp Op, unsigned int Repeat, unsigned int Width,
+    unsigned int Digits, unsigned int Exponent>
+struct ArgCount<Descriptor<Op, Repeat, Width, Digits, Exponent> >
+{
+    // data edit descriptors come first in FormatOp
+    static size_t const value = Op <= FOP_A ? Repeat : 0;
+};
+
+
+template <unsigned int Repeat, class List>
+struct ArgCount<Group<Repeat, List> >
+{
+    static size_t const value = Repeat * ListArgCount<List>::value;
+};
+
+
+//
+// Edit descriptor writers
+//
+
+// Modes set by edit descriptors for the following ones
+struct WriteMode
+{
+    // SP, SS
+    bool plus_sign;
+    // kP
+    int scale;
+
+    WriteMode() : plus_sign(false), scale(0)
+    {
+    }
+};
+
+
+template <class Item>
+struct WriteValue;
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent>
+struct WriteValue<Descriptor<FOP_I, Repeat, Width, Digits, Exponent> >
+{
+    template <class T, class Stream>
+    static void write(Stream& stream, T const value, WriteMode const& mode)
+    {
+        static_assert(std::is_integral<T>::value,
+            "the I edit descriptor requires an integer argument");
+        char put[Width + 1];
+        if (std::is_signed<T>::value)
+        {
+            format_i(put, static_cast<long long>(value), Width, Digits,
+                mode.plus_sign);
+        }
+        else
+        {
+            format_u(put, static_cast<unsigned long long>(value), Width,
+                Digits, mode.plus_sign);
+        }
+        stream.write(put, Width);
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent>
+struct WriteValue<Descriptor<FOP_F, Repeat, Width, Digits, Exponent> >
+{
+    template <class T, class Stream>
+    static void write(Stream& stream, T const value, WriteMode const& mode)
+    {
+        static_assert(std::is_floating_point<T>::value,
+            "the F edit descriptor requires a floating point argument");
+        char put[Width + 1];
+        format_f(put, value, Width, Digits, mode.scale, mode.plus_sign);
+        stream.write(put, Width);
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent>
+struct WriteValue<Descriptor<FOP_D, Repeat, Width, Digits, Exponent> >
+{
+    template <class T, class Stream>
+    static void write(Stream& stream, T const value, WriteMode const& mode)
+    {
+        static_assert(std::is_floating_point<T>::value,
+            "the D edit descriptor requires a floating point argument");
+        char put[Width + 1];
+        format_e(put, value, Width, Digits, 'D', Exponent, mode.scale,
+            mode.plus_sign);
+        stream.write(put, Width);
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent>
+struct WriteValue<Descriptor<FOP_E, Repeat, Width, Digits, Exponent> >
+{
+    template <class T, class Stream>
+    static void write(Stream& stream, T const value, WriteMode const& mode)
+    {
+        static_assert(std::is_floating_point<T>::value,
+            "the E edit descriptor requires a floating point argument");
+        char put[Width + 1];
+        format_e(put, value, Width, Digits, 'E', Exponent, mode.scale,
+            mode.plus_sign);
+        stream.write(put, Width);
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent>
+struct WriteValue<Descriptor<FOP_G, Repeat, Width, Digits, Exponent> >
+{
+    template <class T, class Stream>
+    static void write(Stream& stream, T const value, WriteMode const& mode)
+    {
+        static_assert(std::is_floating_point<T>::value,
+            "the G edit descriptor requires a floating point argument");
+        char put[Width + 1];
+        format_g(put, value, Width, Digits, Exponent, mode.scale,
+            mode.plus_sign);
+        stream.write(put, Width);
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent>
+struct WriteValue<Descriptor<FOP_L, Repeat, Width, Digits, Exponent> >
+{
+    template <class T, class Stream>
+    static void write(Stream& stream, T const value, WriteMode const&)
+    {
+        static_assert(std::is_integral<T>::value,
+            "the L edit descriptor requires a logical argument");
+        char put[Width];
+        for (size_t pos = 0; pos < Width - 1; ++pos)
+        {
+            put[pos] = ' ';
+        }
+        put[Width - 1] = value ? 'T' : 'F';
+        stream.write(put, Width);
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent>
+struct WriteValue<Descriptor<FOP_A, Repeat, Width, Digits, Exponent> >
+{
+    template <class Stream>
+    static void write_chars(Stream& stream, char const* value,
+        size_t const length)
+    {
+        if (Width == 0)
+        {
+            stream.write(value, length);
+        }
+        else if (Width > length)
+        {
+            // right-aligned
+            for (size_t pos = 0; pos < Width - length; ++pos)
+            {
+                stream.put(' ');
+            }
+            stream.write(value, length);
+        }
+        else
+        {
+            stream.write(value, Width);
+        }
+    }
+
+    template <class Stream>
+    static void write(Stream& stream, char const* value, WriteMode const&)
+    {
+        write_chars(stream, value, std::char_traits<char>::length(value));
+    }
+
+    template <class Stream>
+    static void write(Stream& stream, std::string const& value,
+        WriteMode const&)
+    {
+        write_chars(stream, value.data(), value.size());
+    }
+};
+
+
+// Count values, starting at argument Arg, written by a data edit descriptor.
+// The range is split in halves to keep the instantiation depth logarithmic.
+template <class Item, size_t Arg, size_t Count>
+struct WriteValues
+{
+    template <class Tuple, class Stream>
+    static void write(Stream& stream, Tuple const& args,
+        WriteMode const& mode)
+    {
+        WriteValues<Item, Arg, Count / 2>::write(stream, args, mode);
+        WriteValues<Item, Arg + Count / 2, Count - Count / 2>::write(stream,
+            args, mode);
+    }
+};
+
+
+template <class Item, size_t Arg>
+struct WriteValues<Item, Arg, 1>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream& stream, Tuple const& args,
+        WriteMode const& mode)
+    {
+        WriteValue<Item>::write(stream, std::get<Arg>(args), mode);
+    }
+};
+
+
+template <class Item, size_t Arg>
+struct WriteValues<Item, Arg, 0>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream&, Tuple const&, WriteMode const&)
+    {
+    }
+};
+
+
+template <class Item, size_t Arg>
+struct WriteItem;
+
+
+template <size_t Arg, class Tuple, class Stream>
+void write_list(Stream&, ItemList<>, Tuple const&, WriteMode&)
+{
+}
+
+
+template <size_t Arg, class Item, class... Items, class Tuple, class Stream>
+void write_list(Stream& stream, ItemList<Item, Items...>,
+    Tuple const& args, WriteMode& mode)
+{
+    WriteItem<Item, Arg>::write(stream, args, mode);
+    write_list<Arg + ArgCount<Item>::value>(stream, ItemList<Items...>(),
+        args, mode);
+}
+
+
+template <FormatOp Op, unsigned int Repeat, unsigned int Width,
+    unsigned int Digits, unsigned int Exponent, size_t Arg>
+struct WriteItem<Descriptor<Op, Repeat, Width, Digits, Exponent>, Arg>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream& stream, Tuple const& args,
+        WriteMode& mode)
+    {
+        WriteValues<Descriptor<Op, Repeat, Width, Digits, Exponent>, Arg,
+            Repeat>::write(stream, args, mode);
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent, size_t Arg>
+struct WriteItem<Descriptor<FOP_X, Repeat, Width, Digits, Exponent>, Arg>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream& stream, Tuple const&, WriteMode&)
+    {
+        for (size_t pos = 0; pos < Repeat; ++pos)
+        {
+            stream.put(' ');
+        }
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent, size_t Arg>
+struct WriteItem<Descriptor<FOP_NL, Repeat, Width, Digits, Exponent>, Arg>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream& stream, Tuple const&, WriteMode&)
+    {
+        for (size_t pos = 0; pos < Repeat; ++pos)
+        {
+            stream.put('\n');
+        }
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent, size_t Arg>
+struct WriteItem<Descriptor<FOP_SP, Repeat, Width, Digits, Exponent>, Arg>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream&, Tuple const&, WriteMode& mode)
+    {
+        mode.plus_sign = true;
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent, size_t Arg>
+struct WriteItem<Descriptor<FOP_SS, Repeat, Width, Digits, Exponent>, Arg>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream&, Tuple const&, WriteMode& mode)
+    {
+        mode.plus_sign = false;
+    }
+};
+
+
+template <int Scale, size_t Arg>
+struct WriteItem<ScaleFactor<Scale>, Arg>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream&, Tuple const&, WriteMode& mode)
+    {
+        mode.scale = Scale;
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent, size_t Arg>
+struct WriteItem<Descriptor<FOP_BN, Repeat, Width, Digits, Exponent>, Arg>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream&, Tuple const&, WriteMode&)
+    {
+    }
+};
+
+
+template <unsigned int Repeat, unsigned int Width, unsigned int Digits,
+    unsigned int Exponent, size_t Arg>
+struct WriteItem<Descriptor<FOP_BZ, Repeat, Width, Digits, Exponent>, Arg>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream&, Tuple const&, WriteMode&)
+    {
+    }
+};
+
+
+template <class S, size_t First, size_t Last, char Quote, size_t Arg>
+struct WriteItem<Literal<S, First, Last, Quote>, Arg>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream& stream, Tuple const&, WriteMode&)
+    {
+        char const* const str = S::str();
+        if (!has_escapes<S>(First, Last, Quote))
+        {
+            stream.write(str + First, Last - First);
+        }
+        else
+        {
+            for (size_t pos = First; pos < Last; ++pos)
+            {
+                stream.put(str[pos]);
+                if (str[pos] == Quote)
+                {
+                    // skip the doubled quotation mark
+                    ++pos;
+                }
+            }
+        }
+    }
+};
+
+
+// Count repetitions of a group, starting at argument Arg
+template <class List, size_t Arg, size_t Count>
+struct WriteGroup
+{
+    template <class Tuple, class Stream>
+    static void write(Stream& stream, Tuple const& args,
+        WriteMode& mode)
+    {
+        size_t const HALF = Count / 2;
+        WriteGroup<List, Arg, HALF>::write(stream, args, mode);
+        WriteGroup<List, Arg + HALF * ListArgCount<List>::value,
+            Count - HALF>::write(stream, args, mode);
+    }
+};
+
+
+template <class List, size_t Arg>
+struct WriteGroup<List, Arg, 1>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream& stream, Tuple const& args,
+        WriteMode& mode)
+    {
+        write_list<Arg>(stream, List(), args, mode);
+    }
+};
+
+
+template <class List, size_t Arg>
+struct WriteGroup<List, Arg, 0>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream&, Tuple const&, WriteMode&)
+    {
+    }
+};
+
+
+template <unsigned int Repeat, class List, size_t Arg>
+struct WriteItem<Group<Repeat, List>, Arg>
+{
+    template <class Tuple, class Stream>
+    static void write(Stream& stream, Tuple const& args,
+        WriteMode& mode)
+    {
+        WriteGroup<List, Arg, Repeat>::write(stream, args, mode);
+    }
+};
+
+} // namespace static_format
+
+
+// A format string parsed at compile time, see FORTRAN_FMT
+template <class S>
+class StaticFormat
+{
+public:
+    typedef typename static_format::ParseFormat<S>::type Items;
+
+    // writes a record to the stream, like printfor
+    template <class... Args>
+    void write(std::ostream& stream, Args const&... args) const
+    {
+        this->write_record(stream, args...);
+    }
+
+    // appends a record to the sink
+    template <class... Args>
+    void write(FormatSink& sink, Args const&... args) const
+    {
+        this->write_record(sink, args...);
+    }
+
+private:
+    template <class Stream, class... Args>
+    void write_record(Stream& stream, Args const&... args) const
+    {
+        static_assert(
+            static_format::ListArgCount<Items>::value == sizeof...(Args),
+            "the number of arguments doesn't match the format string");
+
+        std::tuple<Args const&...> const tuple(args...);
+        static_format::WriteMode mode;
+        static_format::write_list<0>(stream, Items(), tuple, mode);
+        stream.put('\n');
+    }
+};
+
+
+// Compile-time format from a format string literal
+#define FORTRAN_FMT(formatstr) \
+    ([]() \
+    { \
+        struct Source \
+        { \
+            static constexpr char const* str() { return formatstr; } \
+            static constexpr char at(size_t const pos) \
+            { \
+                return pos < sizeof(formatstr) ? str()[pos] : '\0'; \
+            } \
+        }; \
+        return StaticFormat<Source>(); \
+    }())
+
+
+template <class S, class... Args>
+void printfor(StaticFormat<S> const& format, Args const&... args)
+{
+    format.write(std::cout, args...);
+}
+
+
+template <class S, class... Args>
+void printfor(std::ostream& stream, StaticFormat<S> const& format,
+    Args const&... args)
+{
+    format.write(stream, args...);
+}
+
+
+template <class S, class... Args>
+void printfor(FormatSink& sink, StaticFormat<S> const& format,
+    Args const&... args)
+{
+    format.write(sink, args...);
+}
+
+
+#if __cplusplus >= 202002L
+
+// format string literal usable as a template argument
+template <size_t N>
+struct FormatLiteral
+{
+    char value[N];
+
+    constexpr FormatLiteral(char const (&str)[N])
+    {
+        for (size_t n = 0; n < N; ++n)
+        {
+            value[n] = str[n];
+        }
+    }
+};
+
+
+template <FormatLiteral Format>
+struct LiteralSource
+{
+    static constexpr char const* str() { return Format.value; }
+    static constexpr char at(size_t const pos)
+    {
+        return pos < sizeof(Format.value) ? Format.value[pos] : '\0';
+    }
+};
+
+
+template <class... Args>
+struct FirstIsStream : std::false_type
+{
+};
+
+
+template <class T, class... Args>
+struct FirstIsStream<T, Args...>
+    : std::integral_constant<bool, std::is_base_of<std::ostream, T>::value ||
+        std::is_base_of<FormatSink, T>::value>
+{
+};
+
+
+template <FormatLiteral Format, class... Args>
+    requires (!FirstIsStream<Args...>::value)
+void printfor(Args const&... args)
+{
+    StaticFormat<LiteralSource<Format> >().write(std::cout, args...);
+}
+
+
+template <FormatLiteral Format, class... Args>
+void printfor(std::ostream& stream, Args const&... args)
+{
+    StaticFormat<LiteralSource<Format> >().write(stream, args...);
+}
+
+
+template <FormatLiteral Format, class... Args>
+void printfor(FormatSink& sink, Args const&... args)
+{
+    StaticFormat<LiteralSource<Format> >().write(sink, args...);
+}
+
+#endif
+
+#endif
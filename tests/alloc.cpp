@@ -0,0 +1,320 @@
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <fortranformat.hpp>
+#include "acutest.h"
+
+
+// Heap allocations of the formatting hot path: every edit descriptor,
+// from a compiled format to a caller buffer, a sink and a stream, must take
+// none once warmed up. malloc and friends are interposed where the C
+// library allows it (glibc), and operator new everywhere.
+
+void test_counting();
+void test_integer_descriptors();
+void test_real_descriptors();
+void test_other_descriptors();
+void test_format_control();
+void test_list_directed();
+void test_printfor();
+void test_captures();
+
+
+TEST_LIST = {
+    { "counting", test_counting },
+    { "integer_descriptors", test_integer_descriptors },
+    { "real_descriptors", test_real_descriptors },
+    { "other_descriptors", test_other_descriptors },
+    { "format_control", test_format_control },
+    { "list_directed", test_list_directed },
+    { "printfor", test_printfor },
+    { "captures", test_captures },
+    {0}
+};
+
+
+//
+// Counting allocations
+//
+
+std::atomic<size_t> heap_allocations(0);
+
+
+inline void count_allocation()
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* memory, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+
+
+extern "C" void* malloc(size_t size)
+{
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+    count_allocation();
+    return __libc_calloc(count, size);
+}
+
+
+extern "C" void* realloc(void* memory, size_t size)
+{
+    count_allocation();
+    return __libc_realloc(memory, size);
+}
+
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+    count_allocation();
+    return __libc_memalign(alignment, size);
+}
+#endif
+
+
+// counted by malloc where it's interposed (not inlined, which would pair
+// new expressions with free)
+__attribute__((noinline)) void* operator new(size_t size)
+{
+#ifndef __GLIBC__
+    count_allocation();
+#endif
+    void* const memory = malloc(size > 0 ? size : 1);
+    if (NULL == memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+
+__attribute__((noinline)) void operator delete(void* memory, size_t)
+    noexcept
+{
+    free(memory);
+}
+
+
+// Heap allocations of calls to write after a first one, which may set up
+// caches and buffers
+template <class Write>
+size_t steady_allocations(Write write)
+{
+    write();
+    size_t const before = heap_allocations.load();
+    for (int n = 0; n < 100; ++n)
+    {
+        write();
+    }
+    return heap_allocations.load() - before;
+}
+
+
+// sink discarding what it's given
+class NullSink : public FormatSink
+{
+public:
+    NullSink() : FormatSink(4096) {}
+
+protected:
+    void write_out(char const*, size_t) {}
+};
+
+
+// stream buffer discarding what it's given
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) { return c; }
+    std::streamsize xsputn(char const*, std::streamsize n) { return n; }
+};
+
+
+// Checks that writing a record with a compiled format to a buffer, a sink
+// and a stream takes no allocations; returns the record
+template <class... Args>
+std::string check_format(char const* formatstr, Args const&... args)
+{
+    FortranFormat const format(formatstr);
+    char buffer[512];
+    NullSink sink;
+    NullBuffer null;
+    std::ostream stream(&null);
+
+    size_t length = 0;
+    size_t const to_buffer = steady_allocations([&]() {
+        length = format.write_to_buffer(buffer, sizeof(buffer), args...);
+    });
+    size_t const to_sink = steady_allocations([&]() {
+        format.write(sink, args...);
+    });
+    size_t const to_stream = steady_allocations([&]() {
+        format.write(stream, args...);
+    });
+    TEST_CHECK(0 == to_buffer && 0 == to_sink && 0 == to_stream);
+    TEST_MSG("%s: %zu, %zu and %zu allocations", formatstr, to_buffer,
+        to_sink, to_stream);
+    return std::string(buffer, length);
+}
+
+
+// allocations are seen at all, by new and by malloc
+void test_counting()
+{
+    size_t const allocations = steady_allocations([]() {
+        std::vector<int>* const vector = new std::vector<int>(1000);
+        delete vector;
+        void* const memory = malloc(10);
+        free(memory);
+    });
+#ifdef __GLIBC__
+    TEST_CHECK(allocations == 300);
+#else
+    TEST_CHECK(allocations == 200);
+#endif
+    TEST_MSG("%zu allocations", allocations);
+}
+
+
+//
+// Edit descriptors
+//
+
+void test_integer_descriptors()
+{
+    check_format("(I5)", 42);
+    check_format("(I8.6)", -42);
+    check_format("(3I4)", 1, -2, 3);
+    check_format("(I21)", -9223372036854775807LL);
+    check_format("(I20)", 18446744073709551615ULL);
+    check_format("(I2)", 123456);
+    check_format("(SP, I5, SS, I5)", 7, 7);
+}
+
+
+void test_real_descriptors()
+{
+    check_format("(F10.3)", 3.14159);
+    check_format("(F8.2)", -0.005);
+    check_format("(F40.30)", 1.0 / 3);
+    check_format("(F5.1)", 12345.6);
+    check_format("(E12.4)", 2.7545E-12);
+    check_format("(E15.5E4)", -1.5E300);
+    check_format("(D12.4)", 6.02E23);
+    check_format("(G12.4)", 0.25);
+    check_format("(G12.4E3)", 1.5E-20);
+    // scaled, not just parsed
+    TEST_CHECK(check_format("(2P, F10.3, E12.4)", 1.5, 1.5) ==
+        "   150.000  15.000E-01");
+    TEST_CHECK(check_format("(-1P, E12.4)", 1.5) == "  0.0150E+02");
+    check_format("(F10.3, E12.4)", 1.0 / 0.0, -0.0 / 0.0);
+    check_format("(F12.5)", 2.5f);
+    check_format("(F250.200)", 0.1);
+}
+
+
+void test_other_descriptors()
+{
+    std::string const text(300, 'x');
+    check_format("(L3, L1)", true, false);
+    check_format("(A)", "a string");
+    check_format("(A5, A12)", "truncated string", "padded");
+    check_format("(A)", text);
+    check_format("(A400)", text);
+    check_format("(I3, 5X, I3)", 1, 2);
+    check_format("('literal', 1X, 7Hconst. , I2)", 3);
+    check_format("('it''s', \"a \"\"b\"\"\")");
+}
+
+
+void test_format_control()
+{
+    std::vector<double> const values(40, 2.5);
+    std::array<int, 7> const integers = {{ 1, 2, 3, 4, 5, 6, 7 }};
+    check_format("(I3 / I3 // I3)", 1, 2, 3);
+    check_format("(2(I3, 1X, F6.2), A)", 1, 1.5, 2, 2.5, "end");
+    check_format("(I3, 2(1X, F6.2))", 1, 1.5, 2.5, 2, 3.5);
+    check_format("(6E15.7)", values);
+    check_format("(3I4)", integers);
+    check_format("(BN, I3, BZ, I3)", 1, 2);
+}
+
+
+void test_list_directed()
+{
+    std::vector<double> const values = { 1.5, -2.25E-30, 1E100 };
+    check_format("*", 1, 2.5, "text", true, 3.5f, 9223372036854775807LL);
+    check_format("*", values, "and", "strings");
+}
+
+
+//
+// Beyond compiled formats
+//
+
+void test_printfor()
+{
+    // formats cached on first use
+    char buffer[128];
+    NullSink sink;
+    size_t const to_buffer = steady_allocations([&]() {
+        printfor_to_buffer(buffer, sizeof(buffer), "(I5, F8.3, 1X, A)", 1,
+            2.5, "text");
+    });
+    size_t const to_sink = steady_allocations([&]() {
+        printfor(sink, "(I5, F8.3, 1X, A)", 1, 2.5, "text");
+    });
+    TEST_CHECK(0 == to_buffer);
+    TEST_CHECK(0 == to_sink);
+}
+
+
+void test_captures()
+{
+    // records captured into an arena, formatted and reset batch after batch;
+    // the format in an arena of its own, which outlives the batches
+    FormatArena formats;
+    FortranFormat const format("(I8, 1X, A, 3E16.7E3)", formats);
+    FormatArena arena(1 << 16);
+    std::vector<double> const values = { 3.1416, -2.5, 2.7545E-12 };
+    std::string const name("a station name, not a short one");
+    std::vector<FormatRecord> batch;
+    batch.reserve(100);
+    NullSink sink;
+    size_t const captured = steady_allocations([&]() {
+        for (int n = 0; n < 100; ++n)
+        {
+            batch.push_back(capture_record(arena, format, n, name, values));
+        }
+        for (size_t r = 0; r < batch.size(); ++r)
+        {
+            format.write_args(sink, batch[r].args, batch[r].count);
+        }
+        batch.clear();
+        arena.reset();
+    });
+    TEST_CHECK(0 == captured);
+}
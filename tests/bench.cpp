@@ -0,0 +1,1708 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <fortranformat.hpp>
+#include <fortranformat_static.hpp>
+
+
+// heap allocations of the whole program, counted by the replaced operator
+// new (not inlined, which would pair new expressions with free)
+std::atomic<size_t> heap_allocations(0);
+
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* const memory = malloc(size > 0 ? size : 1);
+    if (NULL == memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+
+__attribute__((noinline)) void operator delete(void* memory, size_t) 
+    noexcept
+{
+    free(memory);
+}
+
+
+// stream buffer that discards everything written to it
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) { return c; }
+    std::streamsize xsputn(char const*, std::streamsize n) { return n; }
+};
+
+
+size_t const RECORDS = 200000;
+
+char const* const SHORT_FORMAT = "(I3, SP, 2(1X, F5.2), 2X, SS, G9.3E3)";
+char const* const LONG_FORMAT =
+    "(  I3 ,   SP ,  2 ( 1X  ,   F5.2  )  ,  2X  ,  SS ,   G9.3E3  ,"
+    "   'a rather long character string literal, repeated ''once'' ',"
+    "   40HHollerith constants are scanned as well., 1X  )";
+
+
+double elapsed_ns(std::chrono::steady_clock::time_point const start)
+{
+    std::chrono::steady_clock::duration const elapsed =
+        std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count();
+}
+
+
+//
+// Results
+//
+// Every measurement printed is also recorded, under the group of benchmarks
+// running, for the JSON report of --json.
+//
+
+struct BenchMetric
+{
+    char const* key;
+    double value;
+};
+
+
+struct BenchResult
+{
+    std::string group;
+    std::string name;
+    std::string label;
+    std::vector<std::pair<std::string, double> > metrics;
+};
+
+
+std::vector<BenchResult> bench_results;
+char const* bench_group = "";
+
+
+void record_result(char const* name, char const* label, 
+    std::initializer_list<BenchMetric> metrics)
+{
+    BenchResult result;
+    result.group = bench_group;
+    result.name = name;
+    result.label = label;
+    for (BenchMetric const& metric : metrics)
+    {
+        result.metrics.push_back(std::make_pair(std::string(metric.key), 
+            metric.value));
+    }
+    bench_results.push_back(result);
+}
+
+
+void write_json_string(FILE* const out, std::string const& text)
+{
+    fputc('"', out);
+    for (size_t n = 0; n < text.size(); ++n)
+    {
+        unsigned char const c = text[n];
+        if ('"' == c || '\\' == c)
+        {
+            fprintf(out, "\\%c", c);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(out, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+
+// the results, with what they depend on
+bool write_json(char const* const path)
+{
+    FILE* const out = fopen(path, "w");
+    if (NULL == out)
+    {
+        return false;
+    }
+    fprintf(out, "{\n  \"compiler\": ");
+    write_json_string(out, __VERSION__);
+    fprintf(out, ",\n  \"cplusplus\": %ld,\n", __cplusplus);
+    fprintf(out, "  \"hardware_threads\": %u,\n", 
+        std::thread::hardware_concurrency());
+    fprintf(out, "  \"results\": [");
+    for (size_t r = 0; r < bench_results.size(); ++r)
+    {
+        BenchResult const& result = bench_results[r];
+        fprintf(out, "%s\n    {\"group\": ", r > 0 ? "," : "");
+        write_json_string(out, result.group);
+        fprintf(out, ", \"name\": ");
+        write_json_string(out, result.name);
+        fprintf(out, ", \"label\": ");
+        write_json_string(out, result.label);
+        for (size_t m = 0; m < result.metrics.size(); ++m)
+        {
+            fprintf(out, ", ");
+            write_json_string(out, result.metrics[m].first);
+            fprintf(out, ": %.6g", result.metrics[m].second);
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+    return 0 == fclose(out);
+}
+
+
+void report(char const* name, char const* formatstr, double const ns)
+{
+    printf("%-16s %-6s %10.1f ns/record\n", name, formatstr, ns / RECORDS);
+    record_result(name, formatstr, {{ "ns_per_record", ns / RECORDS }});
+}
+
+
+void bench_format(char const* label, char const* formatstr)
+{
+    NullBuffer buffer;
+    std::ostream stream(&buffer);
+
+    // parse on every record
+    size_t const capacity = format_cache_capacity();
+    set_format_cache_capacity(0);
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        printfor(stream, formatstr, 10, 3.1416, 3.333, 2.7545E-12);
+    }
+    report("printfor/nocache", label, elapsed_ns(start));
+    set_format_cache_capacity(capacity);
+
+    // parse once, looked up in the cache
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        printfor(stream, formatstr, 10, 3.1416, 3.333, 2.7545E-12);
+    }
+    report("printfor", label, elapsed_ns(start));
+
+    // parse once
+    start = std::chrono::steady_clock::now();
+    FortranFormat format(formatstr);
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        format.write(stream, 10, 3.1416, 3.333, 2.7545E-12);
+    }
+    report("FortranFormat", label, elapsed_ns(start));
+
+    // parse once, into a character buffer
+    char record[256];
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        format.write_to_buffer(record, sizeof(record), 
+            10, 3.1416, 3.333, 2.7545E-12);
+    }
+    report("write_to_buffer", label, elapsed_ns(start));
+}
+
+
+void bench_static_format()
+{
+    NullBuffer buffer;
+    std::ostream stream(&buffer);
+
+    // parsed at compile time
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        printfor(stream, FORTRAN_FMT("(I3, SP, 2(1X, F5.2), 2X, SS, G9.3E3)"),
+            10, 3.1416, 3.333, 2.7545E-12);
+    }
+    report("FORTRAN_FMT", "short", elapsed_ns(start));
+}
+
+
+size_t const REALS = 1000000;
+unsigned long long const POW10_9 = 1000000000ULL;
+
+
+// F, E and G edits of values spread over many magnitudes, against snprintf
+void bench_real()
+{
+    std::vector<double> values(1024);
+    unsigned long long state = 88172645463325252ULL;
+    for (size_t n = 0; n < values.size(); ++n)
+    {
+        // xorshift, mantissa in [1, 2) times 10^[-8, 8)
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        double const mantissa = 1.0 + (state >> 11) * (1.0 / 9007199254740992.0);
+        values[n] = mantissa * pow(10.0, static_cast<int>(state % 16) - 8);
+    }
+
+    char const* const formats[] = { "(F24.6)", "(E16.9)", "(G16.9)", "(F24.17)" };
+    char const* const labels[] = { "F24.6", "E16.9", "G16.9", "F24.17" };
+    char record[64];
+    double checksum = 0;
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f)
+    {
+        FortranFormat const format(formats[f]);
+        std::chrono::steady_clock::time_point const start =
+            std::chrono::steady_clock::now();
+        for (size_t n = 0; n < REALS; ++n)
+        {
+            checksum += format.write_to_buffer(record, sizeof(record), 
+                values[n % values.size()]);
+        }
+        double const ns = elapsed_ns(start) / REALS;
+        printf("%-16s %-6s %10.1f ns/value\n", "FortranFormat", labels[f], ns);
+        record_result("FortranFormat", labels[f], {{ "ns_per_value", ns }});
+    }
+
+    char const* const conversions[] = { "%24.6f", "%16.8e", "%16.9g", "%24.17f" };
+    for (size_t f = 0; f < sizeof(conversions) / sizeof(conversions[0]); ++f)
+    {
+        std::chrono::steady_clock::time_point const start =
+            std::chrono::steady_clock::now();
+        for (size_t n = 0; n < REALS; ++n)
+        {
+            checksum += snprintf(record, sizeof(record), conversions[f], 
+                values[n % values.size()]);
+        }
+        double const ns = elapsed_ns(start) / REALS;
+        printf("%-16s %-6s %10.1f ns/value\n", "snprintf", labels[f], ns);
+        record_result("snprintf", labels[f], {{ "ns_per_value", ns }});
+    }
+    if (checksum == 0)
+    {
+        printf("no output\n");
+    }
+}
+
+
+// integer table rows, against snprintf
+void bench_integer()
+{
+    long long values[1024];
+    unsigned long long state = 88172645463325252ULL;
+    for (size_t n = 0; n < 1024; ++n)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        // up to 9 digits, either sign
+        values[n] = static_cast<long long>(state % POW10_9) * 
+            ((state >> 40) % 2 == 0 ? 1 : -1) / (1 + (state >> 50) % 1000);
+    }
+
+    FortranFormat const format("(8I12)");
+    char record[128];
+    double checksum = 0;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (size_t n = 0; n < REALS; n = n + 8)
+    {
+        long long const* const row = values + n % 1024;
+        checksum += format.write_to_buffer(record, sizeof(record), row[0], 
+            row[1], row[2], row[3], row[4], row[5], row[6], row[7]);
+    }
+    double ns = elapsed_ns(start) / REALS;
+    printf("%-16s %-6s %10.1f ns/value\n", "FortranFormat", "I12", ns);
+    record_result("FortranFormat", "I12", {{ "ns_per_value", ns }});
+
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < REALS; n = n + 8)
+    {
+        long long const* const row = values + n % 1024;
+        checksum += snprintf(record, sizeof(record), 
+            "%12lld%12lld%12lld%12lld%12lld%12lld%12lld%12lld", row[0], 
+            row[1], row[2], row[3], row[4], row[5], row[6], row[7]);
+    }
+    ns = elapsed_ns(start) / REALS;
+    printf("%-16s %-6s %10.1f ns/value\n", "snprintf", "I12", ns);
+    record_result("snprintf", "I12", {{ "ns_per_value", ns }});
+    if (checksum == 0)
+    {
+        printf("no output\n");
+    }
+}
+
+
+// a million-element array in one call, against a call per record
+void bench_array()
+{
+    NullBuffer buffer;
+    std::ostream stream(&buffer);
+
+    std::vector<double> values(REALS);
+    for (size_t n = 0; n < REALS; ++n)
+    {
+        values[n] = static_cast<double>(n) / 8.0;
+    }
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (size_t n = 0; n < REALS; n = n + 5)
+    {
+        printfor(stream, "(5F12.3)", values[n], values[n + 1], values[n + 2], 
+            values[n + 3], values[n + 4]);
+    }
+    double ns = elapsed_ns(start) / REALS;
+    printf("%-16s %-6s %10.1f ns/value\n", "printfor/record", "5F12.3", ns);
+    record_result("printfor/record", "5F12.3", {{ "ns_per_value", ns }});
+
+    start = std::chrono::steady_clock::now();
+    printfor(stream, "(5F12.3)", values);
+    ns = elapsed_ns(start) / REALS;
+    printf("%-16s %-6s %10.1f ns/value\n", "printfor/array", "5F12.3", ns);
+    record_result("printfor/array", "5F12.3", {{ "ns_per_value", ns }});
+}
+
+
+//
+// Edit descriptors
+//
+// Each case writes records of a format to a buffer, values taken in turn 
+// from tables of varied values, timing batches of records: it reports the
+// time per field of the fastest of three runs, the output throughput, and 
+// the percentiles of the time per record over the batches of all runs. The
+// snprintf and iostream cases write the nearest C and C++ conversions.
+//
+
+size_t const CASE_RECORDS = 100000;
+size_t const CASE_BATCH = 16;
+size_t const CASE_RUNS = 3;
+size_t const CASE_VALUES = 1024;
+
+
+// stream buffer that counts the characters written to it
+class CountingBuffer : public std::streambuf
+{
+public:
+    CountingBuffer() : count(0) {}
+
+    size_t count;
+
+protected:
+    int overflow(int c)
+    {
+        this->count = this->count + 1;
+        return c;
+    }
+
+    std::streamsize xsputn(char const*, std::streamsize n)
+    {
+        this->count = this->count + n;
+        return n;
+    }
+};
+
+
+// write(n) writes record n and returns its length
+template <class Write>
+void bench_case(char const* name, char const* label, size_t const fields, 
+    Write write)
+{
+    for (size_t n = 0; n < CASE_VALUES; ++n)
+    {
+        write(n);
+    }
+
+    size_t const batches = CASE_RECORDS / CASE_BATCH;
+    std::vector<double> latencies;
+    latencies.reserve(batches * CASE_RUNS);
+    double fastest = 0;
+    size_t bytes = 0;
+    for (size_t run = 0; run < CASE_RUNS; ++run)
+    {
+        bytes = 0;
+        std::chrono::steady_clock::time_point const start =
+            std::chrono::steady_clock::now();
+        for (size_t b = 0; b < batches; ++b)
+        {
+            std::chrono::steady_clock::time_point const batch =
+                std::chrono::steady_clock::now();
+            for (size_t n = b * CASE_BATCH; n < (b + 1) * CASE_BATCH; ++n)
+            {
+                bytes = bytes + write(n);
+            }
+            latencies.push_back(elapsed_ns(batch) / CASE_BATCH);
+        }
+        double const ns = elapsed_ns(start);
+        if (0 == run || ns < fastest)
+        {
+            fastest = ns;
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double const per_field = fastest / (batches * CASE_BATCH * fields);
+    double const throughput = bytes / fastest * 1E3;
+    double const p50 = latencies[latencies.size() / 2];
+    double const p99 = latencies[latencies.size() * 99 / 100];
+    printf("%-16s %-6s %10.2f ns/field %8.1f MB/s %7.0f p50 %7.0f p99 ns\n",
+        name, label, per_field, throughput, p50, p99);
+    record_result(name, label, {{ "ns_per_field", per_field }, 
+        { "mb_per_s", throughput }, { "p50_ns", p50 }, { "p99_ns", p99 }});
+}
+
+
+void bench_descriptors()
+{
+    // integers of up to 9 digits, and reals over 16 orders of magnitude,
+    // either sign
+    std::vector<int> integers(CASE_VALUES);
+    std::vector<double> reals(CASE_VALUES);
+    unsigned long long state = 88172645463325252ULL;
+    for (size_t n = 0; n < CASE_VALUES; ++n)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        bool const negative = (state >> 40) % 2 != 0;
+        integers[n] = static_cast<int>(state % POW10_9 / 
+            (1 + (state >> 50) % 1000)) * (negative ? -1 : 1);
+        double const mantissa = 1.0 + (state >> 11) * (1.0 / 9007199254740992.0);
+        reals[n] = mantissa * pow(10.0, static_cast<int>(state % 16) - 8) * 
+            (negative ? -1 : 1);
+    }
+    char const* const names[] = { "x", "station", "a longer name", 
+        "twelve chars" };
+    std::vector<double> const row(reals.begin(), reals.begin() + 100);
+
+    char record[2048];
+    size_t const size = sizeof(record);
+    size_t const mask = CASE_VALUES - 1;
+
+    // one descriptor at a time
+    struct Case
+    {
+        char const* label;
+        char const* format;
+        // 'i'nteger, 'r'eal, 'l'ogical or 's'tring values
+        char kind;
+        size_t fields;
+    };
+    Case const cases[] = {
+        { "I8", "(8I8)", 'i', 8 },
+        { "I12.10", "(8I12.10)", 'i', 8 },
+        { "F12.4", "(8F12.4)", 'r', 8 },
+        { "F25.17", "(8F25.17)", 'r', 8 },
+        { "E15.7", "(8E15.7)", 'r', 8 },
+        { "E16.7E3", "(8E16.7E3)", 'r', 8 },
+        { "D15.7", "(8D15.7)", 'r', 8 },
+        { "G12.4", "(8G12.4)", 'r', 8 },
+        // scaled mantissas, and values scaled by a power of ten
+        { "2PE15.7", "(2P, 8E15.7)", 'r', 8 },
+        { "1PF16.4", "(1P, 8F16.4)", 'r', 8 },
+        { "SPF12.4", "(SP, 8F12.4)", 'r', 8 },
+        { "L2", "(8L2)", 'l', 8 },
+        { "A", "(8A)", 's', 8 },
+        { "A12", "(8A12)", 's', 8 },
+        { "X'lit'", "(8(2X, 'lit', I6))", 'i', 8 },
+        { "H", "(8(4Hval=, I6))", 'i', 8 },
+        { "/", "(8(I6, /))", 'i', 8 }
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c)
+    {
+        Case const& which = cases[c];
+        FortranFormat const format(which.format);
+        bench_case("FortranFormat", which.label, which.fields, 
+            [&](size_t n) -> size_t {
+                size_t const v = n * 8;
+                switch (which.kind)
+                {
+                case 'i':
+                    return format.write_to_buffer(record, size, 
+                        integers[v & mask], integers[(v + 1) & mask], 
+                        integers[(v + 2) & mask], integers[(v + 3) & mask],
+                        integers[(v + 4) & mask], integers[(v + 5) & mask],
+                        integers[(v + 6) & mask], integers[(v + 7) & mask]);
+                case 'r':
+                    return format.write_to_buffer(record, size, 
+                        reals[v & mask], reals[(v + 1) & mask], 
+                        reals[(v + 2) & mask], reals[(v + 3) & mask],
+                        reals[(v + 4) & mask], reals[(v + 5) & mask],
+                        reals[(v + 6) & mask], reals[(v + 7) & mask]);
+                case 'l':
+                    return format.write_to_buffer(record, size, 
+                        (v & 1) != 0, (v & 2) != 0, (v & 4) != 0, 
+                        (v & 8) != 0, (v & 16) != 0, (v & 32) != 0, 
+                        (v & 64) != 0, (v & 128) != 0);
+                default:
+                    return format.write_to_buffer(record, size, 
+                        names[n & 3], names[(n + 1) & 3], names[(n + 2) & 3],
+                        names[(n + 3) & 3], names[n & 3], 
+                        names[(n + 1) & 3], names[(n + 2) & 3], 
+                        names[(n + 3) & 3]);
+                }
+            });
+    }
+
+    // nested groups, large repeat counts, mixed and list-directed records
+    FortranFormat const nested("(2(I6, 2(1X, F8.3), 1X, 2(L1, 1X)), A)");
+    bench_case("FortranFormat", "nested", 11, [&](size_t n) -> size_t {
+        return nested.write_to_buffer(record, size, integers[n & mask], 
+            reals[n & mask], reals[(n + 1) & mask], true, false, 
+            integers[(n + 1) & mask], reals[(n + 2) & mask], 
+            reals[(n + 3) & mask], false, true, names[n & 3]);
+    });
+    FortranFormat const repeated("(100F8.3)");
+    bench_case("FortranFormat", "100F8.3", 100, [&](size_t) -> size_t {
+        return repeated.write_to_buffer(record, size, row);
+    });
+    FortranFormat const mixed(SHORT_FORMAT);
+    bench_case("FortranFormat", "mixed", 4, [&](size_t n) -> size_t {
+        return mixed.write_to_buffer(record, size, integers[n & mask] % 1000,
+            reals[n & mask], reals[(n + 1) & mask], reals[(n + 2) & mask]);
+    });
+    FortranFormat const list("*");
+    bench_case("FortranFormat", "list", 4, [&](size_t n) -> size_t {
+        return list.write_to_buffer(record, size, integers[n & mask], 
+            reals[n & mask], names[n & 3], true);
+    });
+
+    // the nearest C conversions
+    char const* const conversions[] = { "%8d", "%12.4f", "%15.7E", "%12.4G", 
+        "%12s" };
+    char const* const labels[] = { "I8", "F12.4", "E15.7", "G12.4", "A12" };
+    for (size_t c = 0; c < 5; ++c)
+    {
+        char const* const conversion = conversions[c];
+        bench_case("snprintf", labels[c], 8, [&](size_t n) -> size_t {
+            size_t length = 0;
+            for (size_t f = 0; f < 8; ++f)
+            {
+                size_t const v = (n * 8 + f) & mask;
+                int const written = 0 == c ? 
+                    snprintf(record + length, size - length, conversion, 
+                        integers[v]) :
+                    4 == c ? 
+                    snprintf(record + length, size - length, conversion, 
+                        names[v & 3]) :
+                    snprintf(record + length, size - length, conversion, 
+                        reals[v]);
+                length = length + written;
+            }
+            return length;
+        });
+    }
+    bench_case("snprintf", "mixed", 4, [&](size_t n) -> size_t {
+        return snprintf(record, size, "%3d %+5.2f %+5.2f  %9.3E", 
+            integers[n & mask] % 1000, reals[n & mask], 
+            reals[(n + 1) & mask], reals[(n + 2) & mask]);
+    });
+
+    // and iostream manipulators
+    CountingBuffer counted;
+    std::ostream stream(&counted);
+    bench_case("iostream", "I8", 8, [&](size_t n) -> size_t {
+        size_t const before = counted.count;
+        for (size_t f = 0; f < 8; ++f)
+        {
+            stream << std::setw(8) << integers[(n * 8 + f) & mask];
+        }
+        return counted.count - before;
+    });
+    bench_case("iostream", "F12.4", 8, [&](size_t n) -> size_t {
+        size_t const before = counted.count;
+        stream << std::fixed << std::setprecision(4);
+        for (size_t f = 0; f < 8; ++f)
+        {
+            stream << std::setw(12) << reals[(n * 8 + f) & mask];
+        }
+        return counted.count - before;
+    });
+    bench_case("iostream", "E15.7", 8, [&](size_t n) -> size_t {
+        size_t const before = counted.count;
+        stream << std::scientific << std::uppercase << std::setprecision(7);
+        for (size_t f = 0; f < 8; ++f)
+        {
+            stream << std::setw(15) << reals[(n * 8 + f) & mask];
+        }
+        return counted.count - before;
+    });
+    bench_case("iostream", "mixed", 4, [&](size_t n) -> size_t {
+        size_t const before = counted.count;
+        stream << std::setw(3) << integers[n & mask] % 1000 << std::showpos
+            << std::fixed << std::setprecision(2) << ' ' << std::setw(5) 
+            << reals[n & mask] << ' ' << std::setw(5) 
+            << reals[(n + 1) & mask] << std::noshowpos << "  " 
+            << std::scientific << std::setprecision(3) << std::setw(9) 
+            << reals[(n + 2) & mask];
+        return counted.count - before;
+    });
+}
+
+struct IntegerField
+{
+    unsigned long long magnitude;
+    bool negative;
+    bool valid;
+};
+
+enum IntegerDecoder
+{
+    INTEGER_DECODER_SCALAR,
+    INTEGER_DECODER_SSE41
+};
+
+bool integer_decoder_supported(IntegerDecoder const);
+void decode_integer_fields(IntegerDecoder const, char const* const, 
+    char const* const, char const* const, size_t const, size_t const, 
+    bool const, IntegerField* const);
+
+
+enum NewlineScanner
+{
+    NEWLINE_SCANNER_SCALAR,
+    NEWLINE_SCANNER_SSE2,
+    NEWLINE_SCANNER_AVX2
+};
+
+bool newline_scanner_supported(NewlineScanner const);
+size_t count_newlines(NewlineScanner const, char const* const, size_t const);
+void find_newlines(NewlineScanner const, char const* const, size_t const, 
+    size_t const, std::vector<size_t>*);
+
+
+size_t const INTEGER_FIELDS = 16000000;
+
+
+// Iw columns decoded by each decoder, against a loop skipping blanks and 
+// accumulating digits like the format scanner's integer()
+void bench_integer_fields()
+{
+    size_t const widths[] = { 8, 12 };
+    for (size_t w = 0; w < 2; ++w)
+    {
+        size_t const width = widths[w];
+        size_t const fields = 16384;
+        std::string text(fields * width, ' ');
+        unsigned long long state = 88172645463325252ULL;
+        for (size_t n = 0; n < fields; ++n)
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            char field[32];
+            snprintf(field, sizeof(field), "%*lld", static_cast<int>(width), 
+                static_cast<long long>(state % POW10_9) * 
+                ((state >> 40) % 2 == 0 ? 1 : -1) / (1 + (state >> 50) % 1000));
+            memcpy(&text[n * width], field, width);
+        }
+        char const* const begin = text.data();
+        char label[8];
+        snprintf(label, sizeof(label), "I%zu", width);
+
+        long long checksum = 0;
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        for (size_t n = 0; n < INTEGER_FIELDS; ++n)
+        {
+            char const* c = begin + (n % fields) * width;
+            char const* const end = c + width;
+            while (c < end && ' ' == *c)
+            {
+                ++c;
+            }
+            bool const negative = c < end && '-' == *c;
+            if (c < end && ('-' == *c || '+' == *c))
+            {
+                ++c;
+            }
+            long long value = 0;
+            while (c < end && *c >= '0' && *c <= '9')
+            {
+                value = value * 10 + (*c - '0');
+                ++c;
+            }
+            checksum += negative ? -value : value;
+        }
+        double ns = elapsed_ns(start) / INTEGER_FIELDS;
+        printf("%-16s %-6s %10.2f ns/field\n", "atoi loop", label, ns);
+        record_result("atoi loop", label, {{ "ns_per_field", ns }});
+
+        char const* const names[] = { "scalar", "SSE4.1" };
+        IntegerField decoded[16];
+        for (int decoder = INTEGER_DECODER_SCALAR; 
+            decoder <= INTEGER_DECODER_SSE41; ++decoder)
+        {
+            if (!integer_decoder_supported(
+                static_cast<IntegerDecoder>(decoder)))
+            {
+                continue;
+            }
+            start = std::chrono::steady_clock::now();
+            for (size_t n = 0; n < INTEGER_FIELDS; n = n + 16)
+            {
+                decode_integer_fields(static_cast<IntegerDecoder>(decoder), 
+                    begin, begin + text.size(), begin + (n % fields) * width, 
+                    width, 16, false, decoded);
+                for (size_t f = 0; f < 16; ++f)
+                {
+                    checksum += decoded[f].negative ? 
+                        -static_cast<long long>(decoded[f].magnitude) : 
+                        static_cast<long long>(decoded[f].magnitude);
+                }
+            }
+            ns = elapsed_ns(start) / INTEGER_FIELDS;
+            printf("%-16s %-6s %10.2f ns/field\n", names[decoder], label, ns);
+            record_result(names[decoder], label, {{ "ns_per_field", ns }});
+        }
+
+        // whole records through the reader
+        char formatstr[16];
+        snprintf(formatstr, sizeof(formatstr), "(16I%zu)", width);
+        FortranFormat const format(formatstr);
+        long long values[16];
+        FormatTarget targets[16];
+        for (size_t f = 0; f < 16; ++f)
+        {
+            targets[f] = make_format_target(&values[f]);
+        }
+        start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < INTEGER_FIELDS; n = n + 16)
+        {
+            format.read_args_from_buffer(begin + (n % fields) * width, 
+                16 * width, targets, 16);
+            checksum += values[0] + values[15];
+        }
+        ns = elapsed_ns(start) / INTEGER_FIELDS;
+        printf("%-16s %-6s %10.2f ns/field\n", "FortranFormat", label, ns);
+        record_result("FortranFormat", label, {{ "ns_per_field", ns }});
+        if (checksum == 0)
+        {
+            printf("no fields\n");
+        }
+    }
+}
+
+
+// sink that discards everything written to it
+class NullSink : public FormatSink
+{
+public:
+    NullSink() : FormatSink(1 << 16) {}
+
+protected:
+    void write_out(char const*, size_t) {}
+};
+
+
+size_t const PARALLEL_VALUES = 4000000;
+
+
+// (6E15.7) dump of a large array per number of threads
+void bench_parallel()
+{
+    std::vector<double> values(PARALLEL_VALUES);
+    for (size_t n = 0; n < values.size(); ++n)
+    {
+        values[n] = (n % 3 == 0 ? -1.0 : 1.0) * static_cast<double>(n) / 7.0;
+    }
+
+    FortranFormat const format("(6E15.7)");
+    unsigned int const cores = 
+        std::max(2u, std::thread::hardware_concurrency());
+    double single = 0;
+    for (unsigned int threads = 1; threads <= cores; threads = threads * 2)
+    {
+        NullSink sink;
+        std::chrono::steady_clock::time_point const start =
+            std::chrono::steady_clock::now();
+        format.write_parallel(sink, values, threads);
+        double const ns = elapsed_ns(start);
+        if (1 == threads)
+        {
+            single = ns;
+        }
+        char label[16];
+        snprintf(label, sizeof(label), "%u thr", threads);
+        printf("%-16s %-6s %10.1f ns/value %6.2fx\n", "write_parallel", label,
+            ns / PARALLEL_VALUES, single / ns);
+        record_result("write_parallel", label, {{ "ns_per_value", 
+            ns / PARALLEL_VALUES }, { "speedup", single / ns }});
+    }
+}
+
+
+// percentiles of the time taken by each call, measured one by one
+void report_latency(char const* name, std::vector<double>& ns)
+{
+    std::sort(ns.begin(), ns.end());
+    double const p50 = ns[ns.size() / 2];
+    double const p99 = ns[ns.size() * 99 / 100];
+    double const p999 = ns[ns.size() * 999 / 1000];
+    printf("%-16s %-6s %8.0f p50 %8.0f p99 %8.0f p999 ns\n", name, "log", 
+        p50, p99, p999);
+    record_result(name, "log", {{ "p50_ns", p50 }, { "p99_ns", p99 }, 
+        { "p999_ns", p999 }});
+}
+
+
+// producer-side latency of deferred formatting, against formatting the 
+// record on the calling thread
+void bench_logger()
+{
+    FortranFormat const format(SHORT_FORMAT);
+    std::vector<double> ns(RECORDS);
+    NullSink direct;
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        std::chrono::steady_clock::time_point const start =
+            std::chrono::steady_clock::now();
+        printfor(direct, SHORT_FORMAT, 10, 3.1416, 3.333, 2.7545E-12);
+        ns[n] = elapsed_ns(start);
+    }
+    report_latency("printfor", ns);
+
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        std::chrono::steady_clock::time_point const start =
+            std::chrono::steady_clock::now();
+        format.write(direct, 10, 3.1416, 3.333, 2.7545E-12);
+        ns[n] = elapsed_ns(start);
+    }
+    report_latency("FortranFormat", ns);
+
+    NullSink deferred;
+    FormatLogger logger(deferred, 1 << 24);
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        std::chrono::steady_clock::time_point const start =
+            std::chrono::steady_clock::now();
+        logger.log(format, 10, 3.1416, 3.333, 2.7545E-12);
+        ns[n] = elapsed_ns(start);
+    }
+    logger.flush();
+    report_latency("FormatLogger", ns);
+    if (logger.dropped() > 0)
+    {
+        printf("%llu records dropped\n", logger.dropped());
+    }
+}
+
+
+// records written by threads to a single sink, through a RecordQueue and 
+// with a mutex around printfor, per number of threads
+void bench_record_queue()
+{
+    FortranFormat const format(SHORT_FORMAT);
+    unsigned int const cores = 
+        std::max(2u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; threads <= cores; threads = threads * 2)
+    {
+        size_t const records = RECORDS / threads;
+        NullSink sink;
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        {
+            RecordQueue queue(sink);
+            std::vector<std::thread> producers;
+            for (unsigned int t = 0; t < threads; ++t)
+            {
+                producers.push_back(std::thread([&queue, &format, records]() {
+                    for (size_t n = 0; n < records; ++n)
+                    {
+                        queue.write(format, 10, 3.1416, 3.333, 2.7545E-12);
+                    }
+                }));
+            }
+            for (unsigned int t = 0; t < threads; ++t)
+            {
+                producers[t].join();
+            }
+        }
+        double const queued = elapsed_ns(start);
+
+        std::mutex mutex;
+        start = std::chrono::steady_clock::now();
+        std::vector<std::thread> producers;
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            producers.push_back(std::thread([&sink, &mutex, records]() {
+                for (size_t n = 0; n < records; ++n)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    printfor(sink, SHORT_FORMAT, 10, 3.1416, 3.333, 
+                        2.7545E-12);
+                }
+            }));
+        }
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            producers[t].join();
+        }
+        double const locked = elapsed_ns(start);
+
+        char label[16];
+        snprintf(label, sizeof(label), "%u thr", threads);
+        size_t const total = records * threads;
+        printf("%-16s %-6s %10.1f ns/record\n", "RecordQueue", label, 
+            queued / total);
+        printf("%-16s %-6s %10.1f ns/record\n", "mutex+printfor", label, 
+            locked / total);
+        record_result("RecordQueue", label, {{ "ns_per_record", 
+            queued / total }});
+        record_result("mutex+printfor", label, {{ "ns_per_record", 
+            locked / total }});
+    }
+}
+
+
+
+// records of mixed formats through the ordered pipeline, per number of
+// workers, against writing them one after another
+void bench_pipeline()
+{
+    FortranFormat const formats[] = {
+        FortranFormat(SHORT_FORMAT),
+        FortranFormat("(I8, 1X, A, 3E16.7E3)"),
+        FortranFormat("(4F14.6)")
+    };
+    std::string const name("station-0042");
+    unsigned int const cores = 
+        std::max(2u, std::thread::hardware_concurrency());
+
+    NullSink sink;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        double const x = n * 1.25E-3;
+        formats[0].write(sink, 10, x, 3.333, 2.7545E-12);
+        formats[1].write(sink, static_cast<int>(n), name, x, -x, 1 / (x + 1));
+        formats[2].write(sink, x, x * x, 3.1416, -2.5);
+    }
+    sink.flush();
+    double const ns = elapsed_ns(start);
+    printf("%-16s %-6s %10.1f ns/record\n", "sequential", "", 
+        ns / (3 * RECORDS));
+    record_result("sequential", "", {{ "ns_per_record", ns / (3 * RECORDS) }});
+
+    for (unsigned int threads = 1; threads <= cores; threads = threads * 2)
+    {
+        start = std::chrono::steady_clock::now();
+        {
+            FormatPipeline pipeline(sink, threads);
+            for (size_t n = 0; n < RECORDS; ++n)
+            {
+                double const x = n * 1.25E-3;
+                pipeline.submit(formats[0], 10, x, 3.333, 2.7545E-12);
+                pipeline.submit(formats[1], static_cast<int>(n), name, x, -x,
+                    1 / (x + 1));
+                pipeline.submit(formats[2], x, x * x, 3.1416, -2.5);
+            }
+        }
+        double const ns = elapsed_ns(start);
+
+        char label[16];
+        snprintf(label, sizeof(label), "%u thr", threads);
+        printf("%-16s %-6s %10.1f ns/record\n", "FormatPipeline", label, 
+            ns / (3 * RECORDS));
+        record_result("FormatPipeline", label, {{ "ns_per_record", 
+            ns / (3 * RECORDS) }});
+    }
+}
+
+size_t const ARENA_BATCH = 1000;
+
+
+void report_allocations(char const* name, char const* label, double const ns,
+    size_t const allocations, size_t const records)
+{
+    printf("%-16s %-6s %10.1f ns/record %6.2f allocations/record\n", name, 
+        label, ns / records, static_cast<double>(allocations) / records);
+    record_result(name, label, {{ "ns_per_record", ns / records }, 
+        { "allocations_per_record", 
+            static_cast<double>(allocations) / records }});
+}
+
+
+// Batches of records captured and formatted later, into an arena reset per
+// batch and into copies on the heap, with the heap allocations per record 
+// once the first batch has set the arena up; and formats compiled into an 
+// arena and on the heap.
+void bench_arena()
+{
+    FormatArena formats;
+    FortranFormat const format("(I8, 1X, A, 3E16.7E3)", formats);
+    std::string const name("a station name, not a short one");
+    std::vector<double> const values = { 3.1416, -2.5, 2.7545E-12 };
+    NullSink sink;
+    size_t const batches = RECORDS / ARENA_BATCH;
+
+    FormatArena arena(1 << 16);
+    std::vector<FormatRecord> captured;
+    captured.reserve(ARENA_BATCH);
+    size_t allocations = 0;
+    std::chrono::steady_clock::time_point start;
+    for (size_t batch = 0; batch <= batches; ++batch)
+    {
+        if (1 == batch)
+        {
+            allocations = heap_allocations.load();
+            start = std::chrono::steady_clock::now();
+        }
+        for (size_t n = 0; n < ARENA_BATCH; ++n)
+        {
+            captured.push_back(capture_record(arena, format, 
+                static_cast<int>(n), name, values));
+        }
+        for (size_t r = 0; r < captured.size(); ++r)
+        {
+            format.write_args(sink, captured[r].args, captured[r].count);
+        }
+        captured.clear();
+        arena.reset();
+    }
+    double ns = elapsed_ns(start);
+    allocations = heap_allocations.load() - allocations;
+    report_allocations("FormatArena", "batch", ns, allocations, 
+        batches * ARENA_BATCH);
+
+    // the strings copied, and the arguments in a vector of their own
+    std::vector<std::string> strings;
+    std::vector<std::vector<FormatArg> > records;
+    allocations = heap_allocations.load();
+    start = std::chrono::steady_clock::now();
+    for (size_t batch = 0; batch < batches; ++batch)
+    {
+        for (size_t n = 0; n < ARENA_BATCH; ++n)
+        {
+            strings.push_back(name);
+            std::vector<FormatArg> args;
+            args.push_back(make_format_arg(static_cast<int>(n)));
+            args.push_back(make_format_arg(strings.back()));
+            for (size_t v = 0; v < values.size(); ++v)
+            {
+                args.push_back(make_format_arg(values[v]));
+            }
+            records.push_back(args);
+        }
+        for (size_t r = 0; r < records.size(); ++r)
+        {
+            FormatArg* const args = records[r].data();
+            args[1] = make_format_arg(strings[r]);
+            format.write_args(sink, args, records[r].size());
+        }
+        strings.clear();
+        records.clear();
+    }
+    ns = elapsed_ns(start);
+    allocations = heap_allocations.load() - allocations;
+    report_allocations("heap copies", "batch", ns, allocations, 
+        batches * ARENA_BATCH);
+
+    // compiling
+    FormatArena compiled(1 << 20);
+    allocations = heap_allocations.load();
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        FortranFormat const format(LONG_FORMAT, compiled);
+        if (compiled.used() > (1 << 19))
+        {
+            compiled.reset();
+        }
+    }
+    ns = elapsed_ns(start);
+    report_allocations("FormatArena", "long", ns, 
+        heap_allocations.load() - allocations, RECORDS);
+
+    allocations = heap_allocations.load();
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < RECORDS; ++n)
+    {
+        FortranFormat const format(LONG_FORMAT);
+    }
+    ns = elapsed_ns(start);
+    report_allocations("heap formats", "long", ns, 
+        heap_allocations.load() - allocations, RECORDS);
+}
+
+
+size_t const DUMP_RECORDS = 1000000;
+char const* const DUMP_FILE = "/dev/null";
+
+
+void report_dump(char const* name, size_t const bytes, double const ns)
+{
+    printf("%-16s %-6s %10.1f MB/s\n", name, "dump", bytes / ns * 1E3);
+    record_result(name, "dump", {{ "mb_per_s", bytes / ns * 1E3 }});
+}
+
+
+// million-record dump through a file descriptor sink, std::ofstream and
+// std::cout, all ending up in DUMP_FILE
+void bench_sink()
+{
+    FortranFormat const format(SHORT_FORMAT);
+    size_t const bytes = DUMP_RECORDS * 
+        (format.write_to_buffer(NULL, 0, 10, 3.1416, 3.333, 2.7545E-12) + 1);
+
+    int const fd = open(DUMP_FILE, O_WRONLY);
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    {
+        FdSink sink(fd);
+        for (size_t n = 0; n < DUMP_RECORDS; ++n)
+        {
+            format.write(sink, 10, 3.1416, 3.333, 2.7545E-12);
+        }
+    }
+    report_dump("FdSink", bytes, elapsed_ns(start));
+
+    std::ofstream file(DUMP_FILE);
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < DUMP_RECORDS; ++n)
+    {
+        format.write(file, 10, 3.1416, 3.333, 2.7545E-12);
+    }
+    file.flush();
+    report_dump("std::ofstream", bytes, elapsed_ns(start));
+
+    // standard output temporarily redirected
+    fflush(stdout);
+    int const saved = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < DUMP_RECORDS; ++n)
+    {
+        format.write(std::cout, 10, 3.1416, 3.333, 2.7545E-12);
+    }
+    std::cout.flush();
+    double const ns = elapsed_ns(start);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    close(fd);
+    report_dump("std::cout", bytes, ns);
+}
+
+
+// size of the generated input of bench_read, in megabytes
+size_t const DEFAULT_READ_MB = 64;
+
+
+void report_read(char const* name, size_t const bytes, size_t const fields, 
+    double const ns)
+{
+    printf("%-16s %-6s %10.1f MB/s %6.1f ns/field\n", name, "read", 
+        bytes / ns * 1E3, ns / fields);
+    record_result(name, "read", {{ "mb_per_s", bytes / ns * 1E3 }, 
+        { "ns_per_field", ns / fields }});
+}
+
+
+char const* const READ_FORMAT = "(I8, 3F12.4, E15.7)";
+
+
+// Records of READ_FORMAT, 60 characters each, to a total size taken from 
+// FORTRANFORMAT_BENCH_MB (set it to some thousands for a multi-gigabyte run)
+std::string read_input()
+{
+    size_t megabytes = DEFAULT_READ_MB;
+    char const* const env = getenv("FORTRANFORMAT_BENCH_MB");
+    if (env != NULL && atol(env) > 0)
+    {
+        megabytes = atol(env);
+    }
+
+    FortranFormat const format(READ_FORMAT);
+    std::string input;
+    input.reserve(megabytes << 20);
+    char record[128];
+    unsigned long long state = 88172645463325252ULL;
+    while (input.size() + sizeof(record) < (megabytes << 20))
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        double const x = static_cast<double>(state % 100000000) / 997.0;
+        size_t const len = format.write_to_buffer(record, sizeof(record), 
+            static_cast<long long>(state % 10000000), x, -x / 3.0, x * 7.0, 
+            x * 1E-9);
+        input.append(record, len);
+        input.push_back('\n');
+    }
+    return input;
+}
+
+
+// reading records of READ_FORMAT, against sscanf and strtoll/strtod on a 
+// copy of each field
+void bench_read()
+{
+    FortranFormat const format(READ_FORMAT);
+    std::string const input = read_input();
+    char record[128];
+    size_t const records = input.size() / 60;
+    size_t const fields = records * 5;
+
+    long long i = 0;
+    double a = 0, b = 0, c = 0, d = 0;
+    double checksum = 0;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    char const* pos = input.data();
+    char const* const end = input.data() + input.size();
+    while (pos < end)
+    {
+        size_t consumed = 0;
+        FormatTarget const targets[] = { make_format_target(&i), 
+            make_format_target(&a), make_format_target(&b), 
+            make_format_target(&c), make_format_target(&d) };
+        format.read_args_from_buffer(pos, end - pos, targets, 5, &consumed);
+        pos = pos + consumed;
+        checksum += i + a + b + c + d;
+    }
+    report_read("FortranFormat", input.size(), fields, elapsed_ns(start));
+
+    // the fields are separated by blanks: list-directed input reads them
+    FortranFormat const list("*");
+    start = std::chrono::steady_clock::now();
+    pos = input.data();
+    while (pos < end)
+    {
+        size_t consumed = 0;
+        FormatTarget const targets[] = { make_format_target(&i), 
+            make_format_target(&a), make_format_target(&b), 
+            make_format_target(&c), make_format_target(&d) };
+        list.read_args_from_buffer(pos, end - pos, targets, 5, &consumed);
+        pos = pos + consumed;
+        checksum += i + a + b + c + d;
+    }
+    report_read("list-directed", input.size(), fields, elapsed_ns(start));
+
+    start = std::chrono::steady_clock::now();
+    pos = input.data();
+    while (pos < end)
+    {
+        // a record at a time, as from fgets (sscanf takes the length of the
+        // whole string on each call)
+        char const* const newline = static_cast<char const*>(
+            memchr(pos, '\n', end - pos));
+        size_t const len = newline - pos;
+        memcpy(record, pos, len);
+        record[len] = '\0';
+        sscanf(record, "%lld%lf%lf%lf%lf", &i, &a, &b, &c, &d);
+        pos = newline + 1;
+        checksum += i + a + b + c + d;
+    }
+    report_read("sscanf", input.size(), fields, elapsed_ns(start));
+
+    // fields copied out of their columns, as they can't be told apart 
+    // otherwise
+    size_t const widths[] = { 8, 12, 12, 12, 15 };
+    start = std::chrono::steady_clock::now();
+    pos = input.data();
+    while (pos < end)
+    {
+        char field[16];
+        memcpy(field, pos, widths[0]);
+        field[widths[0]] = '\0';
+        i = strtoll(field, NULL, 10);
+        pos = pos + widths[0];
+        double* const reals[] = { &a, &b, &c, &d };
+        for (size_t n = 0; n < 4; ++n)
+        {
+            memcpy(field, pos, widths[n + 1]);
+            field[widths[n + 1]] = '\0';
+            *reals[n] = strtod(field, NULL);
+            pos = pos + widths[n + 1];
+        }
+        pos = pos + 1;
+        checksum += i + a + b + c + d;
+    }
+    report_read("strtod", input.size(), fields, elapsed_ns(start));
+
+    if (checksum == 0)
+    {
+        printf("no input\n");
+    }
+}
+
+
+// full-precision reals, 17 significant digits over the whole double range,
+// against strtod on a copy of each field
+void bench_read_reals()
+{
+    FortranFormat const format("(4E26.17E3)");
+    size_t const records = 250000;
+    std::string input;
+    input.reserve(records * 105);
+    char record[128];
+    std::mt19937_64 random(14);
+    for (size_t n = 0; n < records; ++n)
+    {
+        double values[4];
+        for (size_t v = 0; v < 4; ++v)
+        {
+            // finite values only
+            unsigned long long const bits = random() & ~(1ULL << 62);
+            memcpy(&values[v], &bits, sizeof(values[v]));
+        }
+        size_t const len = format.write_to_buffer(record, sizeof(record), 
+            values[0], values[1], values[2], values[3]);
+        input.append(record, len);
+        input.push_back('\n');
+    }
+
+    double a = 0, b = 0, c = 0, d = 0;
+    double checksum = 0;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    char const* pos = input.data();
+    char const* const end = input.data() + input.size();
+    while (pos < end)
+    {
+        size_t consumed = 0;
+        FormatTarget const targets[] = { make_format_target(&a), 
+            make_format_target(&b), make_format_target(&c), 
+            make_format_target(&d) };
+        format.read_args_from_buffer(pos, end - pos, targets, 4, &consumed);
+        pos = pos + consumed;
+        checksum += a + b + c + d;
+    }
+    report_read("E26.17E3", input.size(), records * 4, elapsed_ns(start));
+
+    start = std::chrono::steady_clock::now();
+    pos = input.data();
+    while (pos < end)
+    {
+        char field[32];
+        double* const reals[] = { &a, &b, &c, &d };
+        for (size_t n = 0; n < 4; ++n)
+        {
+            memcpy(field, pos, 26);
+            field[26] = '\0';
+            *reals[n] = strtod(field, NULL);
+            pos = pos + 26;
+        }
+        pos = pos + 1;
+        checksum += a + b + c + d;
+    }
+    report_read("strtod", input.size(), records * 4, elapsed_ns(start));
+
+    if (checksum == 0)
+    {
+        printf("no input\n");
+    }
+}
+
+
+// a memory-mapped file of READ_FORMAT records read into columns, per number
+// of threads
+void bench_read_file()
+{
+    char path[] = "/tmp/fortranformat_bench_XXXXXX";
+    int const fd = mkstemp(path);
+    if (fd < 0)
+    {
+        printf("no temporary file\n");
+        return;
+    }
+    std::string const input = read_input();
+    bool const written = write(fd, input.data(), input.size()) == 
+        static_cast<ssize_t>(input.size());
+    close(fd);
+
+    FortranFormat const format(READ_FORMAT);
+    MappedFile const file(path);
+    unlink(path);
+    if (!written || file.error() != 0)
+    {
+        printf("no mapped file\n");
+        return;
+    }
+
+    size_t const records = format.count_records(file.data(), file.size());
+    std::vector<long long> ids(records);
+    std::vector<double> a(records), b(records), c(records), d(records);
+    FormatTarget const columns[] = { make_format_target(&ids[0]), 
+        make_format_target(&a[0]), make_format_target(&b[0]), 
+        make_format_target(&c[0]), make_format_target(&d[0]) };
+
+    unsigned int const cores = 
+        std::max(2u, std::thread::hardware_concurrency());
+    double single = 0;
+    for (unsigned int threads = 1; threads <= cores; threads = threads * 2)
+    {
+        std::chrono::steady_clock::time_point const start =
+            std::chrono::steady_clock::now();
+        size_t const read = format.read_columns(file.data(), file.size(), 
+            columns, 5, records, threads);
+        double const ns = elapsed_ns(start);
+        if (1 == threads)
+        {
+            single = ns;
+        }
+        char label[16];
+        snprintf(label, sizeof(label), "%u thr", threads);
+        printf("%-16s %-6s %10.2f GB/s %6.2fx%s\n", "read_columns", label,
+            file.size() / ns, single / ns, read == records ? "" : " (failed)");
+        record_result("read_columns", label, {{ "gb_per_s", 
+            file.size() / ns }, { "speedup", single / ns }});
+    }
+
+    // into empty vectors, counting the records and sizing the columns too
+    {
+        std::vector<long long> ids_out;
+        std::vector<double> a_out, b_out, c_out, d_out;
+        std::chrono::steady_clock::time_point const start =
+            std::chrono::steady_clock::now();
+        FormatColumn const vectors[] = { make_format_column(ids_out), 
+            make_format_column(a_out), make_format_column(b_out), 
+            make_format_column(c_out), make_format_column(d_out) };
+        size_t const read = format.read_vectors(file.data(), file.size(), 
+            vectors, 5, cores);
+        double const ns = elapsed_ns(start);
+        printf("%-16s %-6s %10.2f GB/s%s\n", "read_vectors", "cores", 
+            file.size() / ns, read == records ? "" : " (failed)");
+        record_result("read_vectors", "cores", {{ "gb_per_s", 
+            file.size() / ns }});
+    }
+
+    std::atomic<size_t> count(0);
+    std::chrono::steady_clock::time_point const start =
+        std::chrono::steady_clock::now();
+    format.read_parallel(file.data(), file.size(), 
+        [&count](size_t, FormatArg const*, size_t) { ++count; }, cores);
+    double const ns = elapsed_ns(start);
+    printf("%-16s %-6s %10.2f GB/s\n", "read_parallel", "cores", 
+        file.size() / ns);
+    record_result("read_parallel", "cores", {{ "gb_per_s", file.size() / ns }});
+}
+
+
+// new lines of READ_FORMAT records found and counted by each scanner, and
+// reading into columns from the input against from its index
+void bench_record_index()
+{
+    std::string const input = read_input();
+    char const* const names[] = { "scalar", "SSE2", "AVX2" };
+    std::vector<size_t> starts;
+    for (int scanner = NEWLINE_SCANNER_SCALAR; 
+        scanner <= NEWLINE_SCANNER_AVX2; ++scanner)
+    {
+        NewlineScanner const which = static_cast<NewlineScanner>(scanner);
+        if (!newline_scanner_supported(which))
+        {
+            continue;
+        }
+        starts.clear();
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        find_newlines(which, input.data(), input.size(), 0, &starts);
+        double const find = elapsed_ns(start);
+        start = std::chrono::steady_clock::now();
+        size_t const count = count_newlines(which, input.data(), 
+            input.size());
+        double const counted = elapsed_ns(start);
+        printf("%-16s %-6s %10.2f GB/s %6.2f GB/s counting%s\n", 
+            names[scanner], "index", input.size() / find, 
+            input.size() / counted, count == starts.size() ? "" : " (wrong)");
+        record_result(names[scanner], "index", {{ "gb_per_s", 
+            input.size() / find }, { "counting_gb_per_s", 
+            input.size() / counted }});
+    }
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    RecordIndex const index(input.data(), input.size());
+    double const built = elapsed_ns(start);
+    printf("%-16s %-6s %10.2f GB/s\n", "RecordIndex", "build", 
+        input.size() / built);
+    record_result("RecordIndex", "build", {{ "gb_per_s", 
+        input.size() / built }});
+
+    FortranFormat const format(READ_FORMAT);
+    size_t const records = format.count_records(index);
+    std::vector<long long> ids(records);
+    std::vector<double> a(records), b(records), c(records), d(records);
+    FormatTarget const columns[] = { make_format_target(&ids[0]), 
+        make_format_target(&a[0]), make_format_target(&b[0]), 
+        make_format_target(&c[0]), make_format_target(&d[0]) };
+    start = std::chrono::steady_clock::now();
+    format.read_columns(input.data(), input.size(), columns, 5, records, 1);
+    double const unindexed = elapsed_ns(start);
+    start = std::chrono::steady_clock::now();
+    size_t const read = format.read_columns(index, columns, 5, records, 1);
+    double const indexed = elapsed_ns(start);
+    printf("%-16s %-6s %10.2f GB/s %6.2f GB/s indexed%s\n", "read_columns",
+        "1 thr", input.size() / unindexed, input.size() / indexed, 
+        read == records ? "" : " (failed)");
+    record_result("read_columns", "1 thr", {{ "gb_per_s", 
+        input.size() / unindexed }, { "indexed_gb_per_s", 
+        input.size() / indexed }});
+}
+
+
+// a wide record of 40 fields, read whole into columns against a projection
+// of 4 of its fields, on a thread
+void bench_read_projection()
+{
+    FortranFormat const format("(20I8, 20F12.4)");
+    size_t const records = 100000;
+    std::string input;
+    input.reserve(records * 401);
+    char record[512];
+    for (size_t r = 0; r < records; ++r)
+    {
+        long long ids[20];
+        double values[20];
+        for (size_t n = 0; n < 20; ++n)
+        {
+            ids[n] = static_cast<long long>(r * 20 + n) % 9999999;
+            values[n] = (r * 20 + n) * 0.001;
+        }
+        size_t const len = format.write_to_buffer(record, sizeof(record), 
+            format_span(ids, 20), format_span(values, 20));
+        input.append(record, len);
+        input.push_back('\n');
+    }
+
+    std::vector<std::vector<long long> > integers(20, 
+        std::vector<long long>(records));
+    std::vector<std::vector<double> > reals(20, std::vector<double>(records));
+    std::vector<FormatTarget> targets;
+    for (size_t n = 0; n < 20; ++n)
+    {
+        targets.push_back(make_format_target(&integers[n][0]));
+    }
+    for (size_t n = 0; n < 20; ++n)
+    {
+        targets.push_back(make_format_target(&reals[n][0]));
+    }
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    size_t read = format.read_columns(input.data(), input.size(), 
+        &targets[0], 40, records, 1);
+    double const whole = elapsed_ns(start);
+    printf("%-16s %-6s %10.1f MB/s %6.1f ns/record%s\n", "40 of 40 fields", 
+        "read", input.size() / whole * 1E3, whole / records, 
+        read == records ? "" : " (failed)");
+    record_result("40 of 40 fields", "read", {{ "mb_per_s", 
+        input.size() / whole * 1E3 }, { "ns_per_record", whole / records }});
+
+    // two integer and two real columns
+    size_t const positions[] = { 3, 19, 25, 39 };
+    FormatProjection const projection(format, positions);
+    FormatTarget const columns[] = { targets[3], targets[19], targets[25], 
+        targets[39] };
+    start = std::chrono::steady_clock::now();
+    read = projection.read_columns(input.data(), input.size(), columns, 4, 
+        records, 1);
+    double const narrow = elapsed_ns(start);
+    printf("%-16s %-6s %10.1f MB/s %6.1f ns/record %5.1fx%s\n", 
+        "4 of 40 fields", "read", input.size() / narrow * 1E3, 
+        narrow / records, whole / narrow, read == records ? "" : " (failed)");
+    record_result("4 of 40 fields", "read", {{ "mb_per_s", 
+        input.size() / narrow * 1E3 }, { "ns_per_record", narrow / records },
+        { "speedup", whole / narrow }});
+}
+
+
+// benchmarks run by default, in this order
+struct BenchGroup
+{
+    char const* name;
+    void (*run)();
+};
+
+
+BenchGroup const BENCH_GROUPS[] = {
+    { "short", []() { bench_format("short", SHORT_FORMAT); } },
+    { "static", bench_static_format },
+    { "long", []() { bench_format("long", LONG_FORMAT); } },
+    { "list", []() { bench_format("list", "*"); } },
+    { "descriptors", bench_descriptors },
+    { "integer", bench_integer },
+    { "real", bench_real },
+    { "array", bench_array },
+    { "parallel", bench_parallel },
+    { "sink", bench_sink },
+    { "logger", bench_logger },
+    { "record_queue", bench_record_queue },
+    { "pipeline", bench_pipeline },
+    { "arena", bench_arena },
+    { "integer_fields", bench_integer_fields },
+    { "read", bench_read },
+    { "read_reals", bench_read_reals },
+    { "read_file", bench_read_file },
+    { "record_index", bench_record_index },
+    { "read_projection", bench_read_projection }
+};
+
+
+// bench.exe [--json FILE] [GROUP...]: the groups given, or all of them, 
+// with their results also written to FILE as JSON
+int main(int argc, char** argv)
+{
+    char const* json = NULL;
+    std::vector<char const*> only;
+    for (int a = 1; a < argc; ++a)
+    {
+        if (0 == strcmp(argv[a], "--json") && a + 1 < argc)
+        {
+            a = a + 1;
+            json = argv[a];
+        }
+        else
+        {
+            only.push_back(argv[a]);
+        }
+    }
+
+    for (BenchGroup const& group : BENCH_GROUPS)
+    {
+        bool run = only.empty();
+        for (size_t n = 0; n < only.size(); ++n)
+        {
+            run = run || 0 == strcmp(only[n], group.name);
+        }
+        if (run)
+        {
+            bench_group = group.name;
+            group.run();
+        }
+    }
+
+    if (json != NULL && !write_json(json))
+    {
+        fprintf(stderr, "%s: can't write the results\n", json);
+        return 1;
+    }
+    return 0;
+}
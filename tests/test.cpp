@@ -1,8 +1,20 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 #include <fortranformat.hpp>
+#include <fortranformat_static.hpp>
 #include "acutest.h"
 
 
@@ -18,6 +30,27 @@ void test_nonrepeat();
 void test_plus_sign();
 void test_format_float();
 void test_format_mixfloat();
+void test_compiled();
+void test_format_cache();
+void test_static_format();
+void test_typed_args();
+void test_buffer();
+void test_sink();
+void test_decimal();
+void test_array();
+void test_parallel();
+void test_read();
+void test_read_real();
+void test_read_parallel();
+void test_read_projection();
+void test_record_index();
+void test_integer_fields();
+void test_list_directed();
+void test_logger();
+void test_record_queue();
+void test_wide_fields();
+void test_arena();
+void test_format_pipeline();
 
 bool compare_strings(char const*, char const*);
 bool compare_strings(char const*, char const*, size_t const);
@@ -50,6 +83,27 @@ TEST_LIST = {
     { "format_plus_sign", test_plus_sign },
     { "format_float", test_format_float },
     { "format_mixfloat", test_format_mixfloat },
+    { "compiled", test_compiled },
+    { "format_cache", test_format_cache },
+    { "static_format", test_static_format },
+    { "typed_args", test_typed_args },
+    { "buffer", test_buffer },
+    { "sink", test_sink },
+    { "decimal", test_decimal },
+    { "array", test_array },
+    { "parallel", test_parallel },
+    { "read", test_read },
+    { "read_real", test_read_real },
+    { "read_parallel", test_read_parallel },
+    { "read_projection", test_read_projection },
+    { "record_index", test_record_index },
+    { "integer_fields", test_integer_fields },
+    { "list_directed", test_list_directed },
+    { "logger", test_logger },
+    { "record_queue", test_record_queue },
+    { "wide_fields", test_wide_fields },
+    { "arena", test_arena },
+    { "format_pipeline", test_format_pipeline },
     {0}
 };
 
@@ -58,15 +112,10 @@ TEST_LIST = {
 // fortranformat.cpp private functions
 //
 
-#include <cstdarg>
 #include <ostream>
 using std::ostream;
 
 
-void printfor(char const*, ...);
-
-void printfor(ostream&, char const*, ...);
-
 struct Scanner {
     const char* start;
     const char* current;
@@ -78,18 +127,45 @@ struct Scanner {
     }
 };
 
-void stream_printfor(ostream&, char const* const, va_list*);
-
-void format_i(char*, int const, size_t const, size_t const, bool const);
+void format_i(char*, long long const, size_t const, size_t const, 
+    bool const);
 void format_f(char*, double const, size_t const, size_t const, bool const);
 void format_g(char*, double const, size_t const, size_t const, size_t const, 
     bool const);
 void format_e(char*, double const, size_t const, size_t const, char const, 
     size_t const, bool const);
-size_t integer_str_length(unsigned int const);
-size_t frac_zeroes(double const);
-void write_integer(char*, double const, bool const, bool const);
-void extract_fractional_part(char*, double const, size_t const, bool const);
+size_t integer_str_length(unsigned long long const);
+void write_integer(char*, unsigned long long, size_t const);
+
+struct IntegerField
+{
+    unsigned long long magnitude;
+    bool negative;
+    bool valid;
+};
+
+enum IntegerDecoder
+{
+    INTEGER_DECODER_SCALAR,
+    INTEGER_DECODER_SSE41
+};
+
+bool integer_decoder_supported(IntegerDecoder const);
+void decode_integer_fields(IntegerDecoder const, char const* const, 
+    char const* const, char const* const, size_t const, size_t const, 
+    bool const, IntegerField* const);
+
+enum NewlineScanner
+{
+    NEWLINE_SCANNER_SCALAR,
+    NEWLINE_SCANNER_SSE2,
+    NEWLINE_SCANNER_AVX2
+};
+
+bool newline_scanner_supported(NewlineScanner const);
+size_t count_newlines(NewlineScanner const, char const* const, size_t const);
+void find_newlines(NewlineScanner const, char const* const, size_t const, 
+    size_t const, std::vector<size_t>*);
 
 
 //
@@ -144,80 +220,46 @@ void test_basic()
     std::cout << "  |" << cs << '\n';
 
 
-    // fractional part extraction
-    extract_fractional_part(cs, 3.14, 2, false);
-    TEST_CHECK(compare_strings(cs, "14"));
-    zerostr(cs);
-
-    extract_fractional_part(cs, 3.00, 2, false);
-    TEST_CHECK(compare_strings(cs, "00"));
-    zerostr(cs);
-
-    extract_fractional_part(cs,  4.00002, 5, false);
-    TEST_CHECK(compare_strings(cs, "00002"));
-    zerostr(cs);
-
-    // test fractional part rounding
-    extract_fractional_part(cs,  4.00005, 4, true);
-    TEST_CHECK(compare_strings(cs, "0001"));
-    zerostr(cs);
-
-    extract_fractional_part(cs,  5.000005, 5, true);
-    TEST_CHECK(compare_strings(cs, "00001"));
-    zerostr(cs);
-
-    extract_fractional_part(cs, 14.01004, 4, true);
-    TEST_CHECK(compare_strings(cs, "0100"));
-    zerostr(cs);
-
-    extract_fractional_part(cs, 14.01097, 4, true);
-    TEST_CHECK(compare_strings(cs, "0110"));
-    zerostr(cs);
-
     // integer character length
     TEST_CHECK(integer_str_length(0) == 1);
     TEST_CHECK(integer_str_length(11) == 2);
     TEST_CHECK(integer_str_length(100) == 3);
     TEST_CHECK(integer_str_length(1063) == 4);
     TEST_CHECK(integer_str_length(100000003) == 9);
+    TEST_CHECK(integer_str_length(9999999999ULL) == 10);
+    TEST_CHECK(integer_str_length(10000000000000000000ULL) == 20);
+    TEST_CHECK(integer_str_length(18446744073709551615ULL) == 20);
 
     // integer parts
-    write_integer(cs, 0.45, false, true);
+    write_integer(cs, 0, 1);
     TEST_CHECK(compare_strings(cs, "0", 1));
     zerostr(cs);
 
-    write_integer(cs, 11.3, false, true);
+    write_integer(cs, 11, 2);
     TEST_CHECK(compare_strings(cs, "11", 2));
     zerostr(cs);
 
-    write_integer(cs, 100.7003, false, true);
+    write_integer(cs, 100, 3);
     TEST_CHECK(compare_strings(cs, "100", 3));
     zerostr(cs);
 
-    write_integer(cs, 100.7003, true, true);
-    TEST_CHECK(compare_strings(cs, "101", 3));
+    // leading zeroes
+    write_integer(cs, 7, 3);
+    TEST_CHECK(compare_strings(cs, "007", 3));
     zerostr(cs);
 
-    write_integer(cs, 1063.0, false, true);
+    write_integer(cs, 1063, 4);
     TEST_CHECK(compare_strings(cs, "1063", 4));
     zerostr(cs);
 
-    write_integer(cs, 100000003.0004, false, true);
+    write_integer(cs, 100000003, 9);
     TEST_CHECK(compare_strings(cs, "100000003", 9));
     zerostr(cs);
 
-    // fractional zeroes
-    TEST_CHECK(frac_zeroes(2.0) == 0);
-    TEST_CHECK(frac_zeroes(0.3) == 0);
-    TEST_CHECK(frac_zeroes(0.02) == 1);
-    TEST_CHECK(frac_zeroes(0.004) == 2);
-    TEST_CHECK(frac_zeroes(-0.0005) == 3);
-    TEST_CHECK(frac_zeroes(0.00001) == 4);
-    TEST_CHECK(frac_zeroes(1.0E-08) == 7);
-    TEST_CHECK(frac_zeroes(1.0E-012) == 11);
-    TEST_CHECK(frac_zeroes(1.0E-150) == 149);
-    TEST_CHECK(frac_zeroes(1.0E+012) == 0);
-    TEST_CHECK(frac_zeroes(1.0E+150) == 0);
+    write_integer(cs, 18446744073709551615ULL, 20);
+    TEST_CHECK(compare_strings(cs, "18446744073709551615", 20));
+    zerostr(cs);
+
 }
 
 
@@ -263,6 +305,23 @@ void test_integer()
     format_i(cs, -23, 5, 3, false);
     TEST_CHECK(compare_strings(cs, " -023"));
     zerostr(cs);
+
+    // full 64-bit range
+    format_i(cs, -9223372036854775807LL - 1, 21, 0, false);
+    TEST_CHECK(compare_strings(cs, " -9223372036854775808"));
+    zerostr(cs);
+
+    std::ostringstream ss;
+    printfor(ss, "(SP, I22, I12.11)", 18446744073709551615ULL, 3000000000LL);
+    TEST_CHECK(compare_strings(ss.str().c_str(), 
+        " +18446744073709551615+03000000000"));
+    ss.str(std::string());
+
+    printfor(ss, FORTRAN_FMT("(I21, I11)"), 18446744073709551615ULL, 
+        -3000000000LL);
+    TEST_CHECK(compare_strings(ss.str().c_str(), 
+        " 18446744073709551615-3000000000"));
+    ss.str(std::string());
 }
 
 
@@ -625,6 +684,348 @@ void test_format_mixfloat()
 }
 
 
+void test_compiled()
+{
+    std::ostringstream ss;
+
+    FortranFormat format("(I3, SP, 2(1X, F5.2), 2X, SS, G9.3E3)");
+    TEST_CHECK(format.items().size() == 8);
+
+    // the same compiled format executed several times
+    for (size_t n = 0; n < 3; ++n)
+    {
+        format.write(ss, 10, 3.1416, 3.333, 2.7545E-12);
+        TEST_CHECK(compare_strings(ss.str().c_str(), " 10 +3.14 +3.33  .275E-011"));
+        ss.str(std::string());
+    }
+
+    // literals are unescaped when compiled
+    FortranFormat strings("('It''s', 1X, 3Habc, \"\"\"\", A)");
+    TEST_CHECK(strings.literals() == "It'sabc\"");
+    strings.write(ss, "!");
+    TEST_CHECK(compare_strings(ss.str().c_str(), "It's abc\"!"));
+    ss.str(std::string());
+
+    // nested groups and repeated new lines
+    FortranFormat nested("(2(I2, 2(1X, L1)), 2/, A)");
+    nested.write(ss, 1, true, false, 2, false, true, "end");
+    TEST_CHECK(compare_strings(ss.str().c_str(), " 1 T F 2 F T\n\nend"));
+    ss.str(std::string());
+
+    // no parenthesized format
+    FortranFormat empty("I3");
+    TEST_CHECK(empty.items().empty());
+}
+
+
+void test_format_cache()
+{
+    std::ostringstream ss;
+    FormatCacheStats before = format_cache_stats();
+
+    // first call compiles, the following ones hit the cache
+    for (size_t n = 0; n < 3; ++n)
+    {
+        printfor(ss, "(I4, ' cached')", 7);
+        TEST_CHECK(compare_strings(ss.str().c_str(), "   7 cached"));
+        ss.str(std::string());
+    }
+    FormatCacheStats after = format_cache_stats();
+    TEST_CHECK(after.misses - before.misses == 1);
+    TEST_CHECK(after.hits - before.hits == 2);
+
+    // same contents at another address
+    char formatstr[MAXLEN];
+    strcpy(formatstr, "(I4, ' cached')");
+    printfor(ss, formatstr, 8);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "   8 cached"));
+    ss.str(std::string());
+    before = after;
+    after = format_cache_stats();
+    TEST_CHECK(after.hits - before.hits == 1);
+
+    // same address with other contents
+    strcpy(formatstr, "(I2, ' changed')");
+    printfor(ss, formatstr, 9);
+    TEST_CHECK(compare_strings(ss.str().c_str(), " 9 changed"));
+    ss.str(std::string());
+    before = after;
+    after = format_cache_stats();
+    TEST_CHECK(after.misses - before.misses == 1);
+
+    // the same contents at ever new addresses, only the last few remembered
+    std::vector<std::string> copies(1000, std::string("(I3, ' copied')"));
+    for (size_t n = 0; n < copies.size(); ++n)
+    {
+        printfor(ss, copies[n].c_str(), 5);
+        TEST_CHECK(compare_strings(ss.str().c_str(), "  5 copied"));
+        ss.str(std::string());
+    }
+    before = after;
+    after = format_cache_stats();
+    TEST_CHECK(after.misses - before.misses == 1);
+    TEST_CHECK(after.hits - before.hits == copies.size() - 1);
+    TEST_CHECK(after.addresses - before.addresses <= 4);
+    TEST_MSG("%llu addresses", after.addresses - before.addresses);
+
+    // eviction
+    size_t const capacity = format_cache_capacity();
+    set_format_cache_capacity(1);
+    printfor(ss, "(I1, 'first')", 1);
+    printfor(ss, "(I1, 'second')", 2);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "1first\n2second"));
+    ss.str(std::string());
+    before = after;
+    after = format_cache_stats();
+    TEST_CHECK(after.evictions - before.evictions >= 2);
+
+    // disabled
+    set_format_cache_capacity(0);
+    printfor(ss, "(I1, 'uncached')", 3);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "3uncached"));
+    ss.str(std::string());
+    set_format_cache_capacity(capacity);
+
+    // concurrent writers, each thread with its own cache
+    size_t const THREADS = 4;
+    size_t const RECORDS = 500;
+    std::vector<std::string> outputs(THREADS);
+    std::vector<std::thread> threads;
+    before = format_cache_stats();
+    for (size_t t = 0; t < THREADS; ++t)
+    {
+        threads.push_back(std::thread([t, RECORDS, &outputs]()
+        {
+            std::ostringstream tss;
+            for (size_t n = 0; n < RECORDS; ++n)
+            {
+                printfor(tss, "(I2, 1X, F4.1)", static_cast<int>(t), 0.5);
+            }
+            outputs[t] = tss.str();
+        }));
+    }
+    for (size_t t = 0; t < THREADS; ++t)
+    {
+        threads[t].join();
+    }
+    after = format_cache_stats();
+    for (size_t t = 0; t < THREADS; ++t)
+    {
+        std::ostringstream expected;
+        for (size_t n = 0; n < RECORDS; ++n)
+        {
+            expected << ' ' << t << "  0.5\n";
+        }
+        TEST_CHECK(outputs[t] == expected.str());
+    }
+    TEST_CHECK(after.misses - before.misses == THREADS);
+    TEST_CHECK(after.hits - before.hits == THREADS * (RECORDS - 1));
+}
+
+
+void test_static_format()
+{
+    std::ostringstream ss;
+
+    printfor(ss, FORTRAN_FMT("(I3, SP, 2(1X, F5.2), 2X, SS, G9.3E3)"), 
+        10, 3.1416, 3.333, 2.7545E-12);
+    TEST_CHECK(compare_strings(ss.str().c_str(), " 10 +3.14 +3.33  .275E-011"));
+    ss.str(std::string());
+
+    printfor(ss, FORTRAN_FMT("(A, 2(I3, I3))"), "test: ", 1, 2, 3, 4);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "test:   1  2  3  4"));
+    ss.str(std::string());
+
+    // sign mode changing between group repetitions
+    printfor(ss, FORTRAN_FMT("(2(G10.3E3, SP), D10.4)"), 1.0, 2.0, 1.34567);
+    TEST_CHECK(compare_strings(ss.str().c_str(), " 1.00     +2.00     +.1346D+01"));
+    ss.str(std::string());
+
+    // literals, logicals and strings
+    printfor(ss, FORTRAN_FMT("('It''s', 1X, 3Habc, L3, A4, \"\"\"\", A2)"), 
+        true, std::string("xy"), "abc");
+    TEST_CHECK(compare_strings(ss.str().c_str(), "It's abc  T  xy\"ab"));
+    ss.str(std::string());
+
+    // large repeat counts and new lines
+    printfor(ss, FORTRAN_FMT("(I1, 2/, 100(1X), 'x')"), 5);
+    TEST_CHECK(ss.str() == "5\n\n" + std::string(100, ' ') + "x\n");
+    ss.str(std::string());
+
+    // blank interpretation, nothing on output
+    printfor(ss, FORTRAN_FMT("(BN, I5, BZ, 2(I3, BN))"), 42, 7, 8);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "   42  7  8"));
+    ss.str(std::string());
+#if __cplusplus >= 202002L
+    printfor<"(BN, I5)">(ss, 42);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "   42"));
+    ss.str(std::string());
+#endif
+
+    // scale factors, alone or prefixing a descriptor, and kept by groups
+    printfor(ss, FORTRAN_FMT("(1PE12.4, 2P, F10.3, -1P, E12.4, 0P, F6.2)"),
+        1234.5, 1.5, 1.5, 1.5);
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        "  1.2345E+03   150.000  0.0150E+02  1.50"));
+    ss.str(std::string());
+    printfor(ss, FORTRAN_FMT("(2(E11.3, - 2 P), G11.3)"), 1.5, 1.5, 1E10);
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        "  0.150E+01  0.002E+03  0.001E+13"));
+    ss.str(std::string());
+#if __cplusplus >= 202002L
+    printfor<"(2P, F10.3)">(ss, 1.5);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "   150.000"));
+    ss.str(std::string());
+#endif
+
+    // the same output as the runtime formats
+    char const* const FORMATSTR = "(3(I3, 3X), F8.3, E12.4E3, G10.3)";
+    printfor(ss, FORMATSTR, 1, 2, 3, -3.14159, 12345.678, 0.5);
+    std::string const expected = ss.str();
+    ss.str(std::string());
+    printfor(ss, FORTRAN_FMT("(3(I3, 3X), F8.3, E12.4E3, G10.3)"), 
+        1, 2, 3, -3.14159, 12345.678, 0.5);
+    TEST_CHECK(ss.str() == expected);
+    ss.str(std::string());
+    printfor(ss, "(2(1PE12.4, F9.3), -1P, G12.4, D12.4)", 1.5, -2.5, 3E-5,
+        7.25, 1E10, -0.5);
+    std::string const scaled = ss.str();
+    ss.str(std::string());
+    printfor(ss, FORTRAN_FMT("(2(1PE12.4, F9.3), -1P, G12.4, D12.4)"), 1.5,
+        -2.5, 3E-5, 7.25, 1E10, -0.5);
+    TEST_CHECK(ss.str() == scaled);
+    ss.str(std::string());
+    // the largest scale factors, larger ones being compile errors
+    printfor(ss, FORTRAN_FMT("(65536P, F10.2, -65536P, F10.2, E10.2)"), 
+        5E-324, 1.7E308, 1.5);
+    TEST_CHECK(compare_strings(ss.str().c_str(), 
+        std::string(10, '*') + "      0.00" + std::string(10, '*')));
+    ss.str(std::string());
+}
+
+
+void test_typed_args()
+{
+    std::ostringstream ss;
+
+    // integers of any size and signedness
+    short const s = -12;
+    long const l = 123456L;
+    unsigned int const u = 7u;
+    long long const ll = -2000000000LL;
+    unsigned long long const ull = 42ULL;
+    printfor(ss, "(I4, I7, I2, I12, I3)", s, l, u, ll, ull);
+    TEST_CHECK(compare_strings(ss.str().c_str(), " -12 123456 7 -2000000000 42"));
+    ss.str(std::string());
+
+    // float is not promoted through variadic arguments anymore
+    float const f = 0.25f;
+    printfor(ss, "(F6.3, E10.3)", f, 1.5f);
+    TEST_CHECK(compare_strings(ss.str().c_str(), " 0.250 0.150E+01"));
+    ss.str(std::string());
+
+    // logicals
+    bool const b = true;
+    printfor(ss, "(2L2)", b, false);
+    TEST_CHECK(compare_strings(ss.str().c_str(), " T F"));
+    ss.str(std::string());
+
+    // strings
+    std::string const str("string");
+    char buffer[] = "buffer";
+    printfor(ss, "(A, 1X, A3, 1X, A8)", str, buffer, std::string("xy"));
+    TEST_CHECK(compare_strings(ss.str().c_str(), "string buf       xy"));
+    ss.str(std::string());
+
+#if __cplusplus >= 201703L
+    std::string_view const view("a view, not all of it", 6);
+    printfor(ss, "(A, '|', A8)", view, view);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "a view|  a view"));
+    ss.str(std::string());
+#endif
+
+    // already captured arguments
+    FormatArg const args[] = { make_format_arg(3), make_format_arg(2.5) };
+    vprintfor(ss, "(I2, F4.1)", args, 2);
+    TEST_CHECK(compare_strings(ss.str().c_str(), " 3 2.5"));
+    ss.str(std::string());
+
+    FortranFormat format("(I2, F4.1)");
+    format.write_args(ss, args, 2);
+    TEST_CHECK(compare_strings(ss.str().c_str(), " 3 2.5"));
+    ss.str(std::string());
+
+    // numbers convert to any numeric descriptor, other mismatches are
+    // written as asterisks
+    printfor(ss, "(I3, F5.1, L2)", 2.75, 7, 1);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "  2  7.0 T"));
+    ss.str(std::string());
+
+    printfor(ss, "(I5, '|', F6.2, '|', E10.3, '|', G9.2, '|', L2)", "text",
+        str, "x", "y", "z");
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        "*****|******|**********|*********|**"));
+    ss.str(std::string());
+
+    printfor(ss, "(A4, '|', A, '|', A3)", 42, 2.5, true);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "****|*|***"));
+    ss.str(std::string());
+
+    // the record goes on past a mismatch
+    printfor(ss, "(2(I3, 1X, A))", "one", 1, 2, "two");
+    TEST_CHECK(compare_strings(ss.str().c_str(), "*** *  2 two"));
+    ss.str(std::string());
+}
+
+
+void test_buffer()
+{
+    char cs[MAXLEN];
+    zerostr(cs);
+
+    // whole record, without new line
+    size_t len = printfor_to_buffer(cs, MAXLEN, 
+        "(I3, SP, 2(1X, F5.2), 2X, SS, G9.3E3)", 10, 3.1416, 3.333, 2.7545E-12);
+    TEST_CHECK(strcmp(cs, " 10 +3.14 +3.33  .275E-011") == 0);
+    TEST_CHECK(len == strlen(cs));
+
+    // records separated by /
+    len = printfor_to_buffer(cs, MAXLEN, "(A, /, A)", "first", "second");
+    TEST_CHECK(strcmp(cs, "first\nsecond") == 0);
+    TEST_CHECK(len == 12);
+
+    // exact fit, with the terminating NUL
+    len = printfor_to_buffer(cs, 7, "(I3, I3)", 1, 2);
+    TEST_CHECK(strcmp(cs, "  1  2") == 0);
+    TEST_CHECK(len == 6);
+
+    // truncated: only the fields that fit
+    len = printfor_to_buffer(cs, 6, "(I3, I3)", 1, 2);
+    TEST_CHECK(strcmp(cs, "  1") == 0);
+    TEST_CHECK(len == 6);
+
+    len = printfor_to_buffer(cs, 8, "('test', 2A4)", "ab", "cd");
+    TEST_CHECK(strcmp(cs, "test") == 0);
+    TEST_CHECK(len == 12);
+
+    // length only
+    len = printfor_to_buffer(NULL, 0, "(I3, A, F6.2)", 1, "abc", 2.0);
+    TEST_CHECK(len == 12);
+
+    // compiled format
+    FortranFormat format("(L2, E10.3)");
+    len = format.write_to_buffer(cs, MAXLEN, true, 1234.5);
+    TEST_CHECK(strcmp(cs, " T 0.123E+04") == 0);
+    TEST_CHECK(len == 12);
+
+    // records longer than the stream buffer
+    std::ostringstream ss;
+    std::string const longstr(5000, 'x');
+    printfor(ss, "(A, 2000X, A3)", longstr, "end");
+    TEST_CHECK(ss.str() == longstr + std::string(2000, ' ') + "end\n");
+}
+
+
 bool compare_strings(char const* str1, char const* str2)
 {
     char nstr1[MAXLEN];
@@ -727,3 +1128,1781 @@ void zerostr(char* str)
     str[len-1] = '\0';
 }
 
+
+// sink appending to a string, with every write out recorded
+class StringSink : public FormatSink
+{
+public:
+    explicit StringSink(size_t const capacity) 
+        : FormatSink(capacity), writes(0)
+    {
+    }
+
+    std::string str;
+    size_t writes;
+
+protected:
+    void write_out(char const* data, size_t size)
+    {
+        this->str.append(data, size);
+        this->writes = this->writes + 1;
+    }
+};
+
+
+void test_sink()
+{
+    // records stay in the buffer until flushed
+    StringSink sink(64);
+    printfor(sink, "(I3, SP, 2(1X, F5.2), 2X, SS, G9.3E3)", 
+        10, 3.1416, 3.333, 2.7545E-12);
+    printfor(sink, "(A, /, A)", "first", "second");
+    TEST_CHECK(sink.writes == 0);
+    TEST_CHECK(sink.size() == 40);
+    sink.flush();
+    TEST_CHECK(sink.writes == 1);
+    TEST_CHECK(sink.str == " 10 +3.14 +3.33  .275E-011\nfirst\nsecond\n");
+    sink.str.clear();
+
+    // many records through a small buffer
+    std::string expected;
+    FortranFormat format("(I5, 1X, L1)");
+    for (int n = 0; n < 100; ++n)
+    {
+        format.write(sink, n, n % 2 == 0);
+        expected += std::string(5 - std::to_string(n).size(), ' ') + 
+            std::to_string(n) + (n % 2 == 0 ? " T\n" : " F\n");
+    }
+    sink.flush();
+    TEST_CHECK(sink.str == expected);
+    TEST_CHECK(sink.writes > 1);
+    sink.str.clear();
+
+    // fields and strings wider than the buffer
+    std::string const wide(100, 'x');
+    printfor(sink, "(A, 1X, A101, I60)", wide, wide, 1);
+    sink.flush();
+    TEST_CHECK(sink.str == wide + " " + " " + wide + std::string(59, ' ') + 
+        "1\n");
+    sink.str.clear();
+
+    // compile-time formats
+    printfor(sink, FORTRAN_FMT("(I3, 1X, A)"), 7, "seven");
+    sink.flush();
+    TEST_CHECK(sink.str == "  7 seven\n");
+    sink.str.clear();
+
+#if __cplusplus >= 202002L
+    printfor<"(I3, 1X, A)">(sink, 8, "eight");
+    sink.flush();
+    TEST_CHECK(sink.str == "  8 eight\n");
+    sink.str.clear();
+#endif
+
+    // file descriptor
+    FILE* const file = tmpfile();
+    if (!TEST_CHECK(file != NULL))
+    {
+        return;
+    }
+    {
+        FdSink fdsink(fileno(file), 16);
+        for (int n = 0; n < 10; ++n)
+        {
+            printfor(fdsink, "(I4, F6.2)", n, n / 4.0);
+        }
+        printfor(fdsink, "(A)", wide);
+        fdsink.flush();
+        TEST_CHECK(fdsink.error() == 0);
+        printfor(fdsink, "('unflushed')");
+    }
+    rewind(file);
+    std::string contents;
+    char chunk[256];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        contents.append(chunk, read);
+    }
+    fclose(file);
+    TEST_CHECK(contents.compare(0, 22, "   0  0.00\n   1  0.25\n") == 0);
+    TEST_CHECK(contents.size() == 10 * 11 + 101 + 10);
+    TEST_CHECK(contents.compare(contents.size() - 10, 10, "unflushed\n") == 0);
+
+    // bad descriptor
+    FdSink badsink(-1, 16);
+    printfor(badsink, "(I4)", 1);
+    badsink.flush();
+    TEST_CHECK(badsink.error() == EBADF);
+}
+
+
+// Fw.d of value, without leading blanks, checked against printf
+bool check_fixed(double const value, size_t const precision)
+{
+    char expected[1500];
+    snprintf(expected, sizeof(expected), "%#.*f", static_cast<int>(precision), 
+        value);
+
+    char cs[1500];
+    size_t const width = strlen(expected) + 1;
+    format_f(cs, value, width, precision, false);
+    char const* const start = cs + strspn(cs, " ");
+    if (strcmp(start, expected) != 0)
+    {
+        TEST_MSG("F%zu.%zu of %.17g: %s, expected %s", width, precision, 
+            value, start, expected);
+        return false;
+    }
+    return true;
+}
+
+
+// Ew.dE3 of value, without leading blanks, checked against printf
+bool check_scientific(double const value, size_t const precision)
+{
+    char printed[1500];
+    snprintf(printed, sizeof(printed), "%.*e", 
+        static_cast<int>(precision) - 1, value);
+
+    // d.ddde+xx to 0.dddde+xxx
+    char const* const mantissa = printed + (printed[0] == '-');
+    char const* const exponent = strchr(printed, 'e') + 1;
+    std::string expected = printed[0] == '-' ? "-0." : "0.";
+    expected += mantissa[0];
+    if (precision > 1)
+    {
+        expected.append(mantissa + 2, exponent - 1);
+    }
+    int const point = atoi(exponent) + (value != 0.0);
+    char exponent_part[16];
+    snprintf(exponent_part, sizeof(exponent_part), "E%c%03d", 
+        point < 0 ? '-' : '+', abs(point));
+    expected += exponent_part;
+
+    char cs[1500];
+    size_t const width = expected.size() + 1;
+    format_e(cs, value, width, precision, EXPONENTIAL_E, 3, false);
+    char const* const start = cs + strspn(cs, " ");
+    if (expected != start)
+    {
+        TEST_MSG("E%zu.%zuE3 of %.17g: %s, expected %s", width, precision, 
+            value, start, expected.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+void test_decimal()
+{
+    char cs[MAXLEN];
+    zerostr(cs);
+
+    // integer parts beyond 2^31 and 2^64
+    format_f(cs, 3000000000.25, 13, 2, false);
+    TEST_CHECK(compare_strings(cs, "3000000000.25"));
+    format_f(cs, -1.0E+20, 24, 1, false);
+    TEST_CHECK(compare_strings(cs, "-100000000000000000000.0"));
+    format_f(cs, 1.0E+300, 20, 1, false);
+    TEST_CHECK(compare_strings(cs, "********************"));
+
+    // ties go to even, like printf, for exactly representable values
+    format_f(cs, 0.125, 5, 2, false);
+    TEST_CHECK(compare_strings(cs, " 0.12"));
+    format_f(cs, 0.375, 5, 2, false);
+    TEST_CHECK(compare_strings(cs, " 0.38"));
+    format_f(cs, 2.5, 3, 0, false);
+    TEST_CHECK(compare_strings(cs, " 2."));
+    format_e(cs, 1.125E+00, 10, 3, EXPONENTIAL_E, 2, false);
+    TEST_CHECK(compare_strings(cs, " 0.112E+01"));
+
+    // rounding up to the next power of ten
+    format_e(cs, 9.9996, 10, 4, EXPONENTIAL_E, 2, false);
+    TEST_CHECK(compare_strings(cs, "0.1000E+02"));
+    format_g(cs, 9.9996, 10, 3, 2, false);
+    TEST_CHECK(compare_strings(cs, "  10.0    "));
+    format_g(cs, 0.099996, 10, 3, 2, false);
+    TEST_CHECK(compare_strings(cs, " 0.100    "));
+    format_g(cs, 999.6, 10, 3, 2, false);
+    TEST_CHECK(compare_strings(cs, " 0.100E+04"));
+
+    // zero
+    format_e(cs, 0.0, 10, 3, EXPONENTIAL_E, 2, false);
+    TEST_CHECK(compare_strings(cs, " 0.000E+00"));
+    format_g(cs, 0.0, 10, 3, 2, false);
+    TEST_CHECK(compare_strings(cs, "  0.00    "));
+
+    // extremes
+    format_e(cs, 4.9406564584124654E-324, 12, 5, EXPONENTIAL_E, 3, false);
+    TEST_CHECK(compare_strings(cs, "0.49407E-323"));
+    format_e(cs, -1.7976931348623157E+308, 16, 8, EXPONENTIAL_D, 3, false);
+    TEST_CHECK(compare_strings(cs, "-0.17976931D+309"));
+
+    // exponents past 99: +zzz without Ee, asterisks when they don't fit Ee
+    std::ostringstream ss;
+    printfor(ss, "(E12.4, '|', E9.4, '|', D12.4, '|', G12.4)", 1E100, 1E100,
+        -1E-150, 2.5E200);
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        "  0.1000+101|.1000+101| -0.1000-149|  0.2500+201"));
+    ss.str(std::string());
+    printfor(ss, "(E10.3E1, '|', E12.4E2, '|', G10.3E1, '|', D12.4)", 1E10,
+        1E100, 1E10, 1E-101);
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        "**********|************|**********|  0.1000-100"));
+    ss.str(std::string());
+    printfor(ss, "(E10.3E1, '|', E12.4, '|', G12.4, '|', G12.4E3)", 1E8,
+        1E98, 1E-99, 1E100);
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        "  0.100E+9|  0.1000E+99|  0.1000E-98| 0.1000E+101"));
+    ss.str(std::string());
+    printfor(ss, FORTRAN_FMT("(E12.4, '|', E10.3E1)"), 1E100, 1E10);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "  0.1000+101|**********"));
+    ss.str(std::string());
+
+    // scale factors: F times 10^k, k digits before the point of E and D 
+    // (d + 1 significant ones), -k zeroes after it for k < 0 (d + k ones)
+    printfor(ss, "(1PE12.4)", 1234.5);
+    TEST_CHECK(compare_strings(ss.str().c_str(), "  1.2345E+03"));
+    ss.str(std::string());
+    printfor(ss, "(2P, F10.3, E12.4, 1X, -2P, F8.3, D12.4)", 1.5, 1.5, 
+        1234.5, -1.5);
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        "   150.000  15.000E-01   12.345 -0.0015D+03"));
+    ss.str(std::string());
+    // rounding to d + 1 digits, zero, exponents past 99
+    printfor(ss, "(1P, 4E12.4)", 9.99996, -0.0012345, 0.0, 1E100);
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        "  1.0000E+01 -1.2345E-03  0.0000E+00  1.0000+100"));
+    ss.str(std::string());
+    // -d < k < d + 2, and exponents still checked against Ee
+    printfor(ss, "(5PE11.4, 6PE11.4, -4PE11.4, 1PE10.3E1)", 1.5, 1.5, 1.5, 
+        1E10);
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        " 15000.E-04" + std::string(32, '*')));
+    ss.str(std::string());
+    // G only scales its E editing, and kP lasts until the next one, over 
+    // groups and records
+    printfor(ss, "(1P, 2G12.4, 2(F6.1), 0P)", 0.5, 1E10, 1.5, 2.5, 3.5);
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        "  0.5000      1.0000E+10  15.0  25.0\n   3.5"));
+    ss.str(std::string());
+    // scale factors too large for any double, clamped
+    FortranFormat const huge("(2147483647P, F10.2, E10.2, -99999999999P, "
+        "F10.2, G10.2)");
+    TEST_CHECK(huge.items()[0].scale == FORMAT_MAX_SCALE && 
+        huge.items()[3].scale == -FORMAT_MAX_SCALE);
+    huge.write(ss, 5E-324, 1.5, 1.7E308, 1E10);
+    TEST_CHECK(compare_strings(ss.str().c_str(),
+        std::string(20, '*') + "      0.00" + std::string(10, '*')));
+    ss.str(std::string());
+
+    // infinity and NaN
+    double const inf = std::numeric_limits<double>::infinity();
+    format_f(cs, inf, 10, 2, false);
+    TEST_CHECK(compare_strings(cs, "  Infinity"));
+    format_e(cs, -inf, 5, 2, EXPONENTIAL_E, 2, false);
+    TEST_CHECK(compare_strings(cs, " -Inf"));
+    format_g(cs, inf, 2, 2, 2, true);
+    TEST_CHECK(compare_strings(cs, "**"));
+    format_f(cs, std::numeric_limits<double>::quiet_NaN(), 5, 2, false);
+    TEST_CHECK(compare_strings(cs, "  NaN"));
+
+    // exhaustive-ish: random doubles all over the range, random precisions
+    std::mt19937_64 random(20240607);
+    size_t failures = 0;
+    for (size_t n = 0; n < 20000 && failures < 10; ++n)
+    {
+        unsigned long long bits = random();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (!std::isfinite(value))
+        {
+            continue;
+        }
+        failures += !check_scientific(value, 1 + random() % 40);
+        failures += !check_fixed(value, random() % 30);
+    }
+
+    // moderate magnitudes, with the precisions typically used
+    for (size_t n = 0; n < 20000 && failures < 10; ++n)
+    {
+        int const exponent = static_cast<int>(random() % 120) - 110;
+        double const value = 
+            std::ldexp(static_cast<double>(random() >> 11), exponent);
+        size_t const precision = random() % 18;
+        failures += !check_fixed(value, precision);
+        failures += !check_scientific(value, precision + 1);
+    }
+
+    // ties: short binary fractions
+    for (int numerator = -2000; numerator <= 2000 && failures < 10; 
+        ++numerator)
+    {
+        for (int shift = 0; shift <= 12; ++shift)
+        {
+            double const value = std::ldexp(numerator, -shift);
+            for (size_t precision = 0; precision <= 6; ++precision)
+            {
+                failures += !check_fixed(value, precision);
+                failures += !check_scientific(value, precision + 1);
+            }
+        }
+    }
+
+    // every digit of the smallest and largest doubles
+    failures += !check_fixed(4.9406564584124654E-324, 1074);
+    failures += !check_fixed(2.2250738585072014E-308, 1100);
+    failures += !check_scientific(4.9406564584124654E-324, 760);
+    failures += !check_fixed(1.7976931348623157E+308, 20);
+    failures += !check_scientific(1.7976931348623157E+308, 320);
+    TEST_CHECK(failures == 0);
+}
+
+
+void test_array()
+{
+    std::ostringstream ss;
+
+    char cs[MAXLEN];
+    size_t len = 0;
+
+    // reversion to the start of the format, without groups
+    std::vector<double> const values = { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0 };
+    printfor(ss, "(3F5.1)", values);
+    TEST_CHECK(ss.str() == "  1.0  2.0  3.0\n  4.0  5.0  6.0\n  7.0\n");
+    ss.str(std::string());
+
+    // reversion to the rightmost top-level group, with its repeat count
+    int const integers[] = { 1, 2, 3, 4, 5, 6, 7 };
+    printfor(ss, "(' H', I2, 2(1X, I1), ' |')", format_span(integers, 7));
+    TEST_CHECK(ss.str() == " H 1 2 3 |\n 4 5 |\n 6 7 |\n");
+    ss.str(std::string());
+
+    printfor(ss, "(2(I1), ' |', 2(1X, I1, 1X, A))", 
+        format_span(integers, 3), "a", 4, "b", 5, "c");
+    TEST_CHECK(ss.str() == "12 | 3 a 4 b\n 5 c \n");
+    ss.str(std::string());
+
+    // terminated at the first data edit descriptor without items
+    printfor(ss, "(I2, ' and', I2, ' end')", 1);
+    TEST_CHECK(ss.str() == " 1 and\n");
+    ss.str(std::string());
+
+    printfor(ss, "(A, 3I2)", "empty", std::vector<int>());
+    TEST_CHECK(ss.str() == "empty\n");
+    ss.str(std::string());
+
+    // no new record without data edit descriptors to revert to
+    printfor(ss, "(I2, 2('x'))", 1, 2);
+    TEST_CHECK(ss.str() == " 1xx\n");
+    ss.str(std::string());
+
+    printfor(ss, "('abc')", 1);
+    TEST_CHECK(ss.str() == "abc\n");
+    ss.str(std::string());
+
+    len = printfor_to_buffer(cs, MAXLEN, "(I2, 2('x'))", values);
+    TEST_CHECK(strcmp(cs, " 1xx") == 0);
+    TEST_CHECK(len == 4);
+
+    // scalars and arrays mixed, strings and logicals
+    std::array<bool, 3> const logicals = {{ true, false, true }};
+    std::vector<std::string> const names = { "one", "two" };
+    printfor(ss, "(A, 3L2, 2(1X, A))", "v:", logicals, names);
+    TEST_CHECK(ss.str() == "v: T F T one two\n");
+    ss.str(std::string());
+
+    // sign mode kept over records
+    FortranFormat const format("(I3, SP)");
+    format.write(ss, format_span(integers, 3));
+    TEST_CHECK(ss.str() == "  1\n +2\n +3\n");
+    ss.str(std::string());
+
+    len = printfor_to_buffer(cs, MAXLEN, "(2I2)", values);
+    TEST_CHECK(strcmp(cs, " 1 2\n 3 4\n 5 6\n 7") == 0);
+    TEST_CHECK(len == 17);
+
+#if __cplusplus >= 202002L
+    printfor(ss, "(4I2)", std::span<int const>(integers + 3, 4));
+    TEST_CHECK(ss.str() == " 4 5 6 7\n");
+    ss.str(std::string());
+#endif
+
+    // a million values, one call
+    std::vector<double> many(1000000);
+    for (size_t n = 0; n < many.size(); ++n)
+    {
+        many[n] = static_cast<double>(n) / 4.0;
+    }
+    printfor(ss, "(5F12.2)", many);
+    std::string const output = ss.str();
+    TEST_CHECK(output.size() == 1000000 * 12 + 200000);
+    TEST_CHECK(output.compare(output.size() - 61, 61, 
+        "   249998.75   249999.00   249999.25   249999.50   249999.75\n") == 0);
+}
+
+
+void test_parallel()
+{
+    char const* const formats[] = {
+        "(6E15.7)",
+        "(' H', F5.1, 2(1X, F4.1), ' |')",
+        "(F7.2, 2(1X, F7.2, SP))",
+        "('no reversion group', 3F5.1)",
+        "(F8.2, 2(1X, 1PE11.3, -1P))"
+    };
+    size_t const sizes[] = { 0, 1, 5, 100, 16384 * 3 + 7, 100001 };
+
+    std::vector<double> values(100001);
+    for (size_t n = 0; n < values.size(); ++n)
+    {
+        values[n] = (n % 2 == 0 ? 1.0 : -1.0) * static_cast<double>(n) / 7.0;
+    }
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); ++f)
+    {
+        FortranFormat const format(formats[f]);
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+        {
+            FormatSpan<double> const span = format_span(values.data(), sizes[s]);
+
+            std::ostringstream expected;
+            format.write(expected, span);
+            for (unsigned int threads = 0; threads <= 4; ++threads)
+            {
+                std::ostringstream ss;
+                format.write_parallel(ss, span, threads);
+                TEST_CHECK(ss.str() == expected.str());
+                TEST_MSG("%s, %zu values, %u threads", formats[f], sizes[s], 
+                    threads);
+            }
+        }
+    }
+
+    // sinks, and arguments that aren't arrays
+    StringSink sink(1024);
+    FortranFormat const format("(3I4)");
+    format.write_parallel(sink, std::vector<int>{ 1, 2, 3, 4 }, 2);
+    format.write_parallel(sink, 5, 2);
+    sink.flush();
+    TEST_CHECK(sink.str == "   1   2   3\n   4\n   5\n");
+}
+
+
+void test_read()
+{
+    // integers: blanks ignored, empty fields are zero
+    int i1 = -1, i2 = -1, i3 = -1;
+    long long big = 0;
+    TEST_CHECK(scanfor_from_buffer(" 12  -3 4     ", 14, "(I3, I4, I3, I4)",
+        &i1, &i2, &i3, &big) == 4);
+    TEST_CHECK(i1 == 12 && i2 == -3 && i3 == 4 && big == 0);
+    TEST_CHECK(scanfor_from_buffer("-9223372036854775808", 20, "(I20)", 
+        &big) == 1);
+    TEST_CHECK(big == std::numeric_limits<long long>::min());
+    unsigned char small = 0;
+    TEST_CHECK(scanfor_from_buffer(" 256", 4, "(I4)", &small) == 0);
+    TEST_CHECK(scanfor_from_buffer(" 255", 4, "(I4)", &small) == 1);
+    TEST_CHECK(small == 255);
+    TEST_CHECK(scanfor_from_buffer("  1x", 4, "(I4)", &i1) == 0);
+
+    // reals: implied decimal point, D exponents, exponents without a letter
+    struct { char const* field; char const* format; double value; } 
+    const reals[] = {
+        { "  1234", "(F6.2)", 12.34 },
+        { " 1.234", "(F6.2)", 1.234 },
+        { "  -  5", "(F6.1)", -0.5 },
+        { "1.5D+3", "(D6.1)", 1500.0 },
+        { "1.5d-3", "(E6.1)", 1.5E-3 },
+        { "1.5+03", "(E6.1)", 1500.0 },
+        { " 15-03", "(E6.1)", 1.5E-3 },
+        { "1.5E 3", "(G6.1)", 1500.0 },
+        { "      ", "(F6.2)", 0.0 },
+        { "  .5  ", "(F6.0)", 0.5 },
+        { "0.1000000000000000055511151231257827021181583404541015625", 
+            "(F57.0)", 0.1 },
+        { "2.2250738585072011e-308", "(E23.16)", 2.2250738585072011e-308 },
+        { "1.7976931348623157E308", "(E22.16)", 1.7976931348623157E308 },
+        { "123456789012345678901234567890", "(F30.0)", 
+            123456789012345678901234567890.0 }
+    };
+    for (size_t n = 0; n < sizeof(reals) / sizeof(reals[0]); ++n)
+    {
+        double value = -1.0;
+        TEST_CHECK(scanfor_from_buffer(reals[n].field, strlen(reals[n].field),
+            reals[n].format, &value) == 1);
+        TEST_CHECK(value == reals[n].value);
+        TEST_MSG("%s with %s: %.17g", reals[n].field, reals[n].format, value);
+    }
+    double value = 0.0;
+    TEST_CHECK(scanfor_from_buffer(" -Infinity", 10, "(F10.0)", &value) == 1);
+    TEST_CHECK(std::isinf(value) && value < 0);
+    TEST_CHECK(scanfor_from_buffer("       NaN", 10, "(F10.0)", &value) == 1);
+    TEST_CHECK(std::isnan(value));
+    TEST_CHECK(scanfor_from_buffer("  1.2.3", 7, "(F7.0)", &value) == 0);
+    TEST_CHECK(scanfor_from_buffer("  1.2E", 6, "(F6.0)", &value) == 0);
+    float single = 0.0f;
+    TEST_CHECK(scanfor_from_buffer("0.1", 3, "(F3.0)", &single) == 1);
+    TEST_CHECK(single == 0.1f);
+
+    // round trip of the decimal engine's output
+    std::mt19937_64 random(42);
+    for (size_t n = 0; n < 10000; ++n)
+    {
+        unsigned long long bits = random();
+        double written;
+        memcpy(&written, &bits, sizeof(written));
+        if (!std::isfinite(written))
+        {
+            continue;
+        }
+        char record[32];
+        printfor_to_buffer(record, sizeof(record), "(E26.17E3)", written);
+        double read = 0.0;
+        TEST_CHECK(scanfor_from_buffer(record, strlen(record), "(E26.17)", 
+            &read) == 1);
+        if (!TEST_CHECK(read == written))
+        {
+            TEST_MSG("%s read as %.17g", record, read);
+            break;
+        }
+    }
+
+    // logicals and characters
+    bool t = false, f = true;
+    TEST_CHECK(scanfor_from_buffer(" .TRUE. f", 9, "(L7, L2)", &t, &f) == 2);
+    TEST_CHECK(t && !f);
+    TEST_CHECK(scanfor_from_buffer("   ", 3, "(L3)", &t) == 0);
+    std::string name;
+    char code[4];
+    TEST_CHECK(scanfor_from_buffer("abc  defgh", 10, "(A5, A5)", &name, 
+        &code) == 2);
+    TEST_CHECK(name == "abc  " && strcmp(code, "fgh") == 0);
+    TEST_CHECK(scanfor_from_buffer("xy", 2, "(A1, A)", &name, &code) == 2);
+    TEST_CHECK(name == "x" && strcmp(code, "y  ") == 0);
+
+    // short records are padded with blanks, X and literals are skipped over
+    TEST_CHECK(scanfor_from_buffer("ab 12", 5, "(2X, 'c', I3, A4)", &i1, 
+        &name) == 2);
+    TEST_CHECK(i1 == 12 && name == "    ");
+
+    // records, reversion and streams
+    char const* const records = "  1  2\r\n  3  4\n  5\n  6";
+    int values[6] = { 0 };
+    TEST_CHECK(scanfor_from_buffer(records, strlen(records), "(2I3)", 
+        &values[0], &values[1], &values[2], &values[3], &values[4], 
+        &values[5]) == 6);
+    // the third record is short: its second field is blank
+    TEST_CHECK(values[0] == 1 && values[1] == 2 && values[2] == 3 && 
+        values[3] == 4 && values[4] == 5 && values[5] == 0);
+    TEST_CHECK(scanfor_from_buffer(records, strlen(records), "(I3, /, I3)", 
+        &values[0], &values[1]) == 2);
+    TEST_CHECK(values[0] == 1 && values[1] == 3);
+    TEST_CHECK(scanfor_from_buffer(records, strlen(records), "(4(I3, /))", 
+        &values[0], &values[1], &values[2], &values[3], &values[4]) == 4);
+
+    FortranFormat const format("(I3)");
+    size_t consumed = 0;
+    TEST_CHECK(format.read_from_buffer(records, strlen(records), &i1) == 1);
+    TEST_CHECK(format.read_args_from_buffer(records, strlen(records), NULL, 0,
+        &consumed) == 0);
+    TEST_CHECK(consumed == 8);
+
+    std::istringstream stream(records);
+    TEST_CHECK(scanfor(stream, "(I3)", &i1) == 1 && i1 == 1);
+    TEST_CHECK(format.read(stream, &i1, &i2) == 2 && i1 == 3 && i2 == 5);
+    TEST_CHECK(scanfor(stream, "(I3)", &i1) == 1 && i1 == 6);
+    TEST_CHECK(scanfor(stream, "(I3)", &i1) == 0);
+
+    // no record read without data edit descriptors to revert to
+    std::istringstream unread("  1  2\n  3\n");
+    TEST_CHECK(scanfor(unread, "(I3, (1X))", &i1, &i2) == 1 && i1 == 1);
+    TEST_CHECK(scanfor(unread, "(I3)", &i1) == 1 && i1 == 3);
+}
+
+
+void test_read_real()
+{
+    // scale factor: a field without an exponent is divided by 10^k
+    double x = 0.0, y = 0.0;
+    TEST_CHECK(scanfor_from_buffer("  1234  1234", 12, "(2P, F6.0, -1P, F6.0)",
+        &x, &y) == 2);
+    TEST_CHECK(x == 12.34 && y == 12340.0);
+    TEST_CHECK(scanfor_from_buffer("  1.5E2", 7, "(3P, E7.1)", &x) == 1);
+    TEST_CHECK(x == 150.0);
+    TEST_CHECK(scanfor_from_buffer("   12", 5, "(1PF5.1)", &x) == 1);
+    TEST_CHECK(x == 0.12);
+    FortranFormat const scaled("(1PE12.4, 0P, F4.0)");
+    TEST_CHECK(scaled.read_from_buffer(" 2.5000E+00 100", 15, &x, &y) == 2);
+    TEST_CHECK(x == 2.5 && y == 100.0);
+
+    // any number of digits and exponents against the C library, which is 
+    // correctly rounded: many digits, ties, subnormals and out of range
+    std::mt19937_64 random(14);
+    char field[96];
+    for (size_t n = 0; n < 200000; ++n)
+    {
+        int length = 0;
+        unsigned long long const kind = random() % 4;
+        if (kind < 2)
+        {
+            // up to 40 random digits, with a random exponent
+            size_t const digits = 1 + random() % (kind == 0 ? 19 : 40);
+            for (size_t d = 0; d < digits; ++d)
+            {
+                field[length++] = static_cast<char>('0' + random() % 10);
+            }
+            length += snprintf(field + length, sizeof(field) - length, "E%d", 
+                static_cast<int>(random() % 700) - 360);
+        }
+        else
+        {
+            // close to, or halfway between, two doubles
+            unsigned long long bits = random() >> 1;
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            if (!std::isfinite(value))
+            {
+                continue;
+            }
+            double const next = nextafter(value, HUGE_VAL);
+            long double const middle = (static_cast<long double>(value) + 
+                next) / 2;
+            length = snprintf(field, sizeof(field), "%.*Le", 
+                kind == 2 ? 17 : 25, middle);
+        }
+        double read = -1.0;
+        TEST_CHECK(scanfor_from_buffer(field, length, "(E96.0)", &read) == 1);
+        double const expected = strtod(field, NULL);
+        if (!TEST_CHECK(read == expected))
+        {
+            TEST_MSG("%s read as %.17g, not %.17g", field, read, expected);
+            break;
+        }
+    }
+}
+
+
+void test_read_projection()
+{
+    FortranFormat const format(
+        "(I4, 2(1X, F6.2), 'id', A3, /, BZ, 2P, F5.0, 3X, I3, BN, L2, A)");
+    size_t const all[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    FormatProjection const whole(format, all);
+    std::vector<FormatField> const& fields = whole.fields();
+    TEST_CHECK(whole.record_lines() == 2 && fields.size() == 8);
+    TEST_CHECK(fields[2].op == FOP_F && fields[2].line == 0 && 
+        fields[2].column == 12 && fields[2].width == 6 && 
+        fields[2].digits == 2);
+    TEST_CHECK(fields[3].op == FOP_A && fields[3].column == 20);
+    TEST_CHECK(fields[4].line == 1 && fields[4].column == 0 && 
+        fields[4].blank_zero && fields[4].scale == 2);
+    TEST_CHECK(fields[5].column == 8 && fields[5].blank_zero);
+    TEST_CHECK(fields[6].column == 11 && !fields[6].blank_zero);
+    TEST_CHECK(fields[7].column == 13 && fields[7].width == 0);
+
+    // the fields asked for, in any order; the others aren't decoded, so 
+    // they may be invalid
+    char const* const records = 
+        "  12   1.50  -2.25idabc\r\n 1234   1 2 T rest\n"
+        "xxxx xxxxxx   3.00idxyz\n    7   5  F\n";
+    size_t const wanted[] = { 6, 2, 4, 5, 3 };
+    FormatProjection const projection(format, wanted);
+    bool flag = false;
+    double x = 0, y = 0;
+    int i = 0;
+    std::string text;
+    size_t consumed = 0;
+    FormatTarget const targets[] = { make_format_target(&flag), 
+        make_format_target(&x), make_format_target(&y), 
+        make_format_target(&i), make_format_target(&text) };
+    TEST_CHECK(projection.read_args_from_buffer(records, strlen(records), 
+        targets, 5, &consumed) == 5);
+    TEST_CHECK(flag && x == -2.25 && y == 12.34 && i == 102 && text == "abc");
+    TEST_CHECK(consumed == 44);
+    TEST_CHECK(projection.read_from_buffer(records + consumed, 
+        strlen(records) - consumed, &flag, &x, &y, &i, &text) == 5);
+    TEST_CHECK(!flag && x == 3.0 && y == 0.07 && i == 500 && text == "xyz");
+    TEST_CHECK(whole.read_args_from_buffer(records + consumed, 
+        strlen(records) - consumed, targets, 5) == 0);
+
+    // short and missing lines
+    TEST_CHECK(projection.read_from_buffer("  12", 4, &flag, &x) == 0);
+    size_t const first_line[] = { 2, 0 };
+    TEST_CHECK(FormatProjection(format, first_line).read_from_buffer("  12", 
+        4, &x, &i) == 2);
+    TEST_CHECK(x == 0.0 && i == 12);
+
+    // positions past the fields of a pass, or after an A edit without a 
+    // width, read nothing
+    FortranFormat const unknown("(I3, A, I3)");
+    size_t const past[] = { 0, 3 };
+    size_t const after_a[] = { 2 };
+    FormatProjection const beyond(unknown, past);
+    FormatProjection const unlocated(unknown, after_a);
+    TEST_CHECK(!beyond.valid() && beyond.fields().empty());
+    TEST_CHECK(!unlocated.valid() && whole.valid());
+    i = -1;
+    consumed = 1;
+    TEST_CHECK(unlocated.read_args_from_buffer("  1abc  2", 9, targets + 3, 1,
+        &consumed) == 0);
+    TEST_CHECK(i == -1 && consumed == 0);
+    TEST_CHECK(beyond.read_from_buffer("  1abc  2", 9, &i, &i) == 0);
+    std::vector<int> column;
+    TEST_CHECK(unlocated.read_vectors("  1abc  2\n", 10, column) == 0);
+
+    // columns of a wide file, against reading every field
+    FortranFormat const wide("(40I6)");
+    size_t const rows = 5000;
+    std::string input;
+    for (size_t r = 0; r < rows; ++r)
+    {
+        for (int n = 0; n < 40; ++n)
+        {
+            char field[8];
+            snprintf(field, sizeof(field), "%6d", 
+                static_cast<int>(r) * 40 + n);
+            input.append(field);
+        }
+        input.push_back('\n');
+    }
+    size_t const picked[] = { 39, 0, 17 };
+    FormatProjection const narrow(wide, picked);
+    for (unsigned int threads = 1; threads <= 3; ++threads)
+    {
+        std::vector<int> last(rows), first(rows), middle(rows);
+        FormatTarget const columns[] = { make_format_target(&last[0]), 
+            make_format_target(&first[0]), make_format_target(&middle[0]) };
+        TEST_CHECK(narrow.read_columns(input.data(), input.size(), columns, 3,
+            rows, threads) == rows);
+        bool same = true;
+        for (size_t r = 0; r < rows && same; ++r)
+        {
+            int const base = static_cast<int>(r) * 40;
+            same = last[r] == base + 39 && first[r] == base && 
+                middle[r] == base + 17;
+        }
+        TEST_CHECK(same);
+        TEST_MSG("%u threads", threads);
+    }
+}
+
+
+void test_record_index()
+{
+    // lines, CRLF and a last line without a new line
+    char const* const text = "ab\r\n\n  cd";
+    RecordIndex index(text, strlen(text));
+    TEST_CHECK(index.lines() == 3 && index.starts().size() == 4);
+    size_t length = 0;
+    TEST_CHECK(index.line(0, &length) == text && length == 2);
+    TEST_CHECK(index.line(1, &length) == text + 4 && length == 0);
+    TEST_CHECK(index.line(2, &length) == text + 5 && length == 4);
+    index.build("x\n", 2);
+    TEST_CHECK(index.lines() == 1 && index.line(0, &length)[0] == 'x' && 
+        length == 1);
+    TEST_CHECK(RecordIndex().lines() == 0 && RecordIndex("", 0).lines() == 0);
+
+    // every scanner against the scalar one, around block boundaries and 
+    // with new lines of any density
+    std::mt19937 random(17);
+    std::vector<char> bytes(1000);
+    for (size_t n = 0; n < 300; ++n)
+    {
+        size_t const size = n < 200 ? n : random() % bytes.size();
+        unsigned int const density = 1 + random() % 64;
+        for (size_t b = 0; b < size; ++b)
+        {
+            bytes[b] = random() % density == 0 ? '\n' : 'a' + random() % 26;
+        }
+        std::vector<size_t> expected;
+        find_newlines(NEWLINE_SCANNER_SCALAR, bytes.data(), size, 5, 
+            &expected);
+        for (int scanner = NEWLINE_SCANNER_SSE2; 
+            scanner <= NEWLINE_SCANNER_AVX2; ++scanner)
+        {
+            NewlineScanner const which = static_cast<NewlineScanner>(scanner);
+            if (!newline_scanner_supported(which))
+            {
+                continue;
+            }
+            std::vector<size_t> found;
+            find_newlines(which, bytes.data(), size, 5, &found);
+            TEST_CHECK(found == expected);
+            TEST_CHECK(count_newlines(which, bytes.data(), size) == 
+                expected.size());
+            TEST_MSG("scanner %d, %zu bytes", scanner, size);
+        }
+    }
+
+    // records of two lines, a short one, and reversion
+    char const* const records = "  1\r\n  2\n  3\n\n  5\n  6";
+    RecordIndex const lines(records, strlen(records));
+    FortranFormat const two("(I3, /, I3)");
+    TEST_CHECK(two.count_records(lines) == 3);
+    int first = -1, second = -1;
+    size_t next = 0;
+    FormatTarget const targets[] = { make_format_target(&first), 
+        make_format_target(&second) };
+    TEST_CHECK(two.read_args_from_index(lines, 2, targets, 2, &next) == 2);
+    TEST_CHECK(first == 3 && second == 0 && next == 4);
+    TEST_CHECK(two.read_from_index(lines, 5, &first, &second) == 1);
+    TEST_CHECK(first == 6);
+    TEST_CHECK(FortranFormat("(I3)").read_from_index(lines, 0, &first, 
+        &second) == 2 && first == 1 && second == 2);
+    size_t const seconds[] = { 1 };
+    TEST_CHECK(FormatProjection(two, seconds).read_from_index(lines, 4, 
+        &second) == 1 && second == 6);
+
+    // columns and callbacks from the index, on threads
+    std::string input;
+    size_t const rows = 20000;
+    for (size_t r = 0; r < rows; ++r)
+    {
+        char record[32];
+        snprintf(record, sizeof(record), r % 3 ? "%6zu%8.2f\n" : "%6zu\r\n", 
+            r, r * 0.5);
+        input.append(record);
+    }
+    FortranFormat const format("(I6, F8.2)");
+    RecordIndex const indexed(input.data(), input.size());
+    TEST_CHECK(format.count_records(indexed) == rows);
+    size_t const projected[] = { 1 };
+    FormatProjection const reals(format, projected);
+    for (unsigned int threads = 1; threads <= 3; ++threads)
+    {
+        std::vector<long long> ids(rows, -1);
+        std::vector<double> values(rows, -1), again(rows, -1);
+        FormatTarget const columns[] = { make_format_target(&ids[0]), 
+            make_format_target(&values[0]) };
+        TEST_CHECK(format.read_columns(indexed, columns, 2, rows, threads) 
+            == rows);
+        FormatTarget const column = make_format_target(&again[0]);
+        TEST_CHECK(reals.read_columns(indexed, &column, 1, rows, threads) 
+            == rows);
+        std::atomic<size_t> sum(0);
+        TEST_CHECK(format.read_parallel(indexed, 
+            [&sum](size_t r, FormatArg const* fields, size_t) {
+                sum += r == static_cast<size_t>(fields[0].integer);
+            }, threads) == rows);
+        bool same = sum == rows;
+        for (size_t r = 0; r < rows && same; ++r)
+        {
+            // short records read a blank F field
+            double const value = r % 3 ? r * 0.5 : 0.0;
+            same = ids[r] == static_cast<long long>(r) && 
+                values[r] == value && again[r] == value;
+        }
+        TEST_CHECK(same);
+        TEST_MSG("%u threads", threads);
+    }
+}
+
+
+void test_read_parallel()
+{
+    // records of a known content, over many chunks
+    size_t const records = 30001;
+    std::string input;
+    char record[64];
+    for (size_t n = 0; n < records; ++n)
+    {
+        printfor_to_buffer(record, sizeof(record), "(I7, F9.2, L2, A5)", 
+            static_cast<int>(n), n * 0.25, n % 3 == 0, "n");
+        input.append(record);
+        // CRLF records, and a last one without a new line
+        input.append(n % 7 == 0 ? "\r\n" : n + 1 < records ? "\n" : "");
+    }
+
+    FortranFormat const format("(I7, F9.2, L2, A5)");
+    TEST_CHECK(format.count_records(input.data(), input.size()) == records);
+    for (unsigned int threads = 0; threads <= 4; ++threads)
+    {
+        std::vector<int> ids(records, -1);
+        std::vector<double> values(records);
+        std::unique_ptr<bool[]> flags(new bool[records]);
+        std::vector<FormatArg::String> names(records);
+        FormatTarget const columns[] = { 
+            make_format_target(&ids[0]), make_format_target(&values[0]), 
+            make_format_target(&flags[0]), 
+            make_format_target(&names[0]) };
+        TEST_CHECK(format.read_columns(input.data(), input.size(), columns, 4,
+            records, threads) == records);
+
+        bool same = true;
+        for (size_t n = 0; n < records && same; ++n)
+        {
+            same = ids[n] == static_cast<int>(n) && values[n] == n * 0.25 && 
+                flags[n] == (n % 3 == 0) && 
+                std::string(names[n].data, names[n].length) == "    n";
+            TEST_CHECK(same);
+            TEST_MSG("record %zu, %u threads", n, threads);
+        }
+
+        // callback, from several threads at once
+        std::vector<long long> sums(records);
+        size_t const read = format.read_parallel(input.data(), input.size(), 
+            [&](size_t r, FormatArg const* fields, size_t count) {
+                if (4 == count && FARG_INT == fields[0].type && 
+                    FARG_DOUBLE == fields[1].type && 
+                    FARG_BOOL == fields[2].type && 
+                    FARG_STRING == fields[3].type)
+                {
+                    sums[r] = fields[0].integer + 
+                        static_cast<long long>(fields[1].real * 4);
+                }
+            }, threads);
+        TEST_CHECK(read == records);
+        size_t n = 0;
+        while (n < records && sums[n] == 2 * static_cast<long long>(n))
+        {
+            ++n;
+        }
+        TEST_CHECK(n == records);
+        TEST_MSG("record %zu, %u threads", n, threads);
+    }
+
+    // records of two lines, an invalid field, too few rows
+    std::string const pairs = "  1\n  2\n  3\n  x\n  5\n  6\n  7";
+    FortranFormat const two("(I3, /, I3)");
+    TEST_CHECK(two.count_records(pairs.data(), pairs.size()) == 4);
+    std::vector<int> first(4), second(4);
+    FormatTarget const columns[] = { make_format_target(&first[0]), 
+        make_format_target(&second[0]) };
+    TEST_CHECK(two.read_columns(pairs.data(), pairs.size(), columns, 2, 4, 2) 
+        == 1);
+    TEST_CHECK(first[0] == 1 && second[0] == 2 && first[2] == 5 && 
+        second[2] == 6);
+    TEST_CHECK(two.read_columns(pairs.data(), 16, columns, 2, 1, 2) == 1);
+
+    // vectors, sized to the records read
+    // (std::vector<bool> has no elements to point to: logicals skipped)
+    FortranFormat const skipping("(I7, F9.2, 2X, A5)");
+    std::vector<int64_t> ids;
+    std::vector<double> values;
+    std::vector<std::string> names;
+    TEST_CHECK(skipping.read_vectors(input.data(), input.size(), ids, values, 
+        names) == records);
+    TEST_CHECK(ids.size() == records && values.size() == records && 
+        names.size() == records);
+    TEST_CHECK(ids[records - 1] == static_cast<int64_t>(records - 1) && 
+        values[8] == 2.0 && names[5] == "    n");
+    TEST_CHECK(two.read_vectors(pairs.data(), pairs.size(), first, second) 
+        == 1);
+    TEST_CHECK(first.size() == 1 && second.size() == 1 && second[0] == 2);
+
+    size_t const picked[] = { 3, 0 };
+    std::vector<FormatArg::String> views(1);
+    FormatColumn const vectors[] = { make_format_column(views), 
+        make_format_column(ids) };
+    TEST_CHECK(FormatProjection(format, picked).read_vectors(input.data(), 
+        input.size(), vectors, 2, 3) == records);
+    TEST_CHECK(views.size() == records && ids.size() == records && 
+        std::string(views[7].data, views[7].length) == "    n" && 
+        ids[7] == 7);
+#if __cplusplus >= 201703L
+    std::vector<std::string_view> texts;
+    TEST_CHECK(FormatProjection(format, picked).read_vectors(input.data(), 
+        input.size(), texts, ids) == records);
+    TEST_CHECK(texts.size() == records && texts[records - 1] == "    n");
+#endif
+
+    // files
+    char path[] = "/tmp/fortranformat_test_XXXXXX";
+    int const fd = mkstemp(path);
+    if (!TEST_CHECK(fd >= 0))
+    {
+        return;
+    }
+    TEST_CHECK(write(fd, input.data(), input.size()) == 
+        static_cast<ssize_t>(input.size()));
+    close(fd);
+    {
+        MappedFile const file(path);
+        TEST_CHECK(file.error() == 0 && file.size() == input.size());
+        TEST_CHECK(format.count_records(file.data(), file.size()) == records);
+    }
+    unlink(path);
+    MappedFile const missing(path);
+    TEST_CHECK(missing.error() == ENOENT && missing.size() == 0);
+}
+
+
+void test_integer_fields()
+{
+    // BN and BZ
+    int values[4] = { 0 };
+    TEST_CHECK(scanfor_from_buffer(" 1 2 1 2 1 2 1 2", 16, 
+        "(I4, BZ, I4, BN, I4, BZ, I4)", &values[0], &values[1], &values[2], 
+        &values[3]) == 4);
+    TEST_CHECK(values[0] == 12 && values[1] == 102 && values[2] == 12 && 
+        values[3] == 102);
+    double real = 0.0;
+    TEST_CHECK(scanfor_from_buffer("  15  ", 6, "(BZ, F6.2)", &real) == 1);
+    TEST_CHECK(real == 15.0);
+
+    // every decoder the machine has against the scalar one, on fields of 
+    // blanks, signs, digits and other characters
+    char const alphabet[] = "          ++--0123456789012345678901234567890.x";
+    std::mt19937 random(7);
+    char text[512];
+    IntegerField expected[16], decoded[16];
+    for (size_t round = 0; round < 20000; ++round)
+    {
+        size_t const width = 1 + random() % 20;
+        size_t const count = 1 + random() % 16;
+        size_t const before = random() % 20;
+        size_t const after = random() % 20;
+        size_t const length = before + width * count + after;
+        for (size_t n = 0; n < length; ++n)
+        {
+            text[n] = alphabet[random() % (sizeof(alphabet) - 1)];
+        }
+        // mostly right-justified integers
+        for (size_t f = 0; f < count && random() % 4 != 0; ++f)
+        {
+            char* const field = text + before + f * width;
+            size_t const digits = 1 + random() % width;
+            memset(field, ' ', width);
+            for (size_t n = width - digits; n < width; ++n)
+            {
+                field[n] = static_cast<char>('0' + random() % 10);
+            }
+            if (digits < width && random() % 2 == 0)
+            {
+                field[width - digits - 1] = random() % 2 == 0 ? '-' : '+';
+            }
+        }
+        bool const blank_zero = random() % 2 == 0;
+
+        decode_integer_fields(INTEGER_DECODER_SCALAR, text, text + length, 
+            text + before, width, count, blank_zero, expected);
+        for (int decoder = INTEGER_DECODER_SSE41; 
+            decoder <= INTEGER_DECODER_SSE41; ++decoder)
+        {
+            if (!integer_decoder_supported(
+                static_cast<IntegerDecoder>(decoder)))
+            {
+                continue;
+            }
+            decode_integer_fields(static_cast<IntegerDecoder>(decoder), text,
+                text + length, text + before, width, count, blank_zero, 
+                decoded);
+            bool same = true;
+            for (size_t f = 0; f < count; ++f)
+            {
+                same = same && decoded[f].valid == expected[f].valid && 
+                    (!expected[f].valid || 
+                    (decoded[f].magnitude == expected[f].magnitude && 
+                    decoded[f].negative == expected[f].negative));
+            }
+            if (!TEST_CHECK(same))
+            {
+                TEST_MSG("decoder %d, width %zu, at %zu: '%.*s'", decoder, 
+                    width, before, static_cast<int>(length), text);
+                return;
+            }
+        }
+    }
+}
+
+
+// record written by printfor with a list-directed format
+template <class... Args>
+std::string list_record(Args const&... args)
+{
+    char record[MAXLEN];
+    printfor_to_buffer(record, MAXLEN, "*", args...);
+    return record;
+}
+
+
+void test_list_directed()
+{
+    // the layout of gfortran's PRINT *
+    struct { std::string written; char const* expected; } const tests[] = {
+        { list_record(42, -7), "          42          -7" },
+        { list_record(10000000000LL, -2147483647 - 1), 
+            "          10000000000 -2147483648" },
+        // integer(8) whatever the value, like gfortran
+        { list_record(int64_t(1), uint64_t(0), -1LL, 7u, short(-3)), 
+            "                    1                    0"
+            "                   -1           7          -3" },
+        { list_record(2.5), "   2.5000000000000000     " },
+        { list_record(-1E-10), "  -1.0000000000000000E-010" },
+        { list_record(1E20), "   1.0000000000000000E+020" },
+        { list_record(0.1), "  0.10000000000000001     " },
+        { list_record(0.0), "   0.0000000000000000     " },
+        { list_record(99999999999999984.0), "   99999999999999984.     " },
+        { list_record(std::numeric_limits<double>::infinity()), 
+            "                  Infinity" },
+        { list_record(2.5f), "   2.50000000    " },
+        { list_record(0.1f), "  0.100000001    " },
+        { list_record(1E10f), "   1.00000000E+10" },
+        { list_record(true, "abc", "def", 1, "x"), 
+            " T abcdef           1 x" }
+    };
+    for (size_t n = 0; n < sizeof(tests) / sizeof(tests[0]); ++n)
+    {
+        if (!TEST_CHECK(tests[n].written == tests[n].expected))
+        {
+            TEST_MSG("'%s' instead of '%s'", tests[n].written.c_str(), 
+                tests[n].expected);
+        }
+    }
+    std::vector<int> const array = { 1, 2, 3 };
+    TEST_CHECK(list_record(array, 4.0f) == 
+        "           1           2           3   4.00000000    ");
+    std::vector<long long> const longs = { 1, -10000000000LL };
+    TEST_CHECK(list_record(longs) == 
+        "                    1         -10000000000");
+    char record[MAXLEN];
+    TEST_CHECK(printfor_to_buffer(record, MAXLEN, " * ") == 0);
+
+    // values separated by blanks, commas or records
+    int i[4] = { -1, -1, -1, -1 };
+    TEST_CHECK(scanfor_from_buffer("1, 2 ,3\t4", 9, "*", &i[0], &i[1], 
+        &i[2], &i[3]) == 4);
+    TEST_CHECK(i[0] == 1 && i[1] == 2 && i[2] == 3 && i[3] == 4);
+    char const* const records = "5\n6,\n,7 8\n9";
+    size_t consumed = 0;
+    FortranFormat const list("*");
+    TEST_CHECK(list.read_from_buffer(records, strlen(records), &i[0], &i[1],
+        &i[2], &i[3]) == 4);
+    TEST_CHECK(i[0] == 5 && i[1] == 6 && i[2] == 3 && i[3] == 7);
+    // the rest of the last record is skipped
+    FormatTarget const one = make_format_target(&i[0]);
+    TEST_CHECK(list.read_args_from_buffer(records, strlen(records), &one, 1,
+        &consumed) == 1);
+    TEST_CHECK(consumed == 2);
+    TEST_CHECK(list.read_args_from_buffer(records, strlen(records), NULL, 0,
+        &consumed) == 0);
+
+    // null values, repeats and slashes
+    i[0] = i[1] = i[2] = i[3] = -1;
+    TEST_CHECK(scanfor_from_buffer(",2*4, 1*, /", 12, "*", &i[0], &i[1], 
+        &i[2], &i[3]) == 4);
+    TEST_CHECK(i[0] == -1 && i[1] == 4 && i[2] == 4 && i[3] == -1);
+    TEST_CHECK(scanfor_from_buffer("9 8/ 7", 6, "*", &i[0], &i[1], &i[2]) 
+        == 2);
+    TEST_CHECK(i[0] == 9 && i[1] == 8 && i[2] == 4);
+    TEST_CHECK(scanfor_from_buffer("3*1", 3, "*", &i[0], &i[1]) == 2);
+    TEST_CHECK(i[0] == 1 && i[1] == 1);
+
+    // other types, quoted strings and errors
+    double x = 0.0;
+    float y = 0.0f;
+    bool t = false, f = true;
+    std::string quoted, word;
+    char code[4];
+    char const* const mixed = 
+        "1.5E3 -.25 .TRUE. f 'it''s, a/b' word \"abcdef\"";
+    TEST_CHECK(scanfor_from_buffer(mixed, strlen(mixed), "*", &x, &y, &t, &f,
+        &quoted, &word, &code) == 7);
+    TEST_CHECK(x == 1500.0 && y == -0.25f && t && !f);
+    TEST_CHECK(quoted == "it's, a/b" && word == "word");
+    TEST_CHECK(strcmp(code, "abc") == 0);
+    TEST_CHECK(scanfor_from_buffer("'x'", 3, "*", &code) == 1);
+    TEST_CHECK(strcmp(code, "x  ") == 0);
+    TEST_CHECK(scanfor_from_buffer("1 x 3", 5, "*", &i[0], &i[1], &i[2]) 
+        == 1);
+    TEST_CHECK(scanfor_from_buffer("'open", 5, "*", &word) == 0);
+    TEST_CHECK(scanfor_from_buffer("1 2", 3, "*", &i[0], &i[1], &i[2]) == 2);
+
+    // what is written is read back
+    std::mt19937_64 random(7);
+    for (size_t n = 0; n < 1000; ++n)
+    {
+        unsigned long long bits = random();
+        double written;
+        memcpy(&written, &bits, sizeof(written));
+        float single = static_cast<float>(written);
+        long long integer = static_cast<long long>(bits);
+        if (!std::isfinite(written) || !std::isfinite(single))
+        {
+            continue;
+        }
+        std::string const line = list_record(written, single, integer);
+        double read = 0.0;
+        float read_single = 0.0f;
+        long long read_integer = 0;
+        TEST_CHECK(scanfor_from_buffer(line.data(), line.size(), "*", &read,
+            &read_single, &read_integer) == 3);
+        if (!TEST_CHECK(read == written && read_single == single && 
+            read_integer == integer))
+        {
+            TEST_MSG("%s", line.c_str());
+            break;
+        }
+    }
+
+    // a record per line, read in parallel
+    char const* const lines = "1 2.5\n2, -1E2\n3 0\n";
+    std::vector<int> ids;
+    std::vector<double> values;
+    TEST_CHECK(list.read_vectors(lines, strlen(lines), ids, values) == 3);
+    TEST_CHECK(ids.size() == 3 && ids[2] == 3 && values[1] == -100.0);
+    TEST_CHECK(list.read_vectors("1\n2 3\n", 7, ids, values) == 0);
+}
+
+
+// sink whose writes wait until it's opened
+class GatedSink : public StringSink
+{
+public:
+    GatedSink() : StringSink(16), open(false) {}
+
+    std::atomic<bool> open;
+
+protected:
+    void write_out(char const* data, size_t size)
+    {
+        while (!this->open.load())
+        {
+            std::this_thread::yield();
+        }
+        StringSink::write_out(data, size);
+    }
+};
+
+
+// sink taking its time, which sees how many records were pushed but not 
+// written out yet, at most
+class SlowSink : public StringSink
+{
+public:
+    SlowSink() : StringSink(16), pushed(0), queued(0) {}
+
+    std::atomic<size_t> pushed;
+    size_t queued;
+
+protected:
+    void write_out(char const* data, size_t size)
+    {
+        size_t const lines = std::count(this->str.begin(), this->str.end(), 
+            '\n');
+        this->queued = std::max(this->queued, this->pushed.load() - lines);
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        StringSink::write_out(data, size);
+    }
+};
+
+
+void test_logger()
+{
+    // records are copied, strings and arrays included, and formatted later
+    FortranFormat const format("(I3, 1X, A, 1X, 3F5.1)");
+    FortranFormat const list("*");
+    StringSink expected(64);
+    StringSink sink(64);
+    {
+        FormatLogger logger(sink);
+        for (int n = 0; n < 100; ++n)
+        {
+            std::string const name = "name" + std::to_string(n);
+            std::vector<double> const values = { n / 2.0, -1.5, n * 1.0 };
+            TEST_CHECK(logger.log(format, n, name, values));
+            format.write(expected, n, name, values);
+        }
+        TEST_CHECK(logger.log(list, 2.5f, true, "end"));
+        list.write(expected, 2.5f, true, "end");
+        logger.flush();
+        expected.flush();
+        TEST_CHECK(sink.str == expected.str);
+        TEST_CHECK(logger.dropped() == 0);
+
+        // and written out when the logger is destroyed
+        logger.log(format, 1, "last", std::vector<double>());
+    }
+    TEST_CHECK(sink.str == expected.str + "  1 last \n");
+
+    // each thread's records in order, through rings smaller than them
+    sink.str.clear();
+    unsigned int const threads = 4;
+    int const records = 20000;
+    {
+        FormatLogger logger(sink, 256, LOG_BLOCK);
+        FortranFormat const pair("(I2, I6)");
+        std::vector<std::thread> producers;
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            producers.push_back(std::thread([&logger, &pair, t]() {
+                for (int n = 0; n < records; ++n)
+                {
+                    logger.log(pair, t, n);
+                }
+            }));
+        }
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            producers[t].join();
+        }
+        logger.flush();
+        TEST_CHECK(logger.dropped() == 0);
+    }
+    std::vector<int> next(threads, 0);
+    std::istringstream lines(sink.str);
+    unsigned int thread = 0;
+    int n = 0;
+    bool ordered = true;
+    while (scanfor(lines, "(I2, I6)", &thread, &n) == 2)
+    {
+        ordered = ordered && thread < threads && n == next[thread];
+        next[thread % threads] = n + 1;
+    }
+    TEST_CHECK(ordered);
+    for (unsigned int t = 0; t < threads; ++t)
+    {
+        TEST_CHECK(next[t] == records);
+    }
+
+    // the rings of threads that exited are taken by the next ones, records
+    // left in them written first; threads outliving the logger delete 
+    // theirs
+    sink.str.clear();
+    StringSink expected_rings(64);
+    FortranFormat const pair("(I2, I6)");
+    std::atomic<int> step(0);
+    std::thread outliving;
+    {
+        FormatLogger logger(sink, 256, LOG_BLOCK);
+        for (int t = 0; t < 20; ++t)
+        {
+            std::thread([&logger, &pair, t]() {
+                for (int n = 0; n < 50; ++n)
+                {
+                    logger.log(pair, t, n);
+                }
+            }).join();
+            for (int n = 0; n < 50; ++n)
+            {
+                pair.write(expected_rings, t, n);
+            }
+        }
+        TEST_CHECK(logger.rings() == 1);
+        outliving = std::thread([&logger, &pair, &step]() {
+            logger.log(pair, 20, 0);
+            step = 1;
+            while (step.load() != 2)
+            {
+                std::this_thread::yield();
+            }
+            // after the logger is gone, with another one
+            StringSink other(16);
+            FormatLogger next(other);
+            next.log(pair, 21, 0);
+        });
+        while (step.load() != 1)
+        {
+            std::this_thread::yield();
+        }
+        pair.write(expected_rings, 20, 0);
+        TEST_CHECK(logger.rings() == 1);
+        logger.flush();
+        logger.log(pair, 22, 0);
+        pair.write(expected_rings, 22, 0);
+        TEST_CHECK(logger.rings() == 2);
+    }
+    step = 2;
+    outliving.join();
+    expected_rings.flush();
+    TEST_CHECK(sink.str == expected_rings.str);
+
+    // a full ring drops records, and counts them
+    GatedSink gated;
+    {
+        FormatLogger logger(gated, 256);
+        size_t logged = 0;
+        size_t dropped = 0;
+        for (int n = 0; n < 1000; ++n)
+        {
+            if (logger.log(format, n, "x", std::vector<double>()))
+            {
+                logged = logged + 1;
+            }
+            else
+            {
+                dropped = dropped + 1;
+            }
+        }
+        TEST_CHECK(dropped > 0 && logger.dropped() == dropped);
+        // as does a record larger than the ring, whatever the policy
+        std::string const large(1000, 'x');
+        TEST_CHECK(!logger.log(format, 1, large, std::vector<double>()));
+        TEST_CHECK(logger.dropped() == dropped + 1);
+
+        gated.open = true;
+        logger.flush();
+        TEST_CHECK(std::count(gated.str.begin(), gated.str.end(), '\n') == 
+            static_cast<long>(logged));
+    }
+}
+
+
+void test_record_queue()
+{
+    // whole records from every thread, longer than the sink's buffer, each 
+    // thread's in order
+    unsigned int const threads = 8;
+    int const records = 5000;
+    FortranFormat const format("(I1, I5, 1X, A)");
+    StringSink sink(256);
+    {
+        RecordQueue queue(sink);
+        std::vector<std::thread> producers;
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            producers.push_back(std::thread([&queue, &format, t]() {
+                for (int n = 0; n < records; ++n)
+                {
+                    std::string const text(n % 700, static_cast<char>('a' + t));
+                    queue.write(format, t, n, text);
+                }
+            }));
+        }
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            producers[t].join();
+        }
+        queue.flush();
+        TEST_CHECK(sink.writes > 1);
+    }
+
+    std::vector<int> next(threads, 0);
+    std::istringstream lines(sink.str);
+    std::string line;
+    bool whole = true;
+    while (whole && std::getline(lines, line))
+    {
+        unsigned int thread = threads;
+        int n = -1;
+        std::string text;
+        whole = FortranFormat("(I1, I5, 1X, A)").read_from_buffer(
+            line.data(), line.size(), &thread, &n, &text) == 3 && 
+            thread < threads && n == next[thread] && 
+            text == std::string(n % 700, static_cast<char>('a' + thread));
+        if (whole)
+        {
+            next[thread] = n + 1;
+        }
+    }
+    if (!TEST_CHECK(whole))
+    {
+        TEST_MSG("%.80s", line.c_str());
+    }
+    for (unsigned int t = 0; t < threads; ++t)
+    {
+        TEST_CHECK(next[t] == records);
+    }
+
+    // to a stream, written out when the queue is destroyed
+    std::ostringstream stream;
+    {
+        RecordQueue queue(stream);
+        queue.write(format, 1, 2, "three");
+        queue.write(FortranFormat("(2I2)"), 4, 5, 6);
+    }
+    TEST_CHECK(stream.str() == "1    2 three\n 4 5\n 6\n");
+
+    // a slow sink holds producers back, which queue a few records each
+    int const limit = 8;
+    SlowSink slow;
+    {
+        RecordQueue queue(slow, limit);
+        FortranFormat const pair("(I2, I6)");
+        std::vector<std::thread> producers;
+        for (unsigned int t = 0; t < 4; ++t)
+        {
+            producers.push_back(std::thread([&queue, &pair, &slow, t]() {
+                for (int n = 0; n < 500; ++n)
+                {
+                    TEST_CHECK(queue.write(pair, t, n));
+                    slow.pushed.fetch_add(1);
+                }
+            }));
+        }
+        for (unsigned int t = 0; t < 4; ++t)
+        {
+            producers[t].join();
+        }
+        queue.flush();
+        TEST_CHECK(queue.dropped() == 0);
+    }
+    TEST_CHECK(std::count(slow.str.begin(), slow.str.end(), '\n') == 2000);
+    // and those in the sink's buffer
+    TEST_CHECK(slow.queued <= 4 * limit + 2);
+    TEST_MSG("%zu records queued", slow.queued);
+
+    // or drop records, and count them
+    GatedSink gated;
+    {
+        RecordQueue queue(gated, limit, LOG_DROP);
+        size_t written = 0;
+        for (int n = 0; n < 100; ++n)
+        {
+            written = written + (queue.write(format, 1, n, "x") ? 1 : 0);
+        }
+        TEST_CHECK(written < 100 && queue.dropped() == 100 - written);
+        gated.open = true;
+        queue.flush();
+        TEST_CHECK(std::count(gated.str.begin(), gated.str.end(), '\n') == 
+            static_cast<long>(written));
+    }
+}
+
+// writes record n of the pipeline test with records(format, args...)
+template <class Records>
+void pipeline_record(Records& records, int const n)
+{
+    static FortranFormat const formats[] = {
+        FortranFormat("(I8, 1X, A)"),
+        FortranFormat("(F12.4, E14.5E3)"),
+        FortranFormat("(3I4)"),
+        FortranFormat("(A, 2(1X, G14.6))")
+    };
+    std::string const text(n % 300, static_cast<char>('a' + n % 26));
+    switch (n % 4)
+    {
+    case 0:
+        records(formats[0], n, text.substr(0, n % 40));
+        break;
+    case 1:
+        records(formats[1], n * 0.25, -n * 1.5e-3);
+        break;
+    case 2:
+        // two records
+        records(formats[2], n, -n, n % 7, n / 3, n * 2);
+        break;
+    default:
+        records(formats[3], text, n * 1e-3f, 1.0 / (n + 1));
+    }
+}
+
+
+struct SinkRecords
+{
+    StringSink* sink;
+
+    template <class... Args>
+    void operator()(FortranFormat const& format, Args const&... args)
+    {
+        format.write(*this->sink, args...);
+    }
+};
+
+
+struct PipelineRecords
+{
+    FormatPipeline* pipeline;
+
+    template <class... Args>
+    void operator()(FortranFormat const& format, Args const&... args)
+    {
+        this->pipeline->submit(format, args...);
+    }
+};
+
+
+void test_format_pipeline()
+{
+    // mixed records, their strings gone once submitted, written out in 
+    // order by any number of workers, with a window smaller than the 
+    // records
+    int const records = 20000;
+    StringSink expected(1 << 16);
+    SinkRecords sequential = { &expected };
+    for (int n = 0; n < records; ++n)
+    {
+        pipeline_record(sequential, n);
+    }
+    expected.flush();
+
+    FortranFormat const last("(3I4)");
+    unsigned int const threads[] = { 4, 1 };
+    for (size_t t = 0; t < 2; ++t)
+    {
+        StringSink sink(1 << 16);
+        {
+            FormatPipeline pipeline(sink, threads[t], 1000);
+            PipelineRecords submit = { &pipeline };
+            for (int n = 0; n < records; ++n)
+            {
+                pipeline_record(submit, n);
+            }
+            pipeline.flush();
+            TEST_CHECK(sink.str == expected.str);
+            pipeline.submit(last, 1, 2, 3);
+        }
+        TEST_CHECK(sink.str == expected.str + "   1   2   3\n");
+        TEST_MSG("%u threads", threads[t]);
+    }
+}
+
+
+void test_wide_fields()
+{
+    // fields and literals wider than any buffer: through a stream, whose 
+    // sink buffer is smaller, into a buffer, and counted
+    std::string const text(1500, 'w');
+    std::string const literal = std::string(1200, 'q') + "'" + 
+        std::string(300, 'r');
+    std::string const source = "(A2000, 1X, F1500.1200, 1X, '" + 
+        std::string(1200, 'q') + "''" + std::string(300, 'r') + "', A10)";
+    FortranFormat const format(source.c_str());
+
+    std::string const expected = std::string(500, ' ') + text + " " + 
+        std::string(298, ' ') + "0.5" + std::string(1199, '0') + " " + 
+        literal + "wwwwwwwwww";
+    std::ostringstream stream;
+    format.write(stream, text, 0.5, text);
+    TEST_CHECK(stream.str() == expected + "\n");
+
+    std::vector<char> buffer(expected.size() + 1);
+    TEST_CHECK(format.write_to_buffer(buffer.data(), buffer.size(), text, 0.5,
+        text) == expected.size());
+    TEST_CHECK(std::string(buffer.data()) == expected);
+    TEST_CHECK(format.write_to_buffer(buffer.data(), 100, text, 0.5, text) ==
+        expected.size());
+
+    // and the widest of the numeric edits, overflowing or not
+    std::ostringstream numbers;
+    FortranFormat("(I2000.1990, E3000.2500E4, G1800.700, L1500)").write(
+        numbers, -7, 0.25, 1.0 / 3, true);
+    std::string const record = numbers.str();
+    TEST_CHECK(record.size() == 2000 + 3000 + 1800 + 1500 + 1);
+    TEST_CHECK(record.compare(0, 2000, std::string(9, ' ') + "-" + 
+        std::string(1989, '0') + "7") == 0);
+    TEST_CHECK(record.compare(2000, 3000, std::string(492, ' ') + "0.25" + 
+        std::string(2498, '0') + "E+0000") == 0);
+    TEST_CHECK(record.compare(8298, 2, " T") == 0);
+
+    std::ostringstream overflow;
+    FortranFormat("(F1200.1199)").write(overflow, -12.0);
+    TEST_CHECK(overflow.str() == std::string(1200, '*') + "\n");
+}
+
+
+#if __cplusplus >= 201703L
+// upstream resource counting the blocks it gives
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    CountingResource() : allocations(0) {}
+
+    size_t allocations;
+
+protected:
+    void* do_allocate(size_t size, size_t alignment) override
+    {
+        this->allocations = this->allocations + 1;
+        return std::pmr::new_delete_resource()->allocate(size, alignment);
+    }
+
+    void do_deallocate(void* memory, size_t size, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(memory, size, alignment);
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const 
+        noexcept override
+    {
+        return this == &other;
+    }
+};
+#endif
+
+
+void test_arena()
+{
+    // aligned allocations, larger ones than a block included, in the same
+    // blocks once reset
+    FormatArena arena(256);
+    for (int batch = 0; batch < 2; ++batch)
+    {
+        char* const one = static_cast<char*>(arena.allocate(1, 1));
+        double* const real = static_cast<double*>(
+            arena.allocate(sizeof(double), alignof(double)));
+        char* const large = static_cast<char*>(arena.allocate(1000, 64));
+        TEST_CHECK(reinterpret_cast<uintptr_t>(real) % alignof(double) == 0);
+        TEST_CHECK(reinterpret_cast<uintptr_t>(large) % 64 == 0);
+        *one = 'x';
+        *real = 2.5;
+        memset(large, 'y', 1000);
+        TEST_CHECK(*one == 'x' && *real == 2.5);
+        TEST_CHECK(arena.used() >= 1009);
+        size_t const reserved = arena.reserved();
+        arena.reset();
+        TEST_CHECK(arena.used() == 0);
+        TEST_CHECK(arena.reserved() == reserved);
+    }
+
+    // formats compiled into an arena, like those on the heap
+    FormatArena formats;
+    FortranFormat const format("(I4, 1X, A, 'lit''eral', 3F6.2)", formats);
+    FortranFormat const heap("(I4, 1X, A, 'lit''eral', 3F6.2)");
+    TEST_CHECK(format.items().get_allocator().arena() == &formats);
+    TEST_CHECK(format.literals() == "lit'eral");
+    TEST_CHECK(formats.used() > 0);
+    char text[64];
+    char expected[64];
+    std::vector<double> const values = { 1.0, -2.5, 3.25 };
+    format.write_to_buffer(text, sizeof(text), 7, "ab", values);
+    heap.write_to_buffer(expected, sizeof(expected), 7, "ab", values);
+    TEST_CHECK(strcmp(text, expected) == 0);
+    TEST_CHECK(strcmp(text, "   7 ablit'eral  1.00 -2.50  3.25") == 0);
+    FortranFormat const copy(format);
+    TEST_CHECK(copy.items().get_allocator().arena() == &formats);
+
+    // records captured for later, their strings and arrays gone, batch 
+    // after batch in the same memory
+    FormatArena records(1024);
+    StringSink sink(64);
+    StringSink direct(64);
+    size_t reserved = 0;
+    for (int batch = 0; batch < 3; ++batch)
+    {
+        std::vector<FormatRecord> captured;
+        for (int n = 0; n < 20; ++n)
+        {
+            std::string const name(n % 5 + 1, static_cast<char>('a' + n));
+            std::vector<double> const row = { n * 0.5, -n * 1.0, batch * 1.0 };
+            captured.push_back(capture_record(records, format, n, name, row));
+            format.write(direct, n, name, row);
+        }
+        TEST_CHECK(captured[3].count == 5);
+        for (size_t r = 0; r < captured.size(); ++r)
+        {
+            captured[r].format->write_args(sink, captured[r].args, 
+                captured[r].count);
+        }
+        if (batch > 0)
+        {
+            TEST_CHECK(records.reserved() == reserved);
+        }
+        reserved = records.reserved();
+        records.reset();
+    }
+    sink.flush();
+    direct.flush();
+    TEST_CHECK(sink.str == direct.str);
+
+#if __cplusplus >= 201703L
+    // a memory resource for standard containers, on an upstream of choice
+    CountingResource upstream;
+    {
+        FormatArena pool(512, &upstream);
+        std::pmr::vector<int> numbers(&pool);
+        for (int n = 0; n < 100; ++n)
+        {
+            numbers.push_back(n);
+        }
+        TEST_CHECK(numbers[99] == 99);
+        TEST_CHECK(upstream.allocations > 0);
+        size_t const allocations = upstream.allocations;
+        pool.reset();
+        std::pmr::string text("a string longer than the small buffer", &pool);
+        TEST_CHECK(upstream.allocations == allocations);
+    }
+#endif
+}